@@ -0,0 +1,263 @@
+/*      activity_report.cpp
+        Switching activity and toggle coverage of the lab designs, from
+        the cycle models in lab_models.h.
+
+        Build: g++ -std=c++17 -O2 -o activity_report activity_report.cpp
+        Usage: activity_report [seconds] [top_n]
+
+        Runs lab1_hh, lab2_hh and lab3_hh for the given simulated time
+        (default 1 s) at 40 MHz, with a person's rate of input: a switch
+        flipped every 30 to 150 ms, and keys held for 60 to 140 ms, with
+        contact bounce on both. The models are transcriptions of the
+        RTL, register by register, and stand in for a simulation of the
+        sources themselves.
+
+        For every register and named net it counts bit toggles, and
+        prints:
+          - the top_n busiest nets over all designs, in toggles/s
+          - the total toggles/s of each design
+          - the nets with bits that never rose and fell (toggle
+            coverage holes) in each design
+
+        Toggle rates are per net summed over its bits. They rank nets
+        for clock gating and enables; they are not a power estimate,
+        which would also need the capacitance of each net. */
+
+#include "lab_models.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+/*
+ * ActivityProbe
+ *
+ * Receives the nets of a model once per clock, always in the same
+ * order, and counts the toggles of each, and which bits have risen and
+ * fallen.
+ */
+class ActivityProbe {
+public:
+    struct Net {
+        std::string name;
+        unsigned    width;
+        uint64_t    value;
+        uint64_t    toggles;
+        uint64_t    rose, fell;
+    };
+
+    void begin_cycle() { next_ = 0; }
+
+    void operator()(const char* name, uint64_t value, unsigned width)
+    {
+        uint64_t mask = width >= 64 ? ~uint64_t(0) : (uint64_t(1) << width) - 1;
+        value &= mask;
+        if (next_ == nets_.size()) {
+            nets_.push_back({name, width, value, 0, 0, 0});
+        } else {
+            Net&     net  = nets_[next_];
+            uint64_t diff = net.value ^ value;
+            net.toggles += uint64_t(__builtin_popcountll(diff));
+            net.rose    |= diff & value;
+            net.fell    |= diff & ~value;
+            net.value    = value;
+        }
+        ++next_;
+    }
+
+    const std::vector<Net>& nets() const { return nets_; }
+
+private:
+    std::vector<Net> nets_;
+    size_t           next_ = 0;
+};
+
+/*
+ * Bouncy
+ *
+ * A mechanical contact: after each change of the intended level, the
+ * contact chatters for 2 ms, flipping at random about every 50 us,
+ * before settling.
+ */
+struct Bouncy {
+    std::mt19937_64 rng;
+    bool     level = false, contact = false;
+    uint64_t settle_at = 0, next_flip = 0;
+
+    explicit Bouncy(unsigned seed) : rng(seed) {}
+
+    void set(bool new_level, uint64_t now)
+    {
+        if (new_level == level)
+            return;
+        level     = new_level;
+        settle_at = now + lab::CLK_HZ / 500;            // 2 ms of bounce
+        next_flip = now;
+    }
+
+    bool sample(uint64_t now)
+    {
+        if (now >= settle_at) {
+            contact = level;
+        } else if (now >= next_flip) {
+            contact   = !contact;
+            next_flip = now + 1 + rng() % (lab::CLK_HZ / 10000);
+        }
+        return contact;
+    }
+};
+
+/* Milliseconds to cycles. */
+uint64_t ms(double milliseconds)
+{
+    return uint64_t(milliseconds * lab::CLK_HZ / 1000);
+}
+
+struct DesignReport {
+    std::string                      name;
+    std::vector<ActivityProbe::Net>  nets;
+    double                           seconds;
+};
+
+DesignReport run_lab1(uint64_t cycles)
+{
+    lab::Lab1 dut;
+    ActivityProbe probe;
+    std::mt19937_64 rng(1);
+    std::vector<Bouncy> switches;
+    for (unsigned i = 0; i < 4; ++i)
+        switches.emplace_back(10 + i);
+    uint64_t next_flip = ms(50);
+    for (uint64_t t = 0; t < cycles; ++t) {
+        if (t == next_flip) {
+            Bouncy& sw = switches[rng() % 4];
+            sw.set(!sw.level, t);
+            next_flip = t + ms(30 + rng() % 120);
+        }
+        unsigned s = 0;
+        for (unsigned i = 0; i < 4; ++i)
+            s |= unsigned(switches[i].sample(t)) << i;
+        dut.s = s;
+        probe.begin_cycle();
+        dut.probe(probe);
+        dut.clock();
+    }
+    return {"lab1_hh", probe.nets(), double(cycles) / lab::CLK_HZ};
+}
+
+DesignReport run_lab2(uint64_t cycles)
+{
+    lab::Lab2 dut;
+    ActivityProbe probe;
+    std::mt19937_64 rng(2);
+    std::vector<Bouncy> switches;
+    for (unsigned i = 0; i < 8; ++i)
+        switches.emplace_back(20 + i);
+    uint64_t next_flip = ms(50);
+    for (uint64_t t = 0; t < cycles; ++t) {
+        if (t == next_flip) {
+            Bouncy& sw = switches[rng() % 8];
+            sw.set(!sw.level, t);
+            next_flip = t + ms(30 + rng() % 120);
+        }
+        unsigned left = 0, right = 0;
+        for (unsigned i = 0; i < 4; ++i) {
+            left  |= unsigned(switches[i].sample(t)) << i;
+            right |= unsigned(switches[4 + i].sample(t)) << i;
+        }
+        dut.left_value  = left;
+        dut.right_value = right;
+        probe.begin_cycle();
+        dut.probe(probe);
+        dut.clock();
+    }
+    return {"lab2_hh", probe.nets(), double(cycles) / lab::CLK_HZ};
+}
+
+DesignReport run_lab3(uint64_t cycles)
+{
+    lab::Lab3 dut;
+    ActivityProbe probe;
+    std::mt19937_64 rng(3);
+    Bouncy key(30);
+    unsigned key_index = 0;
+    uint64_t next_change = ms(50);
+    for (uint64_t t = 0; t < cycles; ++t) {
+        if (t == next_change) {
+            if (key.level) {
+                key.set(false, t);
+                next_change = t + ms(100 + rng() % 200);
+            } else {
+                key_index = unsigned(rng() % 16);
+                key.set(true, t);
+                next_change = t + ms(60 + rng() % 80);
+            }
+        }
+        dut.keypad.held = key.sample(t) ? int(key_index) : -1;
+        probe.begin_cycle();
+        dut.probe(probe);
+        dut.clock();
+    }
+    return {"lab3_hh", probe.nets(), double(cycles) / lab::CLK_HZ};
+}
+
+struct Ranked {
+    const DesignReport*       design;
+    const ActivityProbe::Net* net;
+    double                    rate;
+};
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    double   seconds = argc > 1 ? std::atof(argv[1]) : 1.0;
+    unsigned top_n   = argc > 2 ? unsigned(std::atoi(argv[2])) : 15;
+    uint64_t cycles  = uint64_t(seconds * lab::CLK_HZ);
+
+    std::vector<DesignReport> designs;
+    designs.push_back(run_lab1(cycles));
+    designs.push_back(run_lab2(cycles));
+    designs.push_back(run_lab3(cycles));
+
+    std::vector<Ranked> ranked;
+    for (const DesignReport& d : designs)
+        for (const ActivityProbe::Net& n : d.nets)
+            ranked.push_back({&d, &n, double(n.toggles) / d.seconds});
+    std::sort(ranked.begin(), ranked.end(),
+              [](const Ranked& a, const Ranked& b) { return a.rate > b.rate; });
+
+    std::printf("%.3f s simulated at %.0f MHz per design\n\n", seconds, lab::CLK_HZ / 1e6);
+    std::printf("top %u nets by toggles/s\n", top_n);
+    for (unsigned i = 0; i < top_n && i < ranked.size(); ++i)
+        std::printf("  %12.0f  %-26s %s [%u]\n", ranked[i].rate,
+                    ranked[i].design->name.c_str(), ranked[i].net->name.c_str(),
+                    ranked[i].net->width);
+
+    std::printf("\ntotal toggles/s and toggle coverage per design\n");
+    for (const DesignReport& d : designs) {
+        uint64_t toggles = 0;
+        unsigned bits = 0, covered = 0;
+        for (const ActivityProbe::Net& n : d.nets) {
+            toggles += n.toggles;
+            bits    += n.width;
+            covered += unsigned(__builtin_popcountll(n.rose & n.fell));
+        }
+        std::printf("  %-26s %12.0f toggles/s, %u of %u bits toggled both ways\n",
+                    d.name.c_str(), toggles / d.seconds, covered, bits);
+        for (const ActivityProbe::Net& n : d.nets) {
+            uint64_t mask = n.width >= 64 ? ~uint64_t(0) : (uint64_t(1) << n.width) - 1;
+            uint64_t holes = ~(n.rose & n.fell) & mask;
+            if (holes)
+                std::printf("      not covered: %s [%u], bits %llx\n", n.name.c_str(),
+                            n.width, (unsigned long long)holes);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,237 @@
+/*      hex_entry_test.cpp
+        Tests of the hex_entry accumulator (Lab 3/lab3_hh.sv) on the
+        cycle model in lab_models.h.
+
+        Build: g++ -std=c++17 -O2 -o hex_entry_test hex_entry_test.cpp
+        Usage: hex_entry_test [cycles]
+
+        The first test applies a key on 7 of every 8 clocks, close to
+        the fastest activate can arrive, for a long random sequence
+        (default 2M cycles) in each of several configurations, with the
+        consumer's out_ready held high, low for long stretches, or
+        random. After every clock the model is compared with a reference
+        written from the hex_entry description: the digits typed since
+        the last accepted enter, and a one-entry output slot. Every
+        accepted value must reach the consumer exactly once and in
+        order, and an enter while the slot is still full must be
+        ignored.
+
+        The second test types a key sequence on the lab3_hh keypad,
+        through the scanner and debouncer, and checks what hex_writer
+        puts on the two digits after each key. */
+
+#include "lab_models.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+/*
+ * EntryReference
+ *
+ * hex_entry as described: typed digits, oldest first, at most digits
+ * of them; backspace removes the newest; enter offers the value to the
+ * consumer if the output slot is free or being emptied on the same
+ * clock, and is otherwise ignored.
+ */
+struct EntryReference {
+    unsigned              digits;
+    bool                  control_keys;
+    unsigned              backspace_key, enter_key;
+    std::vector<unsigned> typed;
+    bool                  slot_full = false;
+    uint64_t              slot = 0;
+
+    EntryReference(unsigned digits_, bool control_keys_, unsigned backspace_key_,
+                   unsigned enter_key_, uint64_t reset_value)
+        : digits(digits_), control_keys(control_keys_),
+          backspace_key(backspace_key_), enter_key(enter_key_)
+    {
+        if (reset_value != 0)
+            for (unsigned i = digits; i-- > 0;)
+                typed.push_back(unsigned(reset_value >> (4 * i)) & 15);
+    }
+
+    uint64_t value() const
+    {
+        uint64_t v = 0;
+        for (unsigned d : typed)
+            v = (v << 4) | d;
+        return v;
+    }
+
+    /* Returns true if the value was accepted. */
+    bool key(unsigned hex, bool consumer_takes)
+    {
+        if (control_keys && hex == backspace_key) {
+            if (!typed.empty())
+                typed.pop_back();
+        } else if (control_keys && hex == enter_key) {
+            if (slot_full && !consumer_takes)
+                return false;
+            slot      = value();
+            slot_full = true;
+            typed.clear();
+            return true;
+        } else {
+            typed.push_back(hex);
+            if (typed.size() > digits)
+                typed.erase(typed.begin());
+        }
+        return false;
+    }
+};
+
+struct Config {
+    unsigned digits;
+    bool     control_keys;
+    unsigned backspace_key, enter_key;
+    uint64_t reset_value;
+};
+
+/* out_ready patterns: always ready, stalled in long stretches, random. */
+enum Readiness { ALWAYS, STRETCHES, RANDOM };
+
+int run_config(const Config& c, Readiness readiness, uint64_t cycles, unsigned seed)
+{
+    lab::HexEntry  dut(c.digits, c.control_keys, c.reset_value, c.backspace_key, c.enter_key);
+    EntryReference ref(c.digits, c.control_keys, c.backspace_key, c.enter_key, c.reset_value);
+    std::mt19937_64 rng(seed);
+    std::vector<uint64_t> accepted, received;
+    uint64_t accepted_count = 0, ignored = 0, backspaces = 0;
+    int errors = 0;
+    bool ready = true;
+
+    for (uint64_t t = 0; t < cycles; ++t) {
+        // control keys are made common so that the slot fills and stalls
+        unsigned r = unsigned(rng() % 16);
+        unsigned hex = r < 3 ? c.backspace_key : r < 5 ? c.enter_key : unsigned(rng() % 16);
+        bool activate = rng() % 8 != 0;
+        switch (readiness) {
+        case ALWAYS:    ready = true; break;
+        case STRETCHES: if (rng() % 64 == 0) ready = !ready; break;
+        case RANDOM:    ready = rng() % 2; break;
+        }
+
+        if (dut.out_valid && ready)
+            received.push_back(dut.out_data);
+        bool consumer_takes = ref.slot_full && ready;
+        if (consumer_takes)
+            ref.slot_full = false;
+        if (activate) {
+            bool was_full = ref.slot_full || consumer_takes;
+            bool enter = c.control_keys && hex == c.enter_key;
+            if (ref.key(hex, consumer_takes)) {
+                accepted.push_back(ref.slot);
+                ++accepted_count;
+            } else if (enter) {
+                ++ignored;
+                if (!was_full)
+                    ++errors;
+            }
+            backspaces += c.control_keys && hex == c.backspace_key;
+        }
+        dut.clock(hex, activate, ready);
+
+        if (dut.entry != ref.value() || dut.digit_count != ref.typed.size() ||
+            dut.out_valid != ref.slot_full || (ref.slot_full && dut.out_data != ref.slot)) {
+            if (errors < 5)
+                std::printf("    cycle %llu: entry %llx count %u valid %d data %llx, "
+                            "expected %llx %zu %d %llx\n", (unsigned long long)t,
+                            (unsigned long long)dut.entry, dut.digit_count, dut.out_valid,
+                            (unsigned long long)dut.out_data,
+                            (unsigned long long)ref.value(), ref.typed.size(),
+                            ref.slot_full, (unsigned long long)ref.slot);
+            ++errors;
+        }
+    }
+    if (dut.out_valid)
+        received.push_back(dut.out_data);
+    if (received != accepted)
+        ++errors;
+
+    std::printf("  DIGITS=%-2u CONTROL_KEYS=%d keys %X/%X ready=%-9s: %llu values "
+                "accepted, %llu enters ignored, %llu backspaces, %s\n",
+                c.digits, c.control_keys, c.backspace_key, c.enter_key,
+                readiness == ALWAYS ? "always" : readiness == STRETCHES ? "stretches"
+                                                                         : "random",
+                (unsigned long long)accepted_count, (unsigned long long)ignored,
+                (unsigned long long)backspaces, errors ? "FAIL" : "ok");
+    return errors;
+}
+
+/* Types keys on the lab3_hh keypad, each held 40 ms and released for
+   40 ms, longer than key_deactivator's 26 ms, and checks the displayed
+   digits after each one. */
+int run_lab3()
+{
+    struct Step {
+        unsigned key;
+        unsigned shown;     // {left, right} once the key has been read
+    };
+    const Step steps[] = {
+        {0xE, 0x04}, {0xE, 0x42}, {0x1, 0x01}, {0x2, 0x12}, {0xE, 0x01}, {0x3, 0x13}, {0xF, 0x13},
+        {0xA, 0x0A}, {0xE, 0x13}, {0xE, 0x13}, {0x7, 0x07}, {0x0, 0x70},
+        {0xC, 0x0C}, {0xF, 0x0C}, {0xF, 0x00}, {0x5, 0x05},
+    };
+    const uint64_t hold = lab::CLK_HZ / 25;
+
+    lab::Lab3 dut;
+    int errors = 0;
+    if (dut.shown() != 0x42) {
+        std::printf("  after reset: shown %02X, expected 42\n", dut.shown());
+        ++errors;
+    }
+    std::string typed;
+    for (const Step& s : steps) {
+        dut.keypad.held = int(lab::Keypad::index_of(s.key));
+        for (uint64_t t = 0; t < hold; ++t)
+            dut.clock();
+        dut.keypad.held = -1;
+        for (uint64_t t = 0; t < hold; ++t)
+            dut.clock();
+        char name[4];
+        std::snprintf(name, sizeof name, "%X ", s.key);
+        typed += name;
+        if (dut.shown() != s.shown) {
+            std::printf("  after %s: shown %02X, expected %02X\n", typed.c_str(),
+                        dut.shown(), s.shown);
+            ++errors;
+        }
+    }
+    std::printf("  lab3_hh keys %s: %s\n", typed.c_str(), errors ? "FAIL" : "ok");
+    return errors;
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    uint64_t cycles = argc > 1 ? std::strtoull(argv[1], nullptr, 0) : 2000000;
+
+    const Config configs[] = {
+        {2,  true,  0xE, 0xF, 0x42},        // as in hex_writer
+        {1,  true,  0xE, 0xF, 0},
+        {4,  true,  0xE, 0xF, 0x1234},
+        {8,  true,  0x0, 0x1, 0},
+        {16, true,  0xE, 0xF, 0},
+        {2,  false, 0xE, 0xF, 0x42},        // every key is a digit
+    };
+
+    int failures = 0;
+    unsigned seed = 1;
+    std::printf("hex_entry, keys on 7 of 8 clocks for %llu cycles\n",
+                (unsigned long long)cycles);
+    for (const Config& c : configs)
+        for (Readiness r : {ALWAYS, STRETCHES, RANDOM})
+            failures += run_config(c, r, cycles, seed++) != 0;
+
+    std::printf("hex_writer\n");
+    failures += run_lab3() != 0;
+    return failures ? 1 : 0;
+}
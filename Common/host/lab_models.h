@@ -0,0 +1,279 @@
+/*      lab_models.h
+        Cycle models of the lab top modules, lab1_hh, lab2_hh and
+        lab3_hh, built from the same submodules as the RTL so that each
+        register and named net can be probed every clock.
+
+        Each model has inputs as public members, clock() for one rising
+        edge of the 40 MHz clk, and probe(p), which reports every
+        register and net as p(name, value, width) in a fixed order. */
+
+#ifndef LAB_MODELS_H
+#define LAB_MODELS_H
+
+#include "seven_seg_model.h"
+#include "telemetry_model.h"
+#include "tick_model.h"
+
+#include <cstdint>
+
+namespace lab {
+
+const uint64_t CLK_HZ = 40000000;
+
+/*
+ * Lab1
+ *
+ * lab1_hh: the switches on the seven-segment digit and the LED bar,
+ * with a blinking led[7], and bus_telemetry watching s.
+ */
+struct Lab1 {
+    unsigned s = 0;
+
+    TickToggle                blinker{5, CLK_HZ};
+    telemetry::BusTelemetry   telemetry{4, 9, 1000000, CLK_HZ};
+
+    unsigned led() const
+    {
+        unsigned low = s & 7;
+        return (blinker.level << 7) | (((s >> 2) & (s >> 3) & 1) << 6) |
+               (((~low >> 2) & 1) << 5) | (((low >> 2) & 1) << 4) |
+               (((~low >> 1) & 1) << 3) | (((low >> 1) & 1) << 2) |
+               ((~low & 1) << 1) | (low & 1);
+    }
+
+    void clock()
+    {
+        blinker.clock();
+        telemetry.bus = s;
+        telemetry.clock();
+    }
+
+    template <class Probe>
+    void probe(Probe& p) const
+    {
+        p("s", s, 4);
+        p("seg", seven_seg::drive({true, true, false}, s), 7);
+        p("led", led(), 8);
+        p("blinker.gen.count", blinker.gen.count, 23);
+        p("blinker.level", blinker.level, 1);
+        telemetry.probe(p);
+    }
+};
+
+/*
+ * Lab2
+ *
+ * lab2_hh: the sum of two switch values, and both values shown on a
+ * pair of digits multiplexed at 152 Hz.
+ */
+struct Lab2 {
+    unsigned left_value = 0, right_value = 0;
+
+    TickToggle digit_select{305, CLK_HZ};
+
+    void clock() { digit_select.clock(); }
+
+    template <class Probe>
+    void probe(Probe& p) const
+    {
+        unsigned value = digit_select.level ? left_value : right_value;
+        p("left_value", left_value, 4);
+        p("right_value", right_value, 4);
+        p("sum", left_value + right_value, 5);
+        p("digit_select.gen.count", digit_select.gen.count, 18);
+        p("oscil", digit_select.level, 1);
+        p("value", value, 4);
+        p("seven_seg_digit", seven_seg::drive({true, true, false}, value), 7);
+    }
+};
+
+/*
+ * HexEntry
+ *
+ * hex_entry: up to digits hex digits, with the backspace and enter
+ * keys when control_keys is set, and out_data held until out_ready.
+ */
+struct HexEntry {
+    unsigned digits;
+    bool     control_keys;
+    unsigned backspace_key, enter_key;
+    uint64_t reset_value;
+
+    uint64_t entry = 0, out_data = 0;
+    unsigned digit_count = 0;
+    bool     out_valid = false;
+
+    HexEntry(unsigned digits_, bool control_keys_, uint64_t reset_value_,
+             unsigned backspace_key_ = 0xE, unsigned enter_key_ = 0xF)
+        : digits(digits_), control_keys(control_keys_),
+          backspace_key(backspace_key_), enter_key(enter_key_),
+          reset_value(reset_value_)
+    {
+        reset();
+    }
+
+    uint64_t entry_mask() const
+    {
+        return 4 * digits >= 64 ? ~uint64_t(0) : (uint64_t(1) << (4 * digits)) - 1;
+    }
+
+    void reset()
+    {
+        entry       = reset_value & entry_mask();
+        digit_count = reset_value != 0 ? digits : 0;
+        out_valid   = false;
+        out_data    = 0;
+    }
+
+    void clock(unsigned new_hex, bool activate, bool out_ready)
+    {
+        bool backspace = activate && control_keys && new_hex == backspace_key;
+        bool enter     = activate && control_keys && new_hex == enter_key;
+        bool digit     = activate && !backspace && !enter;
+        bool accept    = enter && (!out_valid || out_ready);
+        uint64_t old_entry = entry;
+        if (digit) {
+            entry = ((entry << 4) | new_hex) & entry_mask();
+            if (digit_count != digits)
+                ++digit_count;
+        } else if (backspace) {
+            entry >>= 4;
+            if (digit_count != 0)
+                --digit_count;
+        } else if (accept) {
+            entry       = 0;
+            digit_count = 0;
+        }
+        out_valid = accept ? true : out_ready ? false : out_valid;
+        out_data  = accept ? old_entry : out_data;
+    }
+};
+
+/*
+ * Keypad
+ *
+ * The 4x4 matrix keypad: which key is held, seen through key_reader as
+ * the contact of the key at a row and column.
+ */
+struct Keypad {
+    int held = -1;  // key_index {row, col} of the held key, or -1
+
+    bool contact(unsigned row, unsigned col) const
+    {
+        return held >= 0 && unsigned(held) == ((row << 2) | col);
+    }
+
+    /* key_index of the key labelled hex, as hex_generator maps them. */
+    static unsigned index_of(unsigned hex)
+    {
+        for (unsigned i = 0; i < 16; ++i)
+            if (hex_at(i) == hex)
+                return i;
+        return 0;
+    }
+
+    static unsigned hex_at(unsigned key_index)
+    {
+        static const unsigned map[16] = {0x1, 0x2, 0x3, 0xA, 0x4, 0x5, 0x6, 0xB,
+                                         0x7, 0x8, 0x9, 0xC, 0xE, 0x0, 0xF, 0xD};
+        return map[key_index & 15];
+    }
+};
+
+/*
+ * Lab3
+ *
+ * lab3_hh: the keypad scanner, stepping to the next key every cycle,
+ * debouncer and hex_writer, with E as backspace and F as enter.
+ */
+struct Lab3 {
+    Keypad keypad;
+
+    // hex_scanner
+    unsigned key_index = 0;
+    bool     read_signal = false;
+    unsigned read_hex = 0;
+
+    // hex_debouncer
+    bool     tracking = false, tracked_signal = false;
+    unsigned tracked_hex = 0;
+    uint32_t inactivity_counter = 0;
+
+    // hex_writer
+    HexEntry   accumulator{2, true, 0x42};
+    unsigned   entered = 0x42;
+    TickToggle digit_select{305, CLK_HZ};
+
+    static const unsigned COUNTDOWN_BITS = 20;
+
+    unsigned raw_hex() const { return Keypad::hex_at(key_index); }
+    bool     raw_signal() const { return keypad.contact(key_index >> 2, key_index & 3); }
+    bool     activate() const { return read_signal && !tracking; }
+    bool     deactivate() const
+    {
+        return inactivity_counter == (1u << COUNTDOWN_BITS) - 1;
+    }
+    unsigned shown() const
+    {
+        return accumulator.digit_count != 0 ? unsigned(accumulator.entry) : entered;
+    }
+    unsigned left_hex() const { return shown() >> 4; }
+    unsigned right_hex() const { return shown() & 15; }
+    unsigned value() const { return digit_select.level ? left_hex() : right_hex(); }
+
+    void clock()
+    {
+        bool     activate_now   = activate();
+        bool     deactivate_now = deactivate();
+        bool     raw            = raw_signal();
+        unsigned hex            = raw_hex();
+
+        if (accumulator.out_valid)
+            entered = unsigned(accumulator.out_data);
+        accumulator.clock(read_hex, activate_now, true);
+        digit_select.clock();
+
+        inactivity_counter = (tracking && !tracked_signal)
+                           ? (inactivity_counter + 1) & ((1u << COUNTDOWN_BITS) - 1) : 0;
+        tracked_signal = read_hex == tracked_hex ? read_signal : false;
+        tracked_hex    = activate_now ? read_hex : tracked_hex;
+        tracking       = deactivate_now ? false : activate_now ? true : tracking;
+
+        read_signal = raw;
+        read_hex    = hex;
+        key_index   = (key_index + 1) & 15;
+    }
+
+    template <class Probe>
+    void probe(Probe& p) const
+    {
+        unsigned row = key_index >> 2;
+        p("scanner.generator.key_index", key_index, 4);
+        p("scanner.raw_hex", raw_hex(), 4);
+        p("scanner.input_row", row, 2);
+        p("scanner.output_col", key_index & 3, 2);
+        p("row_values (driven)", 1u << row, 4);
+        p("scanner.raw_signal", raw_signal(), 1);
+        p("read_signal", read_signal, 1);
+        p("read_hex", read_hex, 4);
+        p("activate", activate(), 1);
+        p("debouncer.tracking", tracking, 1);
+        p("debouncer.tracker.tracked_hex", tracked_hex, 4);
+        p("debouncer.tracked_signal", tracked_signal, 1);
+        p("debouncer.deactivator.inactivity_counter", inactivity_counter, COUNTDOWN_BITS);
+        p("debouncer.deactivate", deactivate(), 1);
+        p("writer.accumulator.entry", accumulator.entry, 8);
+        p("writer.accumulator.digit_count", accumulator.digit_count, 2);
+        p("writer.accumulator.out_valid", accumulator.out_valid, 1);
+        p("writer.accumulator.out_data", accumulator.out_data, 8);
+        p("writer.entered", entered, 8);
+        p("writer.display.digit_select.gen.count", digit_select.gen.count, 18);
+        p("writer.display.oscil", digit_select.level, 1);
+        p("writer.display.value", value(), 4);
+        p("seven_seg_digit", seven_seg::drive({true, true, false}, value()), 7);
+    }
+};
+
+}  // namespace lab
+
+#endif
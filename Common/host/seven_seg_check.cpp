@@ -0,0 +1,301 @@
+/*      seven_seg_check.cpp
+        Exhaustive check of the shared seven-segment decoder
+        (Common/seven_seg_hh.sv) against the golden model in
+        seven_seg_model.h.
+
+        Build: g++ -std=c++17 -O2 -o seven_seg_check seven_seg_check.cpp
+        Usage: seven_seg_check [repo_root]
+
+        Reads the glyph_segments table and the pin mapping of
+        seven_seg_led from the RTL, evaluates the decoder for every
+        hex_value of all eight COMMON_ANODE/A_AT_LSB/EXTENDED variants,
+        and compares each seg value with the model. Then every
+        seven_seg_led instance in the lab sources is listed with the
+        variant its parameters select, and checked the same way.
+        repo_root defaults to ../.., for running from Common/host.
+
+        Exits with status 1 on any mismatch or if the RTL cannot be
+        parsed. */
+
+#include "seven_seg_model.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <regex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+namespace fs = std::filesystem;
+
+std::string read_file(const fs::path& path)
+{
+    std::ifstream in(path);
+    std::stringstream text;
+    text << in.rdbuf();
+    return text.str();
+}
+
+/* Blanks out // and block comments, keeping newlines so that offsets
+   still give line numbers. */
+std::string strip_comments(const std::string& text)
+{
+    std::string out = text;
+    for (size_t i = 0; i + 1 < out.size(); ++i) {
+        if (out[i] == '/' && out[i + 1] == '/') {
+            while (i < out.size() && out[i] != '\n')
+                out[i++] = ' ';
+        } else if (out[i] == '/' && out[i + 1] == '*') {
+            size_t end = out.find("*/", i + 2);
+            end = end == std::string::npos ? out.size() : end + 2;
+            for (; i < end; ++i)
+                if (out[i] != '\n')
+                    out[i] = ' ';
+            --i;
+        }
+    }
+    return out;
+}
+
+/*
+ * RtlDecoder
+ *
+ * seven_seg_led as written in the RTL: the glyph table from the case
+ * statement in glyph_segments, whether COMMON_ANODE inverts the
+ * segments, and which segment each seg bit carries for either value
+ * of A_AT_LSB.
+ */
+struct RtlDecoder {
+    int  table[seven_seg::GLYPHS];
+    bool anode_inverts = false;
+    int  pin_segment[2][7];         // [A_AT_LSB][pin] -> 0 for a ... 6 for g
+
+    bool parse(const std::string& source);
+    uint8_t drive(const seven_seg::Variant& v, unsigned hex_value) const;
+};
+
+/* Reads a concatenation such as {g,f,e,d,c,b,a}: the first name is the
+   most significant, so it lands on pin 6. */
+bool parse_pins(const std::string& concat, int pin_segment[7])
+{
+    std::vector<int> names;
+    for (char ch : concat)
+        if (ch >= 'a' && ch <= 'g')
+            names.push_back(ch - 'a');
+    if (names.size() != 7)
+        return false;
+    for (int pin = 0; pin < 7; ++pin)
+        pin_segment[pin] = names[6 - pin];
+    return true;
+}
+
+bool RtlDecoder::parse(const std::string& source)
+{
+    std::string text = strip_comments(source);
+
+    std::map<std::string, int> glyph_names;
+    std::regex name_re(R"(localparam\s+logic\s*\[4:0\]\s*(GLYPH_\w+)\s*=\s*5'h([0-9A-Fa-f]+))");
+    for (std::sregex_iterator m(text.begin(), text.end(), name_re), end; m != end; ++m)
+        glyph_names[(*m)[1]] = std::stoi((*m)[2], nullptr, 16);
+
+    for (int& bits : table)
+        bits = -1;
+    size_t start = text.find("function automatic logic [6:0] glyph_segments");
+    size_t stop  = text.find("endfunction", start);
+    if (start == std::string::npos || stop == std::string::npos)
+        return false;
+    std::string body = text.substr(start, stop - start);
+    std::regex item_re(R"((5'h[0-9A-Fa-f]+|GLYPH_\w+)\s*:\s*return\s+7'b([01]{7})\s*;)");
+    for (std::sregex_iterator m(body.begin(), body.end(), item_re), end; m != end; ++m) {
+        std::string label = (*m)[1];
+        int glyph;
+        if (label.compare(0, 3, "5'h") == 0)
+            glyph = std::stoi(label.substr(3), nullptr, 16);
+        else if (glyph_names.count(label))
+            glyph = glyph_names[label];
+        else
+            return false;
+        if (glyph >= int(seven_seg::GLYPHS) || table[glyph] != -1)
+            return false;
+        table[glyph] = std::stoi((*m)[2], nullptr, 2);
+    }
+    for (int bits : table)
+        if (bits < 0)
+            return false;
+
+    start = text.find("module seven_seg_led");
+    stop  = text.find("endmodule", start);
+    if (start == std::string::npos || stop == std::string::npos)
+        return false;
+    body = text.substr(start, stop - start);
+    anode_inverts = std::regex_search(body,
+        std::regex(R"(if\s*\(\s*COMMON_ANODE\s*\)\s*\{a,b,c,d,e,f,g\}\s*=\s*~\s*\{a,b,c,d,e,f,g\})"));
+    std::smatch m;
+    if (!std::regex_search(body, m,
+            std::regex(R"(seg\s*=\s*A_AT_LSB\s*\?\s*(\{[a-g,\s]+\})\s*:\s*(\{[a-g,\s]+\}))")))
+        return false;
+    return parse_pins(m[1], pin_segment[1]) && parse_pins(m[2], pin_segment[0]);
+}
+
+/* hex_value is VALUE_BITS wide and zero extended to 5 bits, so the
+   narrow decoder only reaches the first 16 glyphs. */
+uint8_t RtlDecoder::drive(const seven_seg::Variant& v, unsigned hex_value) const
+{
+    unsigned glyph = hex_value & (v.extended ? 0x1F : 0x0F);
+    unsigned lit   = unsigned(table[glyph]);
+    if (v.common_anode && anode_inverts)
+        lit = ~lit & 0x7F;
+    uint8_t seg = 0;
+    for (int pin = 0; pin < 7; ++pin)
+        if ((lit >> (6 - pin_segment[v.a_at_lsb][pin])) & 1)
+            seg |= uint8_t(1u << pin);
+    return seg;
+}
+
+std::string variant_name(const seven_seg::Variant& v)
+{
+    char name[64];
+    std::snprintf(name, sizeof name, "COMMON_ANODE=%d A_AT_LSB=%d EXTENDED=%d",
+                  v.common_anode, v.a_at_lsb, v.extended);
+    return name;
+}
+
+/* Compares every value of a variant; returns the number of mismatches. */
+int check_variant(const RtlDecoder& rtl, const seven_seg::Variant& v)
+{
+    int mismatches = 0;
+    for (unsigned value = 0; value < seven_seg::value_count(v); ++value) {
+        uint8_t got  = rtl.drive(v, value);
+        uint8_t want = seven_seg::drive(v, value);
+        if (got != want) {
+            if (mismatches < 8)
+                std::printf("  %s hex_value %02X: seg %02X, expected %02X (%s)\n",
+                            variant_name(v).c_str(), value, got, want,
+                            seven_seg::glyph_letters(value));
+            ++mismatches;
+        }
+    }
+    return mismatches;
+}
+
+struct Instance {
+    std::string         file;
+    int                 line;
+    std::string         name;
+    seven_seg::Variant  variant;
+};
+
+bool parse_bit(const std::string& value, bool& bit)
+{
+    std::smatch m;
+    if (!std::regex_match(value, m, std::regex(R"(\s*(?:1'[bBdDhH])?([01])\s*)")))
+        return false;
+    bit = m[1] == "1";
+    return true;
+}
+
+/* Finds the seven_seg_led instances in a source file, applying named
+   or positional overrides to the defaults of 1, 1, 0. */
+bool find_instances(const fs::path& path, const fs::path& root,
+                    std::vector<Instance>& instances)
+{
+    std::string text = strip_comments(read_file(path));
+    std::regex inst_re(R"(\bseven_seg_led\s*(?:#\s*\(([^;]*?)\)\s*)?(\w+)\s*\()");
+    for (std::sregex_iterator m(text.begin(), text.end(), inst_re), end; m != end; ++m) {
+        size_t at = size_t(m->position(0));
+        if (at >= 7 && text.compare(at - 7, 7, "module ") == 0)
+            continue;
+        Instance inst;
+        inst.file    = fs::relative(path, root).string();
+        inst.line    = 1 + int(std::count(text.begin(), text.begin() + long(at), '\n'));
+        inst.name    = (*m)[2];
+        inst.variant = {true, true, false};
+        std::string params = (*m)[1];
+        bool* fields[3] = {&inst.variant.common_anode, &inst.variant.a_at_lsb,
+                           &inst.variant.extended};
+        const char* names[3] = {"COMMON_ANODE", "A_AT_LSB", "EXTENDED"};
+        if (params.find('.') != std::string::npos) {
+            std::regex named_re(R"(\.(\w+)\s*\(([^)]*)\))");
+            for (std::sregex_iterator p(params.begin(), params.end(), named_re), pend;
+                 p != pend; ++p) {
+                int field = -1;
+                for (int i = 0; i < 3; ++i)
+                    if ((*p)[1] == names[i])
+                        field = i;
+                if (field < 0 || !parse_bit((*p)[2], *fields[field])) {
+                    std::printf("%s:%d: cannot read parameter %s\n", inst.file.c_str(),
+                                inst.line, std::string((*p)[0]).c_str());
+                    return false;
+                }
+            }
+        } else if (!params.empty()) {
+            std::stringstream list(params);
+            std::string value;
+            for (int i = 0; std::getline(list, value, ','); ++i)
+                if (i >= 3 || !parse_bit(value, *fields[i])) {
+                    std::printf("%s:%d: cannot read parameters (%s)\n",
+                                inst.file.c_str(), inst.line, params.c_str());
+                    return false;
+                }
+        }
+        instances.push_back(inst);
+    }
+    return true;
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    fs::path root = argc > 1 ? argv[1] : "../..";
+    fs::path decoder_file = root / "Common" / "seven_seg_hh.sv";
+
+    RtlDecoder rtl;
+    if (!rtl.parse(read_file(decoder_file))) {
+        std::printf("cannot parse the decoder in %s\n", decoder_file.string().c_str());
+        return 1;
+    }
+    if (!rtl.anode_inverts)
+        std::printf("note: COMMON_ANODE does not invert the segments in the RTL\n");
+
+    int failures = 0;
+    for (int bits = 0; bits < 8; ++bits) {
+        seven_seg::Variant v = {bool(bits & 4), bool(bits & 2), bool(bits & 1)};
+        int mismatches = check_variant(rtl, v);
+        std::printf("%s: %2u values, %s\n", variant_name(v).c_str(),
+                    seven_seg::value_count(v), mismatches ? "MISMATCH" : "ok");
+        failures += mismatches;
+    }
+
+    std::vector<Instance> instances;
+    for (const auto& entry : fs::recursive_directory_iterator(root)) {
+        if (!entry.is_regular_file() || entry.path().extension() != ".sv")
+            continue;
+        if (!find_instances(entry.path(), root, instances))
+            ++failures;
+    }
+    std::sort(instances.begin(), instances.end(),
+              [](const Instance& a, const Instance& b) {
+                  return a.file != b.file ? a.file < b.file : a.line < b.line;
+              });
+    for (const Instance& inst : instances) {
+        int mismatches = check_variant(rtl, inst.variant);
+        std::printf("%s:%d %s (%s): %s\n", inst.file.c_str(), inst.line,
+                    inst.name.c_str(), variant_name(inst.variant).c_str(),
+                    mismatches ? "MISMATCH" : "ok");
+        failures += mismatches;
+    }
+    if (instances.empty()) {
+        std::printf("no seven_seg_led instances found under %s\n", root.string().c_str());
+        ++failures;
+    }
+
+    std::printf("%zu instances, %s\n", instances.size(), failures ? "FAILED" : "all match");
+    return failures ? 1 : 0;
+}
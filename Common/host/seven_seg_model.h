@@ -0,0 +1,78 @@
+/*      seven_seg_model.h
+        C++ golden model of the seven-segment decoder in
+        Common/seven_seg_hh.sv, for checking the RTL and for the lab
+        models that drive a digit.
+
+        Glyphs are written here as the letters of the lit segments,
+        independently of the bit vectors in seven_seg_pkg, so a typo in
+        either table shows up as a mismatch. drive() gives the value of
+        the seg pins for a glyph under each combination of the
+        COMMON_ANODE and A_AT_LSB parameters. */
+
+#ifndef SEVEN_SEG_MODEL_H
+#define SEVEN_SEG_MODEL_H
+
+#include <cstdint>
+
+namespace seven_seg {
+
+const unsigned GLYPHS       = 32;   // 0x00-0x0F hex digits, 0x10-0x1F extras
+const unsigned DIGIT_GLYPHS = 16;
+
+/* The lit segments of each glyph code, as in seven_seg_pkg. */
+inline const char* glyph_letters(unsigned glyph)
+{
+    static const char* const table[GLYPHS] = {
+        "abcdef",  "bc",     "abdeg",  "abcdg",    // 0 1 2 3
+        "bcfg",    "acdfg",  "acdefg", "abc",      // 4 5 6 7
+        "abcdefg", "abcdfg", "abcefg", "cdefg",    // 8 9 A b
+        "adef",    "bcdeg",  "adefg",  "aefg",     // C d E F
+        "",        "g",      "bcefg",  "def",      // blank - H L
+        "abefg",   "bcdef",  "eg",     "ceg",      // P U r n
+        "cdeg",    "defg",   "bcdfg",  "bcd",      // o t y J
+        "acdef",   "cefg",   "cde",    "abfg",     // G h u degree
+    };
+    return glyph < GLYPHS ? table[glyph] : "";
+}
+
+/* The lit segments as {a,b,c,d,e,f,g}, a in bit 6, as glyph_segments
+   returns them. */
+inline uint8_t glyph_segments(unsigned glyph)
+{
+    uint8_t bits = 0;
+    for (const char* s = glyph_letters(glyph); *s; ++s)
+        bits |= uint8_t(1u << (6 - (*s - 'a')));
+    return bits;
+}
+
+struct Variant {
+    bool common_anode;
+    bool a_at_lsb;
+    bool extended;
+};
+
+/* The values hex_value can take in a decoder built as variant. */
+inline unsigned value_count(const Variant& v)
+{
+    return v.extended ? GLYPHS : DIGIT_GLYPHS;
+}
+
+/* seven_seg_led: the seg pins for hex_value. Pin i shows segment a+i
+   when A_AT_LSB is set and segment g-i otherwise; a lit segment is
+   driven 0 on a common anode display and 1 on a common cathode one. */
+inline uint8_t drive(const Variant& v, unsigned hex_value)
+{
+    uint8_t lit = glyph_segments(hex_value % value_count(v));
+    uint8_t seg = 0;
+    for (unsigned pin = 0; pin < 7; ++pin) {
+        unsigned segment = v.a_at_lsb ? pin : 6 - pin;   // 0 is a
+        bool     on      = (lit >> (6 - segment)) & 1;
+        if (on != v.common_anode)
+            seg |= uint8_t(1u << pin);
+    }
+    return seg;
+}
+
+}  // namespace seven_seg
+
+#endif
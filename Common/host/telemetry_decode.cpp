@@ -0,0 +1,153 @@
+/*      telemetry_decode.cpp
+        Host-side decoder for the bus_telemetry UART stream
+        (Common/telemetry_hh.sv).
+
+        Build: g++ -std=c++17 -O2 -o telemetry_decode telemetry_decode.cpp
+        Usage: telemetry_decode [bus_width] [capture_file]
+
+        Reads the raw byte stream from capture_file, or from stdin when no
+        file is given (e.g. a serial port configured for 1 Mbaud 8N1 and
+        redirected in), and prints one line per event:
+
+            <time_us> <value in hex> [dropped]
+
+        A summary of the decoded events is printed to stderr at the end. */
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+namespace {
+
+const uint8_t HEADER         = 0xA5;
+const uint8_t HEADER_DROPPED = 0xA6;
+
+struct TelemetryEvent {
+    uint32_t time_us;
+    uint64_t value;
+    bool     dropped_before;
+};
+
+/*
+ * TelemetryDecoder
+ *
+ * Reassembles frames from a byte stream that may start mid-frame or
+ * contain corrupted bytes. Bytes are collected from a header byte until
+ * a full frame is present; if the checksum does not match, decoding
+ * resynchronizes on the next header byte within the rejected bytes.
+ */
+class TelemetryDecoder {
+public:
+    explicit TelemetryDecoder(unsigned bus_width)
+        : value_bytes_((bus_width + 7) / 8),
+          frame_bytes_(1 + 4 + value_bytes_ + 1) {}
+
+    /*
+     * push
+     *
+     * Feeds one received byte to the decoder.
+     *
+     * Returns:
+     *  True if the byte completed a valid frame, which is written to *ev.
+     */
+    bool push(uint8_t byte, TelemetryEvent* ev)
+    {
+        if (pending_.empty() && byte != HEADER && byte != HEADER_DROPPED) {
+            ++skipped_bytes_;
+            return false;
+        }
+        pending_.push_back(byte);
+        if (pending_.size() < frame_bytes_) return false;
+
+        if (checksum_ok()) {
+            decode(ev);
+            pending_.clear();
+            return true;
+        }
+
+        // Drop the bad header and rescan the remaining bytes for a new one.
+        ++checksum_errors_;
+        std::vector<uint8_t> rest(pending_.begin() + 1, pending_.end());
+        pending_.clear();
+        ++skipped_bytes_;
+        for (uint8_t b : rest) {
+            if (push(b, ev)) return true;
+        }
+        return false;
+    }
+
+    unsigned long checksum_errors() const { return checksum_errors_; }
+    unsigned long skipped_bytes() const { return skipped_bytes_; }
+
+private:
+    bool checksum_ok() const
+    {
+        uint8_t sum = 0;
+        for (size_t i = 0; i + 1 < frame_bytes_; ++i) sum ^= pending_[i];
+        return sum == pending_[frame_bytes_ - 1];
+    }
+
+    void decode(TelemetryEvent* ev) const
+    {
+        ev->dropped_before = (pending_[0] == HEADER_DROPPED);
+        ev->time_us = 0;
+        for (int i = 3; i >= 0; --i) ev->time_us = (ev->time_us << 8) | pending_[1 + i];
+        ev->value = 0;
+        for (int i = static_cast<int>(value_bytes_) - 1; i >= 0; --i)
+            ev->value = (ev->value << 8) | pending_[5 + i];
+    }
+
+    size_t               value_bytes_;
+    size_t               frame_bytes_;
+    std::vector<uint8_t> pending_;
+    unsigned long        checksum_errors_ = 0;
+    unsigned long        skipped_bytes_   = 0;
+};
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    unsigned bus_width = (argc > 1) ? std::strtoul(argv[1], nullptr, 0) : 4;
+    if (bus_width == 0 || bus_width > 64) {
+        std::fprintf(stderr, "bus_width must be between 1 and 64\n");
+        return 1;
+    }
+
+    FILE* in = stdin;
+    if (argc > 2) {
+        in = std::fopen(argv[2], "rb");
+        if (!in) {
+            std::perror(argv[2]);
+            return 1;
+        }
+    }
+
+    TelemetryDecoder decoder(bus_width);
+    TelemetryEvent   ev;
+    unsigned long    events = 0, drop_marks = 0;
+    uint32_t         first_us = 0, last_us = 0;
+    int              c;
+
+    while ((c = std::fgetc(in)) != EOF) {
+        if (!decoder.push(static_cast<uint8_t>(c), &ev)) continue;
+        if (events == 0) first_us = ev.time_us;
+        last_us = ev.time_us;
+        ++events;
+        drop_marks += ev.dropped_before;
+        std::printf("%10lu 0x%llx%s\n", static_cast<unsigned long>(ev.time_us),
+                    static_cast<unsigned long long>(ev.value),
+                    ev.dropped_before ? " dropped" : "");
+    }
+    if (in != stdin) std::fclose(in);
+
+    double span_s = (last_us - first_us) / 1e6;
+    std::fprintf(stderr, "%lu events, %lu after drops, %lu checksum errors, "
+                 "%lu bytes skipped",
+                 events, drop_marks, decoder.checksum_errors(), decoder.skipped_bytes());
+    if (events > 1 && span_s > 0)
+        std::fprintf(stderr, ", %.1f events/s", (events - 1) / span_s);
+    std::fprintf(stderr, "\n");
+    return 0;
+}
@@ -0,0 +1,222 @@
+/*      telemetry_model.h
+        Cycle model of bus_telemetry (Common/telemetry_hh.sv): the
+        change_timestamper, sync_fifo, telemetry_framer and uart_tx
+        registers, updated once per rising edge of clk, plus a UART
+        receiver for checking what comes out of tx.
+
+        Buses up to 24 bits wide are modeled, enough for a 64 bit
+        frame register. */
+
+#ifndef TELEMETRY_MODEL_H
+#define TELEMETRY_MODEL_H
+
+#include "tick_model.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace telemetry {
+
+const uint8_t HEADER         = 0xA5;
+const uint8_t HEADER_DROPPED = 0xA6;
+
+/*
+ * BusTelemetry
+ *
+ * The registers of bus_telemetry. Set bus before each clock(); the
+ * outputs tx and overflow are those of the current cycle.
+ */
+class BusTelemetry {
+public:
+    BusTelemetry(unsigned width, unsigned fifo_addr_bits,
+                 uint64_t baud, uint64_t clk_hz)
+        : width_(width),
+          value_bytes_((width + 7) / 8),
+          frame_bytes_(1 + 4 + value_bytes_ + 1),
+          addr_bits_(fifo_addr_bits),
+          us_tick_(1000000, clk_hz),
+          ram_(size_t(1) << fifo_addr_bits),
+          baud_tick_(baud, clk_hz)
+    {
+    }
+
+    uint64_t bus = 0;
+
+    bool     tx() const { return tx_; }
+    bool     overflow() const { return overflow_; }
+    bool     idle() const { return state_ == IDLE && bits_left_ == 0; }
+    unsigned frame_bytes() const { return frame_bytes_; }
+    unsigned queued() const { return unsigned(write_ptr_ - read_ptr_) & depth_mask(); }
+    bool     full() const { return write_ptr_ == (read_ptr_ ^ (1u << addr_bits_)); }
+
+    /* Reports each register as probe(name, value, width), in a fixed
+       order, for the activity report. */
+    template <class Probe>
+    void probe(Probe& p) const
+    {
+        p("meta", meta_, width_);
+        p("synced", synced_, width_);
+        p("previous", previous_, width_);
+        p("timestamp", timestamp_, 32);
+        p("us_tick.count", us_tick_.count, 6);
+        p("dropped", dropped_, 1);
+        p("overflow", overflow_, 1);
+        p("fifo.write_ptr", write_ptr_, addr_bits_ + 1);
+        p("fifo.read_ptr", read_ptr_, addr_bits_ + 1);
+        p("fifo.pop_data", pop_data_, width_ + 33);
+        p("framer.state", state_, 2);
+        p("framer.frame", frame_, 8 * (frame_bytes_ - 1));
+        p("framer.checksum", checksum_, 8);
+        p("framer.bytes_left", bytes_left_, 3);
+        p("uart.shifter", shifter_, 10);
+        p("uart.bits_left", bits_left_, 4);
+        p("uart.baud.count", baud_tick_.count, 6);
+        p("tx", tx_, 1);
+    }
+
+    void clock()
+    {
+        // change_timestamper
+        bool     fifo_empty = write_ptr_ == read_ptr_;
+        bool     fifo_full  = full();
+        bool     changed    = synced_ != previous_;
+        bool     push       = changed && !fifo_full;
+        uint64_t event_data = (uint64_t(dropped_) << (width_ + 32)) |
+                              (uint64_t(timestamp_) << width_) | synced_;
+
+        // telemetry_framer and uart_tx
+        bool    busy     = bits_left_ != 0;
+        bool    pop      = state_ == IDLE && !fifo_empty;
+        bool    start    = state_ == SEND && !busy;
+        uint8_t byte_out = bytes_left_ == 1 ? checksum_ : uint8_t(frame_);
+
+        previous_ = synced_;
+        synced_   = meta_;
+        meta_     = bus & value_mask();
+        if (us_tick_.tick())
+            ++timestamp_;
+        dropped_  = (changed && fifo_full) ? true : push ? false : dropped_;
+        overflow_ = overflow_ || (changed && fifo_full);
+        us_tick_.clock();
+
+        uint64_t read_word = ram_[read_ptr_ & depth_mask()];
+        if (push)
+            ram_[write_ptr_ & depth_mask()] = event_data;
+        write_ptr_ = (write_ptr_ + push) & ptr_mask();
+        read_ptr_  = (read_ptr_ + (pop && !fifo_empty)) & ptr_mask();
+
+        switch (state_) {
+        case IDLE:
+            state_ = fifo_empty ? IDLE : LOAD;
+            break;
+        case LOAD: {
+            uint64_t value = pop_data_ & value_mask();
+            uint64_t stamp = (pop_data_ >> width_) & 0xFFFFFFFFu;
+            bool     drop  = (pop_data_ >> (width_ + 32)) & 1;
+            frame_      = (value << 40) | (stamp << 8) | (drop ? HEADER_DROPPED : HEADER);
+            checksum_   = 0;
+            bytes_left_ = frame_bytes_;
+            state_      = SEND;
+            break;
+        }
+        case SEND:
+            if (start) {
+                frame_ >>= 8;
+                checksum_ ^= byte_out;
+                --bytes_left_;
+                state_ = bytes_left_ == 0 ? IDLE : SEND;
+            }
+            break;
+        }
+        pop_data_ = read_word;
+
+        if (start && !busy) {
+            shifter_   = 0x200u | (unsigned(byte_out) << 1);
+            bits_left_ = 10;
+        } else if (baud_tick_.tick() && busy) {
+            tx_        = shifter_ & 1;
+            shifter_   = 0x200u | (shifter_ >> 1);
+            --bits_left_;
+        }
+        baud_tick_.clock();
+    }
+
+private:
+    enum State { IDLE, LOAD, SEND };
+
+    uint64_t value_mask() const { return (uint64_t(1) << width_) - 1; }
+    unsigned depth_mask() const { return (1u << addr_bits_) - 1; }
+    unsigned ptr_mask() const { return (2u << addr_bits_) - 1; }
+
+    unsigned width_, value_bytes_, frame_bytes_, addr_bits_;
+
+    uint64_t meta_ = 0, synced_ = 0, previous_ = 0;
+    uint32_t timestamp_ = 0;
+    bool     dropped_ = false, overflow_ = false;
+    TickGen  us_tick_;
+
+    std::vector<uint64_t> ram_;
+    unsigned write_ptr_ = 0, read_ptr_ = 0;
+    uint64_t pop_data_ = 0;
+
+    State    state_ = IDLE;
+    uint64_t frame_ = 0;
+    uint8_t  checksum_ = 0;
+    unsigned bytes_left_ = 0;
+
+    TickGen  baud_tick_;
+    unsigned shifter_ = 0x3FF, bits_left_ = 0;
+    bool     tx_ = true;
+};
+
+/*
+ * UartReceiver
+ *
+ * Recovers 8N1 bytes from a tx line sampled once per clock: a falling
+ * edge starts a byte, and each bit is sampled in the middle of its
+ * period. A missing stop bit counts as a framing error.
+ */
+class UartReceiver {
+public:
+    explicit UartReceiver(uint64_t clocks_per_bit) : bit_(clocks_per_bit) {}
+
+    std::vector<uint8_t> bytes;
+    unsigned             framing_errors = 0;
+
+    void sample(bool line)
+    {
+        if (!receiving_) {
+            if (last_ && !line) {
+                receiving_ = true;
+                count_     = 0;
+                bit_index_ = 0;
+                shift_     = 0;
+            }
+        } else if (++count_ == bit_ / 2 + bit_ * bit_index_) {
+            if (bit_index_ == 0 && line) {
+                receiving_ = false;     // a glitch, not a start bit
+            } else if (bit_index_ >= 1 && bit_index_ <= 8) {
+                shift_ |= unsigned(line) << (bit_index_ - 1);
+            } else if (bit_index_ == 9) {
+                if (line)
+                    bytes.push_back(uint8_t(shift_));
+                else
+                    ++framing_errors;
+                receiving_ = false;
+            }
+            ++bit_index_;
+        }
+        last_ = line;
+    }
+
+private:
+    uint64_t bit_;
+    bool     last_ = true, receiving_ = false;
+    uint64_t count_ = 0;
+    unsigned bit_index_ = 0, shift_ = 0;
+};
+
+}  // namespace telemetry
+
+#endif
@@ -0,0 +1,244 @@
+/*      telemetry_rate.cpp
+        Sustained event rate test for bus_telemetry
+        (Common/telemetry_hh.sv), run on the cycle model in
+        telemetry_model.h.
+
+        Build: g++ -std=c++17 -O2 -o telemetry_rate telemetry_rate.cpp
+        Usage: telemetry_rate [fifo_addr_bits]
+
+        Drives the bus of a 4 bit bus_telemetry at 40 MHz and 1 Mbaud,
+        as in lab1_hh, with steady, random and bursty change patterns,
+        receives tx with a UART model, and checks every frame: header,
+        checksum, value and timestamp against the change that caused it.
+        For each pattern it reports the events driven and received, the
+        deepest the FIFO got, the worst delay from a change to the end
+        of its frame, and whether overflow was raised.
+
+        A frame takes 70 us at 1 Mbaud, so changes up to about 14000/s
+        are sustained indefinitely, and bursts above that are absorbed
+        by the FIFO up to its depth. The patterns marked "must not drop"
+        fail the test if any event is lost; the overload pattern must
+        raise overflow and flag the gap with an A6 header. */
+
+#include "telemetry_model.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+const uint64_t CLK_HZ = 40000000;
+const uint64_t BAUD   = 1000000;
+const unsigned WIDTH  = 4;
+
+struct Change {
+    uint64_t cycle;
+    uint64_t value;
+};
+
+struct Pattern {
+    std::string           name;
+    std::vector<uint64_t> cycles;   // when the bus changes
+    bool                  must_not_drop;
+};
+
+/* Cycles at a fixed rate for a duration. */
+std::vector<uint64_t> steady(double per_second, double seconds)
+{
+    std::vector<uint64_t> cycles;
+    double step = double(CLK_HZ) / per_second;
+    for (double t = step; t < seconds * CLK_HZ; t += step)
+        cycles.push_back(uint64_t(t));
+    return cycles;
+}
+
+/* Poisson arrivals at a mean rate, at least 4 cycles apart so the
+   synchronizer sees every change. */
+std::vector<uint64_t> random_arrivals(double per_second, double seconds, unsigned seed)
+{
+    std::mt19937_64 rng(seed);
+    std::exponential_distribution<double> gap(per_second / CLK_HZ);
+    std::vector<uint64_t> cycles;
+    uint64_t t = 0;
+    while (true) {
+        t += 4 + uint64_t(gap(rng));
+        if (t >= seconds * CLK_HZ)
+            return cycles;
+        cycles.push_back(t);
+    }
+}
+
+/* count changes 1 us apart, repeated after a quiet gap. */
+std::vector<uint64_t> bursts(unsigned count, unsigned repeats, double gap_seconds)
+{
+    std::vector<uint64_t> cycles;
+    uint64_t t = CLK_HZ / 1000;
+    for (unsigned r = 0; r < repeats; ++r) {
+        for (unsigned i = 0; i < count; ++i)
+            cycles.push_back(t + i * (CLK_HZ / 1000000));
+        t += count * (CLK_HZ / 1000000) + uint64_t(gap_seconds * CLK_HZ);
+    }
+    return cycles;
+}
+
+struct Frame {
+    bool     dropped_before;
+    uint32_t time_us;
+    uint64_t value;
+};
+
+struct Result {
+    size_t   driven = 0, received = 0;
+    unsigned max_queued = 0;
+    double   worst_delay_us = 0;
+    bool     overflow = false;
+    unsigned gaps_flagged = 0;
+    unsigned errors = 0;
+};
+
+/* Splits the received bytes into frames; any byte that does not fit
+   the format is an error, since the line is noise free. */
+std::vector<Frame> parse_frames(const std::vector<uint8_t>& bytes,
+                                unsigned frame_bytes, unsigned& errors)
+{
+    std::vector<Frame> frames;
+    size_t i = 0;
+    while (i + frame_bytes <= bytes.size()) {
+        uint8_t header = bytes[i];
+        uint8_t check  = 0;
+        for (unsigned k = 0; k < frame_bytes; ++k)
+            check ^= bytes[i + k];
+        if ((header != telemetry::HEADER && header != telemetry::HEADER_DROPPED) || check) {
+            ++errors;
+            ++i;
+            continue;
+        }
+        Frame f;
+        f.dropped_before = header == telemetry::HEADER_DROPPED;
+        f.time_us = 0;
+        for (int k = 3; k >= 0; --k)
+            f.time_us = (f.time_us << 8) | bytes[i + 1 + k];
+        f.value = 0;
+        for (int k = int(frame_bytes) - 7; k >= 0; --k)
+            f.value = (f.value << 8) | bytes[i + 5 + k];
+        frames.push_back(f);
+        i += frame_bytes;
+    }
+    if (i != bytes.size())
+        ++errors;
+    return frames;
+}
+
+Result run(const Pattern& pattern, unsigned fifo_addr_bits)
+{
+    telemetry::BusTelemetry  dut(WIDTH, fifo_addr_bits, BAUD, CLK_HZ);
+    telemetry::UartReceiver  rx(CLK_HZ / BAUD);
+    std::vector<Change>      changes;
+    std::vector<uint64_t>    frame_end;     // cycle each frame finished
+    Result                   result;
+
+    // each change moves to a different value, so none is invisible
+    std::mt19937 rng(1);
+    uint64_t value = 0;
+    size_t   next = 0;
+    uint64_t last_change = pattern.cycles.empty() ? 0 : pattern.cycles.back();
+    uint64_t frame_cycles = uint64_t(dut.frame_bytes()) * 10 * (CLK_HZ / BAUD);
+    uint64_t end = last_change + (uint64_t(1) << fifo_addr_bits) * (frame_cycles + 200) +
+                   CLK_HZ / 1000;
+
+    for (uint64_t cycle = 0; cycle < end; ++cycle) {
+        if (next < pattern.cycles.size() && pattern.cycles[next] == cycle) {
+            value ^= 1 + rng() % ((1u << WIDTH) - 1);
+            changes.push_back({cycle, value});
+            ++next;
+        }
+        dut.bus = value;
+        size_t bytes_before = rx.bytes.size();
+        dut.clock();
+        rx.sample(dut.tx());
+        if (rx.bytes.size() != bytes_before && rx.bytes.size() % dut.frame_bytes() == 0)
+            frame_end.push_back(cycle);
+        if (dut.queued() > result.max_queued || dut.full())
+            result.max_queued = dut.full() ? 1u << fifo_addr_bits : dut.queued();
+        // done once the queue has drained and the last frame is in
+        if (next == pattern.cycles.size() && cycle > last_change + 4 &&
+            dut.queued() == 0 && dut.idle() && rx.bytes.size() % dut.frame_bytes() == 0)
+            break;
+    }
+
+    std::vector<Frame> frames = parse_frames(rx.bytes, dut.frame_bytes(), result.errors);
+    result.errors  += rx.framing_errors;
+    result.driven   = changes.size();
+    result.received = frames.size();
+    result.overflow = dut.overflow();
+
+    // match frames to changes in order, by value and timestamp. The
+    // change is registered by the second synchronizer stage 2 clocks
+    // after it is applied, and stamped with the microseconds counted
+    // by then. A change may only be skipped if the next frame is flagged.
+    size_t c = 0;
+    for (size_t f = 0; f < frames.size(); ++f) {
+        size_t skipped = 0;
+        while (c < changes.size() &&
+               (changes[c].value != frames[f].value ||
+                frames[f].time_us != (changes[c].cycle + 2) / (CLK_HZ / 1000000))) {
+            ++c;
+            ++skipped;
+        }
+        if (c == changes.size()) {
+            ++result.errors;
+            break;
+        }
+        if ((skipped != 0) != frames[f].dropped_before)
+            ++result.errors;
+        if (frames[f].dropped_before)
+            ++result.gaps_flagged;
+        if (f < frame_end.size()) {
+            double delay = double(frame_end[f] - changes[c].cycle) / (CLK_HZ / 1000000);
+            if (delay > result.worst_delay_us)
+                result.worst_delay_us = delay;
+        }
+        ++c;
+    }
+    return result;
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    unsigned fifo_addr_bits = argc > 1 ? unsigned(std::atoi(argv[1])) : 9;
+    unsigned depth = 1u << fifo_addr_bits;
+
+    std::vector<Pattern> patterns = {
+        {"steady 10000/s, 0.5 s",        steady(10000, 0.5),                 true},
+        {"steady 14000/s, 0.5 s",        steady(14000, 0.5),                 true},
+        {"random mean 12000/s, 1 s",     random_arrivals(12000, 1.0, 7),     true},
+        {"bursts of depth-16 at 1 MHz",  bursts(depth - 16, 4, 0.05),        true},
+        {"bursts of 2*depth at 1 MHz",   bursts(2 * depth, 2, 0.1),          false},
+        {"steady 20000/s, 0.5 s",        steady(20000, 0.5),                 false},
+    };
+
+    std::printf("bus_telemetry WIDTH=%u, FIFO depth %u, %llu baud, %.0f MHz clk\n\n",
+                WIDTH, depth, (unsigned long long)BAUD, CLK_HZ / 1e6);
+    std::printf("%-30s %8s %8s %7s %10s %8s %5s %6s\n", "pattern", "driven", "received",
+                "max q", "worst us", "overflow", "gaps", "errors");
+
+    int failures = 0;
+    for (const Pattern& p : patterns) {
+        Result r = run(p, fifo_addr_bits);
+        bool ok = r.errors == 0 &&
+                  (p.must_not_drop ? r.received == r.driven && !r.overflow
+                                   : r.overflow && r.gaps_flagged > 0);
+        std::printf("%-30s %8zu %8zu %7u %10.1f %8s %5u %6u  %s\n", p.name.c_str(),
+                    r.driven, r.received, r.max_queued, r.worst_delay_us,
+                    r.overflow ? "yes" : "no", r.gaps_flagged, r.errors,
+                    ok ? "ok" : "FAIL");
+        failures += !ok;
+    }
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,56 @@
+/*      tick_model.h
+        Cycle models of tick_gen and tick_toggle (Common/tick_gen_hh.sv),
+        shared by the host-side models of the lab designs.
+
+        Each model follows the RTL split: the outputs are functions of
+        the registers, and clock() computes the registers for the next
+        rising edge of clk. */
+
+#ifndef TICK_MODEL_H
+#define TICK_MODEL_H
+
+#include <cstdint>
+
+/*
+ * TickGen
+ *
+ * tick_gen: a one-cycle tick every CLK_HZ/HZ cycles, the last cycle of
+ * each period.
+ */
+struct TickGen {
+    uint64_t period;
+    uint64_t count = 0;
+
+    TickGen(uint64_t hz, uint64_t clk_hz) : period(clk_hz / hz) {}
+
+    bool tick() const { return count == period - 1; }
+    void reset() { count = 0; }
+    void clock() { count = tick() ? 0 : count + 1; }
+};
+
+/*
+ * TickToggle
+ *
+ * tick_toggle: a level that inverts on every tick, a square wave at
+ * HZ/2.
+ */
+struct TickToggle {
+    TickGen gen;
+    bool    level = false;
+
+    TickToggle(uint64_t hz, uint64_t clk_hz) : gen(hz, clk_hz) {}
+
+    void reset()
+    {
+        gen.reset();
+        level = false;
+    }
+    void clock()
+    {
+        if (gen.tick())
+            level = !level;
+        gen.clock();
+    }
+};
+
+#endif
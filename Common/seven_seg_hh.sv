@@ -0,0 +1,111 @@
+/*
+ * Author: Henry Huang
+ * Lab 1-3 shared modules
+ *
+ * A single seven-segment decoder shared by the lab designs, replacing
+ * the copies of seven_seg_led that used to live in each lab file. Add
+ * this file to any Quartus project that instantiates seven_seg_led.
+ */
+
+/*
+ * seven_seg_pkg
+ *
+ *   Glyph table for the seven-segment decoder. Glyph codes 0x0-0xF are
+ * the hexadecimal digits, and codes 0x10-0x1F are extra glyphs that are
+ * only reachable from a decoder built with EXTENDED set.
+ *
+ *   Segments are returned as {a,b,c,d,e,f,g}, where a 1 means the segment
+ * is lit, so that the polarity and ordering of the physical pins can be
+ * handled separately by the decoder.
+ */
+package seven_seg_pkg;
+  localparam logic [4:0] GLYPH_BLANK  = 5'h10;
+  localparam logic [4:0] GLYPH_DASH   = 5'h11;
+  localparam logic [4:0] GLYPH_H      = 5'h12;
+  localparam logic [4:0] GLYPH_L      = 5'h13;
+  localparam logic [4:0] GLYPH_P      = 5'h14;
+  localparam logic [4:0] GLYPH_U      = 5'h15;
+  localparam logic [4:0] GLYPH_R      = 5'h16; // lowercase r
+  localparam logic [4:0] GLYPH_N      = 5'h17; // lowercase n
+  localparam logic [4:0] GLYPH_O      = 5'h18; // lowercase o
+  localparam logic [4:0] GLYPH_T      = 5'h19; // lowercase t
+  localparam logic [4:0] GLYPH_Y      = 5'h1A; // lowercase y
+  localparam logic [4:0] GLYPH_J      = 5'h1B;
+  localparam logic [4:0] GLYPH_G      = 5'h1C;
+  localparam logic [4:0] GLYPH_LOW_H  = 5'h1D; // lowercase h
+  localparam logic [4:0] GLYPH_LOW_U  = 5'h1E; // lowercase u
+  localparam logic [4:0] GLYPH_DEGREE = 5'h1F;
+
+  function automatic logic [6:0] glyph_segments(input logic [4:0] glyph);
+    case (glyph)
+      5'h00 : return 7'b1111110;
+      5'h01 : return 7'b0110000;
+      5'h02 : return 7'b1101101;
+      5'h03 : return 7'b1111001;
+      5'h04 : return 7'b0110011;
+      5'h05 : return 7'b1011011;
+      5'h06 : return 7'b1011111;
+      5'h07 : return 7'b1110000;
+      5'h08 : return 7'b1111111;
+      5'h09 : return 7'b1111011;
+      5'h0A : return 7'b1110111;
+      5'h0B : return 7'b0011111;
+      5'h0C : return 7'b1001110;
+      5'h0D : return 7'b0111101;
+      5'h0E : return 7'b1001111;
+      5'h0F : return 7'b1000111;
+      GLYPH_BLANK  : return 7'b0000000;
+      GLYPH_DASH   : return 7'b0000001;
+      GLYPH_H      : return 7'b0110111;
+      GLYPH_L      : return 7'b0001110;
+      GLYPH_P      : return 7'b1100111;
+      GLYPH_U      : return 7'b0111110;
+      GLYPH_R      : return 7'b0000101;
+      GLYPH_N      : return 7'b0010101;
+      GLYPH_O      : return 7'b0011101;
+      GLYPH_T      : return 7'b0001111;
+      GLYPH_Y      : return 7'b0111011;
+      GLYPH_J      : return 7'b0111000;
+      GLYPH_G      : return 7'b1011110;
+      GLYPH_LOW_H  : return 7'b0010111;
+      GLYPH_LOW_U  : return 7'b0011100;
+      GLYPH_DEGREE : return 7'b1100011;
+    endcase
+  endfunction
+endpackage
+
+/*
+ * seven_seg_led
+ *
+ * Parameters:
+ *   COMMON_ANODE - 1 if segments are driven on by a value of 0, 0 if
+ *                  segments are driven on by a value of 1
+ *   A_AT_LSB - 1 to assign A to seg[0]..., G to seg[6], 0 to assign
+ *              G to seg[0]..., A to seg[6]
+ *   EXTENDED - 1 to widen hex_value by a bit to select the extra glyphs
+ *              of seven_seg_pkg
+ *
+ * Inputs:
+ *   hex_value - the hexadecimal value (or glyph code) to represent
+ * 
+ * Output:
+ *   seg - a 7-bit signal controlling a 7-segment one-digit LED
+ * 
+ *   This module assumes standard placement of the 7 segments. The default
+ * parameters match the lab boards: A is assigned to seg[0], B to seg[1]...,
+ * G to seg[6], in a common anode configuration where segments are driven
+ * on by a value of 0.
+ */
+module seven_seg_led #(parameter bit COMMON_ANODE = 1,
+                       parameter bit A_AT_LSB     = 1,
+                       parameter bit EXTENDED     = 0,
+                       parameter     VALUE_BITS   = EXTENDED ? 5 : 4)
+                      (input  logic [(VALUE_BITS-1):0] hex_value,
+                       output logic [6:0]              seg);
+  logic a,b,c,d,e,f,g;
+  always_comb begin
+    {a,b,c,d,e,f,g} = seven_seg_pkg::glyph_segments(5'(hex_value));
+    if (COMMON_ANODE) {a,b,c,d,e,f,g} = ~{a,b,c,d,e,f,g};
+    seg = A_AT_LSB ? {g,f,e,d,c,b,a} : {a,b,c,d,e,f,g};
+  end
+endmodule
@@ -0,0 +1,306 @@
+/*
+ * Author: Henry Huang
+ * Lab 1-3 shared modules
+ *
+ * A telemetry block that records when an input bus changes, queues the
+ * timestamped values in block RAM, and drains them through a UART
+ * transmitter. Requires Common/tick_gen_hh.sv. The stream format is
+ * documented in bus_telemetry, and Common/host/telemetry_decode.cpp
+ * decodes it on the host side.
+ */
+
+/*
+ * bus_telemetry
+ *
+ * Parameters:
+ *   WIDTH - the width of the monitored bus
+ *   FIFO_ADDR_BITS - log2 of the number of events that can be queued
+ *   BAUD - the UART bit rate, up to CLK_HZ/4
+ *   CLK_HZ - the frequency of clk
+ *
+ * Inputs:
+ *   clk - a clock signal to synchronize the logic with
+ *   reset - a reset signal to clear the internal state
+ *   bus - the asynchronous input bus to monitor
+ *
+ * Output:
+ *   tx - the UART transmit line, 8 data bits, no parity, 1 stop bit
+ *   overflow - a signal that at least one event has been dropped
+ *
+ *   Each change of bus is sent as a frame of bytes:
+ *     header - 8'hA5, or 8'hA6 if events were dropped before this one
+ *     timestamp - 4 bytes, least significant first, in microseconds
+ *     value - (WIDTH+7)/8 bytes, least significant first
+ *     checksum - the XOR of every preceding byte in the frame
+ *
+ *   The UART is the rate limit on the stream. At 1 Mbaud a 4-bit bus
+ * takes 70 us per event, so bursts faster than that are absorbed by the
+ * FIFO, and events beyond its depth are dropped and flagged.
+ */
+module bus_telemetry #(parameter WIDTH          = 4,
+                                 FIFO_ADDR_BITS = 9,
+                                 BAUD           = 1_000_000,
+                                 CLK_HZ         = 40_000_000)
+                      (input  logic               clk,
+                       input  logic               reset,
+                       input  logic [(WIDTH-1):0] bus,
+                       output logic               tx,
+                       output logic               overflow);
+  localparam EVENT_BITS = 1 + 32 + WIDTH;
+  logic [(EVENT_BITS-1):0] event_in, event_out;
+  logic push, pop, full, empty;
+  
+  change_timestamper #(WIDTH, CLK_HZ) stamper(clk, reset, bus, full, 
+                                               push, event_in, overflow);
+  sync_fifo #(EVENT_BITS, FIFO_ADDR_BITS) fifo(clk, reset, push, event_in,
+                                               pop, event_out, full, empty);
+  telemetry_framer #(WIDTH, BAUD, CLK_HZ) framer(clk, reset, empty, event_out,
+                                                 pop, tx);
+endmodule
+
+/*
+ * change_timestamper
+ *
+ * Parameters:
+ *   WIDTH - the width of the monitored bus
+ *   CLK_HZ - the frequency of clk
+ *
+ * Inputs:
+ *   clk - a clock signal to synchronize the logic with
+ *   reset - a reset signal to clear the internal state
+ *   bus - the asynchronous input bus to monitor
+ *   full - a signal that the event queue cannot accept an event
+ *
+ * Output:
+ *   push - a signal that event_data holds a new event to queue
+ *   event_data - {dropped, timestamp, value} for the new event
+ *   overflow - a signal that at least one event has been dropped
+ *
+ *   This module synchronizes the bus with two registers, and produces an
+ * event whenever the synchronized value differs from the previous cycle.
+ * Timestamps count microseconds from reset. If an event arrives while the
+ * queue is full, it is dropped and the dropped bit is set on the next
+ * event that does get queued.
+ */
+module change_timestamper #(parameter WIDTH = 4, CLK_HZ = 40_000_000)
+                           (input  logic                 clk,
+                            input  logic                 reset,
+                            input  logic [(WIDTH-1):0]   bus,
+                            input  logic                 full,
+                            output logic                 push,
+                            output logic [(WIDTH+32):0]  event_data,
+                            output logic                 overflow);
+  logic [(WIDTH-1):0] meta, synced, previous;
+  logic [31:0]        timestamp;
+  logic               microsecond;
+  logic               changed;
+  logic               dropped;
+  
+  tick_gen #(1_000_000, CLK_HZ) us_tick(clk, reset, microsecond);
+  
+  always_ff @ (posedge clk or posedge reset) begin
+    if (reset) begin
+      {meta, synced, previous} <= '0;
+      timestamp <= '0;
+      dropped   <= '0;
+      overflow  <= '0;
+    end else begin
+      {meta, synced} <= {bus, meta};
+      previous  <= synced;
+      timestamp <= microsecond ? timestamp + 1 : timestamp;
+      dropped   <= (changed & full) ? '1 : push ? '0 : dropped;
+      overflow  <= overflow | (changed & full);
+    end
+  end
+  always_comb begin
+    changed = (synced != previous);
+    push = changed & ~full;
+    event_data = {dropped, timestamp, synced};
+  end
+endmodule
+
+/*
+ * sync_fifo
+ *
+ * Parameters:
+ *   DATA_WIDTH - the width of each queued word
+ *   ADDR_BITS - log2 of the number of words that can be queued
+ *
+ * Inputs:
+ *   clk - a clock signal to synchronize the logic with
+ *   reset - a reset signal to empty the queue
+ *   push - a signal to queue push_data, ignored when full
+ *   push_data - the word to queue
+ *   pop - a signal to dequeue the oldest word, ignored when empty
+ *
+ * Output:
+ *   pop_data - the dequeued word, valid the cycle after pop
+ *   full - a signal that no more words can be queued
+ *   empty - a signal that there are no words to dequeue
+ *
+ *   The storage is written and read with registered addresses only, so
+ * that it is inferred as a simple dual-port block RAM. Because the RAM
+ * read is registered, pop_data lags pop by a cycle.
+ */
+module sync_fifo #(parameter DATA_WIDTH = 8, ADDR_BITS = 9)
+                  (input  logic                    clk,
+                   input  logic                    reset,
+                   input  logic                    push,
+                   input  logic [(DATA_WIDTH-1):0] push_data,
+                   input  logic                    pop,
+                   output logic [(DATA_WIDTH-1):0] pop_data,
+                   output logic                    full,
+                   output logic                    empty);
+  logic [(DATA_WIDTH-1):0] ram[0:(2**ADDR_BITS-1)];
+  logic [ADDR_BITS:0]      write_ptr, read_ptr;
+  
+  always_ff @ (posedge clk) begin
+    if (push & ~full) ram[write_ptr[(ADDR_BITS-1):0]] <= push_data;
+    pop_data <= ram[read_ptr[(ADDR_BITS-1):0]];
+  end
+  always_ff @ (posedge clk or posedge reset) begin
+    if (reset) begin
+      write_ptr <= '0;
+      read_ptr  <= '0;
+    end else begin
+      write_ptr <= (push & ~full)  ? write_ptr + 1 : write_ptr;
+      read_ptr  <= (pop  & ~empty) ? read_ptr + 1  : read_ptr;
+    end
+  end
+  always_comb begin
+    empty = (write_ptr == read_ptr);
+    full  = (write_ptr == {~read_ptr[ADDR_BITS], read_ptr[(ADDR_BITS-1):0]});
+  end
+endmodule
+
+/*
+ * telemetry_framer
+ *
+ * Parameters:
+ *   WIDTH - the width of the monitored bus
+ *   BAUD - the UART bit rate
+ *   CLK_HZ - the frequency of clk
+ *
+ * Inputs:
+ *   clk - a clock signal to synchronize the logic with
+ *   reset - a reset signal to clear the internal state
+ *   empty - a signal that there are no queued events
+ *   event_data - {dropped, timestamp, value} of the popped event
+ *
+ * Output:
+ *   pop - a signal to dequeue the next event
+ *   tx - the UART transmit line
+ *
+ *   This module pops one event at a time and sends it as the frame of
+ * bytes described in bus_telemetry, waiting for the UART between bytes.
+ */
+module telemetry_framer #(parameter WIDTH  = 4,
+                                    BAUD   = 1_000_000,
+                                    CLK_HZ = 40_000_000)
+                         (input  logic                clk,
+                          input  logic                reset,
+                          input  logic                empty,
+                          input  logic [(WIDTH+32):0] event_data,
+                          output logic                pop,
+                          output logic                tx);
+  localparam VALUE_BYTES = (WIDTH + 7) / 8;
+  localparam VALUE_BITS  = 8 * VALUE_BYTES;
+  localparam FRAME_BYTES = 1 + 4 + VALUE_BYTES + 1;
+  
+  typedef enum logic [1:0] {IDLE, LOAD, SEND} state_t;
+  state_t                            state;
+  logic [(8*(FRAME_BYTES-1)-1):0]    frame;
+  logic [7:0]                        checksum;
+  logic [($clog2(FRAME_BYTES+1)-1):0] bytes_left;
+  logic [7:0]                        byte_out;
+  logic                              start, busy;
+  
+  uart_tx #(BAUD, CLK_HZ) uart(clk, reset, start, byte_out, tx, busy);
+  
+  always_ff @ (posedge clk or posedge reset) begin
+    if (reset) begin
+      state      <= IDLE;
+      frame      <= '0;
+      checksum   <= '0;
+      bytes_left <= '0;
+    end else begin
+      case (state)
+        IDLE : state <= empty ? IDLE : LOAD;
+        LOAD : begin
+          frame <= {VALUE_BITS'(event_data[(WIDTH-1):0]),
+                    event_data[(WIDTH+31):WIDTH],
+                    event_data[WIDTH+32] ? 8'hA6 : 8'hA5};
+          checksum   <= '0;
+          bytes_left <= FRAME_BYTES;
+          state      <= SEND;
+        end
+        SEND : if (start) begin
+          frame      <= frame >> 8;
+          checksum   <= checksum ^ byte_out;
+          bytes_left <= bytes_left - 1;
+          state      <= (bytes_left == 1) ? IDLE : SEND;
+        end
+        default : state <= IDLE;
+      endcase
+    end
+  end
+  always_comb begin
+    pop      = (state == IDLE) & ~empty;
+    start    = (state == SEND) & ~busy;
+    byte_out = (bytes_left == 1) ? checksum : frame[7:0];
+  end
+endmodule
+
+/*
+ * uart_tx
+ *
+ * Parameters:
+ *   BAUD - the bit rate
+ *   CLK_HZ - the frequency of clk
+ *
+ * Inputs:
+ *   clk - a clock signal to synchronize the logic with
+ *   reset - a reset signal to clear the internal state
+ *   start - a signal to begin sending data, ignored while busy
+ *   data - the byte to send
+ *
+ * Output:
+ *   tx - the transmit line, idle high
+ *   busy - a signal that a byte is still being sent
+ *
+ *   This module sends a byte with 1 start bit, 8 data bits (least
+ * significant first) and 1 stop bit. Bits are shifted out on a free
+ * running baud enable, so the start bit begins within one bit period
+ * of start.
+ */
+module uart_tx #(parameter BAUD = 1_000_000, CLK_HZ = 40_000_000)
+                (input  logic       clk,
+                 input  logic       reset,
+                 input  logic       start,
+                 input  logic [7:0] data,
+                 output logic       tx,
+                 output logic       busy);
+  logic [9:0] shifter;
+  logic [3:0] bits_left;
+  logic       baud_tick;
+  
+  tick_gen #(BAUD, CLK_HZ) baud(clk, reset, baud_tick);
+  
+  always_ff @ (posedge clk or posedge reset) begin
+    if (reset) begin
+      tx        <= '1;
+      shifter   <= '1;
+      bits_left <= '0;
+    end else if (start & ~busy) begin
+      shifter   <= {1'b1, data, 1'b0};
+      bits_left <= 4'd10;
+    end else if (baud_tick & busy) begin
+      tx        <= shifter[0];
+      shifter   <= {1'b1, shifter[9:1]};
+      bits_left <= bits_left - 1;
+    end
+  end
+  always_comb begin
+    busy = (bits_left != 0);
+  end
+endmodule
@@ -0,0 +1,81 @@
+/*
+ * Author: Henry Huang
+ * Lab 1-3 shared modules
+ *
+ * Clock-enable timing generators shared by the lab designs. All slow
+ * timing is produced as single-cycle enables on the system clock, so
+ * that every register stays in a single clock domain. Add this file to
+ * any Quartus project that instantiates tick_gen or tick_toggle.
+ */
+
+/*
+ * tick_gen
+ *
+ * Parameters:
+ *   HZ - the number of ticks to produce per second
+ *   CLK_HZ - the frequency of clk
+ *
+ * Inputs:
+ *   clk - the clock signal to synchronize the logic with
+ *   reset - a reset signal to restart the tick period
+ *
+ * Output:
+ *   tick - a signal that is high for a single clk cycle, HZ times per second
+ *
+ *   The period is CLK_HZ/HZ cycles, rounded down. The counter is only as
+ * wide as needed to hold the period, which is computed at elaboration
+ * time, and restarts by comparing against a constant rather than against
+ * a full-width magnitude.
+ */
+module tick_gen #(parameter HZ     = 1,
+                            CLK_HZ = 40_000_000,
+                            PERIOD = CLK_HZ / HZ,
+                            WIDTH  = (PERIOD > 1) ? $clog2(PERIOD) : 1)
+                 (input  logic clk,
+                  input  logic reset,
+                  output logic tick);
+  logic [(WIDTH-1):0] count;
+  always_ff @ (posedge clk or posedge reset) begin
+    if (reset) begin
+      count <= '0;
+    end else begin
+      count <= tick ? '0 : count + 1'b1;
+    end
+  end
+  always_comb begin
+    tick = (count == WIDTH'(PERIOD - 1));
+  end
+endmodule
+
+/*
+ * tick_toggle
+ *
+ * Parameters:
+ *   HZ - the number of times per second to invert the output
+ *   CLK_HZ - the frequency of clk
+ *
+ * Inputs:
+ *   clk - the clock signal to synchronize the logic with
+ *   reset - a reset signal to clear the internal state
+ *
+ * Output:
+ *   level - a signal that inverts HZ times per second, completing
+ *           a full cycle HZ/2 times per second
+ *
+ *   The output is a registered data signal in the clk domain, and should
+ * be used to select data rather than to clock other registers.
+ */
+module tick_toggle #(parameter HZ = 1, CLK_HZ = 40_000_000)
+                    (input  logic clk,
+                     input  logic reset,
+                     output logic level);
+  logic tick;
+  tick_gen #(HZ, CLK_HZ) gen(clk, reset, tick);
+  always_ff @ (posedge clk or posedge reset) begin
+    if (reset) begin
+      level <= '0;
+    end else if (tick) begin
+      level <= ~level;
+    end
+  end
+endmodule
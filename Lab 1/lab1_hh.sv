@@ -5,6 +5,9 @@
  * 
  * These modules control the LED bar on the microprocessor board
  * in addition to a separate 7-segment 1-digit LED. 
+ *
+ *   The seven_seg_led decoder is shared between labs, and is provided
+ * by Common/seven_seg_hh.sv. The blink timing uses Common/tick_gen_hh.sv.
  */
 
 /*
@@ -17,13 +20,30 @@
  * Output:
  *   led - a 8-bit signal controlling a bar of LEDs
  *   seg - a 7-bit signal controlling a 7-segment one-digit LED
+ *   tx - a 1 Mbaud UART line reporting timestamped changes of s
+ *
+ *   The telemetry on tx is produced by bus_telemetry, from
+ * Common/telemetry_hh.sv, and can be read on the host with
+ * Common/host/telemetry_decode.cpp. Since the board provides no reset,
+ * the telemetry is held in reset for the first cycles after power-up.
  */
 module lab1_hh(input  logic       clk,
                input  logic [3:0] s,
                output logic [7:0] led,
-               output logic [6:0] seg);
+               output logic [6:0] seg,
+               output logic       tx);
+  logic [1:0] power_on = '0;
+  logic       reset;
+  logic       overflow;
+  always_ff @ (posedge clk) begin
+    power_on <= {power_on[0], 1'b1};
+  end
+  always_comb begin
+    reset = ~power_on[1];
+  end
   seven_seg_led seg0(s, seg);
   eight_seg_led_bar seg1(clk, s, led);
+  bus_telemetry #(4) telemetry(clk, reset, s, tx, overflow);
 endmodule
 
 /*
@@ -45,68 +65,21 @@ endmodule
  *   led[5] : s[3] = 0
  *   led[6] : s[3] = 1 & s[4] = 1
  *
- * The signal led[7] blinks at a rate of ~2.4 Hz.
+ * The signal led[7] blinks at a rate of ~2.5 Hz.
  * 
- *   This module requires that internal registers
- * and output signals are initialized to some valid
- * digital value.
+ *   The blink rate is derived from a single-cycle enable on clk, so the
+ * module holds no derived clocks. Internal registers are expected to
+ * power up at a valid digital value, as there is no reset input.
  */
 module eight_seg_led_bar(input  logic       clk,
                          input  logic [3:0] s,
                          output logic [7:0] led);
-  logic [31:0] count;
-  always_ff @ (posedge clk) begin
-    if (count > 8_333_333) begin
-      led[7] <= ~led[7];
-      count <= 0;
-    end else begin
-      count <= count + 1;
-    end
-  end
+  logic blink;
+  tick_toggle #(5) blinker(clk, 1'b0, blink);
   always_comb begin
     {led[4],led[2],led[0]} = s[2:0];
     {led[5],led[3],led[1]} = ~s[2:0];
     {led[6]} = &s[3:2];
+    {led[7]} = blink;
   end
 endmodule
-
-/*
- * seven_seg_led
- *
- * Inputs:
- *   hex_value - the hexadecimal value to represent on the bar
- * 
- * Output:
- *   seg - a 7-bit signal controlling a 7-segment one-digit LED
- * 
- *   This module assumes standard placement of the 7 segments, and
- * assigns A to seg[0], B to seg[1]..., G to seg[6]. It also assumes
- * a common anode configuration where segments are driven on by a
- * value of 0. 
- */
-module seven_seg_led(input  logic [3:0] hex_value,
-                     output logic [6:0] seg);
-  logic a,b,c,d,e,f,g;
-  always_comb begin
-    case (hex_value)
-      4'h0 : {a,b,c,d,e,f,g} = 7'b0000001;
-      4'h1 : {a,b,c,d,e,f,g} = 7'b1001111;
-      4'h2 : {a,b,c,d,e,f,g} = 7'b0010010;
-      4'h3 : {a,b,c,d,e,f,g} = 7'b0000110;
-      4'h4 : {a,b,c,d,e,f,g} = 7'b1001100;
-      4'h5 : {a,b,c,d,e,f,g} = 7'b0100100;
-      4'h6 : {a,b,c,d,e,f,g} = 7'b0100000;
-      4'h7 : {a,b,c,d,e,f,g} = 7'b0001111;
-      4'h8 : {a,b,c,d,e,f,g} = 7'b0000000;
-      4'h9 : {a,b,c,d,e,f,g} = 7'b0000100;
-      4'hA : {a,b,c,d,e,f,g} = 7'b0001000;
-      4'hB : {a,b,c,d,e,f,g} = 7'b1100000;
-      4'hC : {a,b,c,d,e,f,g} = 7'b0110001;
-      4'hD : {a,b,c,d,e,f,g} = 7'b1000010;
-      4'hE : {a,b,c,d,e,f,g} = 7'b0110000;
-      4'hF : {a,b,c,d,e,f,g} = 7'b0111000;
-    endcase
-    seg = {g,f,e,d,c,b,a};
-  end
-endmodule
-
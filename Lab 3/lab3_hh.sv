@@ -2,7 +2,10 @@
  * Author: Henry Huang
  * Date: 9/24/2014
  * Lab 3
- *  
+ *
+ *   The seven_seg_led decoder is shared between labs, and is provided
+ * by Common/seven_seg_hh.sv. The digit multiplexing rate is
+ * generated by tick_toggle from Common/tick_gen_hh.sv.
  */
 
 /*
@@ -121,8 +124,19 @@ endmodule
  *   seven_seg_digit - the decoded signals for the time-multiplexed LED digits
  *
  *   This module reads in hex values when the activate signal indicates
- * that a new button has been pressed. It then displays the last two pressed
- * values by LED control signals, with the most recent on the right LED.
+ * that a new button has been pressed, and displays the digits entered so
+ * far by LED control signals, with the most recent on the right LED. The
+ * E key removes the most recent digit, and the F key enters the value.
+ * While no digits are entered, the last entered value is displayed, 42
+ * after reset as the digits shown then.
+ *
+ *   Unlike the key_record this replaced, E and F are control keys and
+ * can no longer be typed as digits, so only 00 to DD can be shown from
+ * the keypad.
+ *
+ *   The entered values are consumed by a register that holds the last one
+ * for the display, so it accepts out_data on every cycle that out_valid
+ * is high.
  *  
  */
 
@@ -132,9 +146,28 @@ module hex_writer(input  logic       clk,
                   input  logic       activate,
                   output logic       left_off, right_off,
                   output logic [6:0] seven_seg_digit);
+  logic [7:0] entry;
+  logic [1:0] digit_count;
+  logic       out_valid, out_ready;
+  logic [7:0] out_data;
+  logic [7:0] entered;
   logic [3:0] left_hex;
   logic [3:0] right_hex;
-  key_record record(clk, reset, read_hex, activate, left_hex, right_hex);
+  localparam logic [7:0] RESET_VALUE = 8'h42;
+  hex_entry #(.DIGITS(2), .CONTROL_KEYS(1), .RESET_VALUE(RESET_VALUE))
+      accumulator(clk, reset, read_hex, activate, out_ready,
+                  entry, digit_count, out_valid, out_data);
+  always_ff @ (posedge clk or posedge reset) begin
+    if (reset) begin
+      entered <= RESET_VALUE;
+    end else if (out_valid & out_ready) begin
+      entered <= out_data;
+    end
+  end
+  always_comb begin
+    out_ready = 1'b1;
+    {left_hex, right_hex} = (digit_count != 0) ? entry : entered;
+  end
   hex_display display(clk, left_hex, right_hex, left_off, right_off, seven_seg_digit);
 endmodule
                       
@@ -402,44 +435,89 @@ module key_deactivator #(parameter COUNTDOWN_BITS = 20)
 endmodule
 
 /*
- * hex_record
+ * hex_entry
+ *
+ * Parameters:
+ *   DIGITS - the number of hex digits that can be entered
+ *   CONTROL_KEYS - 1 to treat BACKSPACE_KEY and ENTER_KEY as control
+ *                  keys, 0 to treat every key as a digit
+ *   BACKSPACE_KEY - the key that removes the most recent digit
+ *   ENTER_KEY - the key that sends the entered value downstream
+ *   RESET_VALUE - the entered value after reset
  * 
  * Inputs:
  *   clk - a clock signal to synchronize the logic with
- *   reset - a reset signal to clear the internal state of the record to 42
- *   new_hex - a 4-bit value to store as input
- *   activate - an enable signal allowing new_hex to be stored
+ *   reset - a reset signal to clear the internal state to RESET_VALUE
+ *   new_hex - a 4-bit key value to apply
+ *   activate - an enable signal allowing new_hex to be applied
+ *   out_ready - a signal that the downstream consumer accepts out_data
  * 
  * Output:
- *   left_hex - the second most recent hex value to be stored
- *   right_hex - the most recent hex value to be stored
+ *   entry - the digits entered so far, with the most recent digit in
+ *           the least significant position
+ *   digit_count - the number of digits entered so far
+ *   out_valid - a signal that out_data holds an entered value
+ *   out_data - the value entered when the enter key was pressed
  * 
- *   This module stores the last two hex values assigned to new_hex
- * when the activate enable signal is turned on. The most recent value
- * is stored as the right hex, and the second most recent value is
- * stored as the left hex. Note that the recorded hex values are updated
- * for every clock cycle where the activate signal is enabled, such that
- * in order to store a single new value, the activate signal must be high
- * for only a single cycle.
+ *   This module accumulates up to DIGITS hex digits as keys are activated.
+ * Once DIGITS digits are entered, each new digit shifts the oldest one out.
+ * Like key_record before it, the entry is updated for every clock cycle
+ * where activate is enabled, so activate must be high for only a single
+ * cycle per key press.
+ *
+ *   With CONTROL_KEYS set, the backspace key removes the most recent digit,
+ * and the enter key moves entry to out_data and clears entry. out_data is
+ * held with out_valid high until a cycle where out_ready is also high. An
+ * enter key pressed while out_data is still waiting is ignored, so that no
+ * accepted value is ever overwritten.
+ *
+ *   The keypad scanner only tracks a single key at a time, so control
+ * keys take the place of digits rather than being chorded with them.
  *   
  */
 
-module key_record (input  logic       clk,
-                   input  logic       reset,
-                   input  logic [3:0] new_hex,
-                   input  logic       activate,
-                   output logic [3:0] left_hex,
-                   output logic [3:0] right_hex);
+module hex_entry #(parameter             DIGITS        = 2,
+                   parameter bit         CONTROL_KEYS  = 0,
+                   parameter logic [3:0] BACKSPACE_KEY = 4'hE,
+                                         ENTER_KEY     = 4'hF,
+                   parameter             RESET_VALUE   = 0,
+                                         ENTRY_BITS    = 4 * DIGITS,
+                                         COUNT_BITS    = $clog2(DIGITS+1))
+                  (input  logic                      clk,
+                   input  logic                      reset,
+                   input  logic [3:0]                new_hex,
+                   input  logic                      activate,
+                   input  logic                      out_ready,
+                   output logic [(ENTRY_BITS-1):0]   entry,
+                   output logic [(COUNT_BITS-1):0]   digit_count,
+                   output logic                      out_valid,
+                   output logic [(ENTRY_BITS-1):0]   out_data);
+  logic backspace, enter, digit, accept;
+  always_comb begin
+    backspace = activate & CONTROL_KEYS & (new_hex == BACKSPACE_KEY);
+    enter     = activate & CONTROL_KEYS & (new_hex == ENTER_KEY);
+    digit     = activate & ~backspace & ~enter;
+    accept    = enter & (~out_valid | out_ready);
+  end
   always_ff @ (posedge clk or posedge reset) begin
     if (reset) begin
-      left_hex  <= 4'h4;
-      right_hex <= 4'h2;
-    end else if (activate) begin
-      left_hex  <= right_hex;
-      right_hex <= new_hex;
+      entry       <= ENTRY_BITS'(RESET_VALUE);
+      digit_count <= (RESET_VALUE != 0) ? COUNT_BITS'(DIGITS) : '0;
+      out_valid   <= '0;
+      out_data    <= '0;
     end else begin
-      left_hex  <= left_hex;
-      right_hex <= right_hex;
+      if (digit) begin
+        entry       <= ENTRY_BITS'({entry, new_hex});
+        digit_count <= (digit_count == DIGITS) ? digit_count : digit_count + 1;
+      end else if (backspace) begin
+        entry       <= entry >> 4;
+        digit_count <= (digit_count == 0) ? digit_count : digit_count - 1;
+      end else if (accept) begin
+        entry       <= '0;
+        digit_count <= '0;
+      end
+      out_valid <= accept ? '1 : out_ready ? '0 : out_valid;
+      out_data  <= accept ? entry : out_data;
     end
   end
 endmodule
@@ -471,81 +549,10 @@ module hex_display (input  logic       clk,
                     output logic [6:0] seven_seg_digit);
   logic oscil;  
   logic [3:0] value;
-  exp_2_oscillator exp_oscil(clk, oscil);
+  tick_toggle #(305) digit_select(clk, 1'b0, oscil);
   always_comb begin
     value = oscil ? left_value : right_value;
     {left_off, right_off} = {~oscil, oscil};
   end
   seven_seg_led seg0(value, seven_seg_digit);
 endmodule
-
-/*
- * exp_2_oscillator
- * 
- * Parameter: 
- *   SLOWDOWN_EXP - the power of two that the output signal is slowed by
- *
- * Inputs:
- *   clk - the base oscillating signal to base the output signal off of
- *
- * Output:
- *   oscil - a signal that oscillates at a slower rate than clk based
- *           on the SLOWDOWN_EXP.
- *
- *   The output signal will invert every 2^SLOWDOWN_EXP clk cycles. However,
- * since the signal needs to be inverted twice for every cycle, the output
- * signal will be 2^(SLOWDOWN_EXP+1) times slower than the original signal.
- *   
- */
-module exp_2_oscillator #(parameter SLOWDOWN_EXP = 17)
-                         (input  logic clk,
-                          output logic oscil);
-  logic [SLOWDOWN_EXP:0] count;
-  always_ff @ (posedge clk) begin
-      count <= count + 1;
-  end
-  always_comb begin
-    oscil = count[SLOWDOWN_EXP];
-  end
-endmodule
-
-/*
- * seven_seg_led
- *
- * Inputs:
- *   hex_value - the hexadecimal value to represent on the bar
- * 
- * Output:
- *   seg - a 7-bit signal controlling a 7-segment one-digit LED
- * 
- *   This module assumes standard placement of the 7 segments, and
- * assigns A to seg[0], B to seg[1]..., G to seg[6]. It also assumes
- * a common anode configuration where segments are driven on by a
- * value of 0. 
- */
-module seven_seg_led(input  logic [3:0] hex_value,
-                     output logic [6:0] seg);
-  logic a,b,c,d,e,f,g;
-  always_comb begin
-    case (hex_value)
-      4'h0 : {a,b,c,d,e,f,g} = 7'b0000001;
-      4'h1 : {a,b,c,d,e,f,g} = 7'b1001111;
-      4'h2 : {a,b,c,d,e,f,g} = 7'b0010010;
-      4'h3 : {a,b,c,d,e,f,g} = 7'b0000110;
-      4'h4 : {a,b,c,d,e,f,g} = 7'b1001100;
-      4'h5 : {a,b,c,d,e,f,g} = 7'b0100100;
-      4'h6 : {a,b,c,d,e,f,g} = 7'b0100000;
-      4'h7 : {a,b,c,d,e,f,g} = 7'b0001111;
-      4'h8 : {a,b,c,d,e,f,g} = 7'b0000000;
-      4'h9 : {a,b,c,d,e,f,g} = 7'b0000100;
-      4'hA : {a,b,c,d,e,f,g} = 7'b0001000;
-      4'hB : {a,b,c,d,e,f,g} = 7'b1100000;
-      4'hC : {a,b,c,d,e,f,g} = 7'b0110001;
-      4'hD : {a,b,c,d,e,f,g} = 7'b1000010;
-      4'hE : {a,b,c,d,e,f,g} = 7'b0110000;
-      4'hF : {a,b,c,d,e,f,g} = 7'b0111000;
-    endcase
-    seg = {g,f,e,d,c,b,a};
-  end
-endmodule
-
@@ -2,13 +2,15 @@
 //
 // Simple Dual-Port RAM with different read/write addresses and single read/write clock
 // and with a control for writing single bytes into the memory word; byte enable
+// WORDS may be lowered below 2**ADDR_WIDTH to avoid allocating unused words
 
 module byte_enabled_simple_dual_port_ram
   #(parameter int
     ADDR_WIDTH = 6,
     BYTE_WIDTH = 8,
     BYTES = 4,
-      WIDTH = BYTES * BYTE_WIDTH
+      WIDTH = BYTES * BYTE_WIDTH,
+    WORDS = 1 << ADDR_WIDTH
 )
 ( 
   input [ADDR_WIDTH-1:0] waddr,
@@ -18,8 +20,6 @@ module byte_enabled_simple_dual_port_ram
   input we, clk,
   output reg [WIDTH - 1:0] q
 );
-  localparam int WORDS = 1 << ADDR_WIDTH ;
-
   // use a multi-dimensional packed array to model individual bytes within the word
   logic [BYTES-1:0][BYTE_WIDTH-1:0] ram[0:WORDS-1];
 
@@ -0,0 +1,199 @@
+// blitter.sv
+// 2D drawing engine for the framebuffer in vga.sv. The PIC writes
+// OP_BLIT registers and starts an operation, and the blitter draws
+// it into the framebuffer's back page a pixel at a time:
+//   fill  - width x height of the foreground color at x, y
+//   copy  - width x height from src_x, src_y to x, y; overlapping
+//           rectangles are copied in the order that leaves the source
+//           intact
+//   line  - a Bresenham line from x, y to x1, y1
+//   glyph - width x height (up to 16 x 16) of the glyph rows, 1 bits
+//           in the foreground color and 0 bits in the background
+//           color, or left alone when transparent
+// Pixels outside 320x240 are skipped. Register writes queue in a FIFO
+// behind the running operation, so a burst can hold several
+// operations; busy is high from the clock a write arrives until the
+// queue is empty and the last operation is done, and the PIC waits
+// for it to fall before sending more than 2**QUEUE_ADDR_BITS words.
+// A write that finds the queue full is lost, and flagged on dropped
+// for the commands dropped count in the status word.
+
+// Draws pixels through write and read requests to the framebuffer.
+// A write of color at pixel address y*320 + x happens when
+// write_ready; a read of read_address happens when read_ready, and
+// the word holding the pixel is in pixel_word 2 clocks later.
+module blitter #(parameter QUEUE_ADDR_BITS = 5)
+                (input  logic        clk,
+                 input  logic [31:0] command,
+                 input  logic        command_valid,
+                 output logic        write,
+                 output logic [16:0] write_address,
+                 output logic [7:0]  color,
+                 input  logic        write_ready,
+                 output logic        read,
+                 output logic [16:0] read_address,
+                 input  logic        read_ready,
+                 input  logic [31:0] pixel_word,
+                 output logic        busy,
+                 output logic        dropped);
+  import vga_commands::*;
+
+  localparam FB_WIDTH  = 320;
+  localparam FB_HEIGHT = 240;
+
+  typedef enum logic [2:0] {IDLE, FILL, COPY_READ, COPY_WAIT, COPY_DATA,
+                            COPY_WRITE, LINE, GLYPH} state_t;
+
+  // queued register writes
+  logic [31:0] word;
+  logic        push, full, empty, pop;
+  logic [1:0]  pushed;
+
+  assign push = command_valid & opcode(command) == OP_BLIT;
+  async_fifo #(32, QUEUE_ADDR_BITS)
+    queue(clk, push, command, full, clk, pop, word, empty);
+
+  // a write reaches empty through the FIFO's 2 register synchronizer,
+  // so busy covers the clocks until it does
+  always_ff @(posedge clk)
+    pushed <= {pushed[0], push};
+
+  // registers
+  logic [9:0]  dst_x, dst_y, size_x, size_y, src_x, src_y;
+  logic [7:0]  fg, bg;
+  logic [15:0] glyph[16];
+  logic [3:0]  glyph_row;
+  logic        transparent, reverse;
+
+  // progress through a rectangle, in the order the pixels are drawn
+  state_t             state;
+  logic [9:0]         cx, cy, off_x, off_y;
+  logic               last_pixel;
+  logic               source_in, copy_in;
+  logic [1:0]         read_lane;
+  logic [7:0]         copy_pixel;
+  logic signed [11:0] line_x, line_y, line_dx, line_dy;
+  logic signed [12:0] line_err, line_e2;
+  logic signed [11:0] line_sx, line_sy;
+  logic [11:0]        px, py, rx, ry;
+  logic               plot, glyph_bit, advance;
+
+  assign pop        = (state == IDLE) & ~empty;
+  assign busy       = (state != IDLE) | ~empty | push | (|pushed);
+  assign dropped    = push & full;
+  assign off_x      = reverse ? size_x - 1 - cx : cx;
+  assign off_y      = reverse ? size_y - 1 - cy : cy;
+  assign last_pixel = (cx == size_x - 1) & (cy == size_y - 1);
+  assign glyph_bit  = glyph[cy[3:0]][4'hF - cx[3:0]];
+  assign line_e2    = line_err <<< 1;
+
+  // the pixel to write in this state
+  always_comb begin
+    px = dst_x + off_x;
+    py = dst_y + off_y;
+    {plot, color} = {1'b0, fg};
+    case (state)
+      FILL       : plot = 1'b1;
+      COPY_WRITE : {plot, color} = {copy_in, copy_pixel};
+      LINE       : {px, py, plot} = {line_x, line_y, 1'b1};
+      GLYPH      : {plot, color} = {glyph_bit | ~transparent,
+                                    glyph_bit ? fg : bg};
+      default    : ;
+    endcase
+  end
+
+  assign write         = plot & px < FB_WIDTH & py < FB_HEIGHT;
+  assign write_address = {py[7:0], 8'b0} + {py[7:0], 6'b0} + px[8:0];
+  assign advance       = ~write | write_ready;
+
+  // the pixel to read for a copy
+  assign rx           = src_x + off_x;
+  assign ry           = src_y + off_y;
+  assign source_in    = rx < FB_WIDTH & ry < FB_HEIGHT;
+  assign read         = (state == COPY_READ) & source_in;
+  assign read_address = {ry[7:0], 8'b0} + {ry[7:0], 6'b0} + rx[8:0];
+
+  always_ff @(posedge clk)
+    case (state)
+      IDLE       : if (~empty)
+                     case (word[27:24])
+                       4'd0  : dst_x  <= word[9:0];
+                       4'd1  : dst_y  <= word[9:0];
+                       4'd2  : size_x <= word[9:0];
+                       4'd3  : size_y <= word[9:0];
+                       4'd4  : src_x  <= word[9:0];
+                       4'd5  : src_y  <= word[9:0];
+                       4'd6  : {bg, fg} <= word[15:0];
+                       4'd7  : begin
+                                 glyph[glyph_row] <= word[15:0];
+                                 glyph_row        <= glyph_row + 1;
+                               end
+                       4'd15 : begin
+                                 {cx, cy}    <= '0;
+                                 glyph_row   <= '0;
+                                 transparent <= word[2];
+                                 reverse     <= (word[1:0] == 2'd1) &
+                                                (dst_y > src_y |
+                                                 dst_y == src_y & dst_x > src_x);
+                                 line_x      <= dst_x;
+                                 line_y      <= dst_y;
+                                 line_dx     <= (size_x > dst_x) ? size_x - dst_x
+                                                                 : dst_x - size_x;
+                                 line_dy     <= (size_y > dst_y) ? dst_y - size_y
+                                                                 : size_y - dst_y;
+                                 line_sx     <= (size_x > dst_x) ? 1 : -1;
+                                 line_sy     <= (size_y > dst_y) ? 1 : -1;
+                                 line_err    <= ((size_x > dst_x) ? size_x - dst_x
+                                                                  : dst_x - size_x) +
+                                                ((size_y > dst_y) ? dst_y - size_y
+                                                                  : size_y - dst_y);
+                                 if (word[1:0] == 2'd2)
+                                   state <= LINE;
+                                 else if (size_x != 0 & size_y != 0)
+                                   case (word[1:0])
+                                     2'd0 : state <= FILL;
+                                     2'd1 : state <= COPY_READ;
+                                     2'd3 : if (size_x <= 16 & size_y <= 16)
+                                              state <= GLYPH;
+                                   endcase
+                               end
+                       default : ;
+                     endcase
+      // a copy reads when the display is not using the read port
+      COPY_READ  : if (~source_in | read_ready) begin
+                     copy_in   <= source_in;
+                     read_lane <= read_address[1:0];
+                     state     <= COPY_WAIT;
+                   end
+      COPY_WAIT  : state <= COPY_DATA;
+      COPY_DATA  : begin
+                     copy_pixel <= pixel_word[8*read_lane +: 8];
+                     state      <= COPY_WRITE;
+                   end
+      LINE       : if (advance) begin
+                     if (line_x == size_x & line_y == size_y) state <= IDLE;
+                     if (line_e2 >= line_dy & line_e2 <= line_dx) begin
+                       line_err <= line_err + line_dy + line_dx;
+                       line_x   <= line_x + line_sx;
+                       line_y   <= line_y + line_sy;
+                     end else if (line_e2 >= line_dy) begin
+                       line_err <= line_err + line_dy;
+                       line_x   <= line_x + line_sx;
+                     end else if (line_e2 <= line_dx) begin
+                       line_err <= line_err + line_dx;
+                       line_y   <= line_y + line_sy;
+                     end
+                   end
+      // FILL, COPY_WRITE and GLYPH step through the rectangle
+      default    : if (advance) begin
+                     if (cx == size_x - 1) begin
+                       cx <= '0;
+                       cy <= cy + 1;
+                     end else begin
+                       cx <= cx + 1;
+                     end
+                     if (last_pixel)               state <= IDLE;
+                     else if (state == COPY_WRITE) state <= COPY_READ;
+                   end
+    endcase
+endmodule
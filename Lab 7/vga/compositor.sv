@@ -0,0 +1,104 @@
+// compositor.sv
+// Alpha compositing of the text, framebuffer and tile layers over the
+// background for videoGen. Each layer has an 8 bit alpha and a slot
+// in the stacking order, set with OP_CONTROL registers; where a layer
+// covers a pixel it is blended over the layers below with weight
+// alpha+1 of 256, so alpha 255 is opaque. The power-up settings,
+// all opaque and text over framebuffer over tiles, give the same
+// picture as choosing the topmost covering layer.
+//
+// Layer colors are premultiplied by their weights in the first stage,
+// with the rounding term added, so each later stage is one multiply
+// and add per channel:
+//   out = (color*weight + 128 + below*(256 - weight)) / 256
+// A layer that does not cover the pixel has weight 0, and passes the
+// pixel below through unchanged, as does an opaque layer its color.
+// With one stage per slot, the compositor takes a pixel every clock
+// at any depth; host/sim/compositor_check.cpp checks it against
+// video_model's composite_pixel.
+//
+// videoGen composites the next line, ahead of the display, and keeps
+// the result in one line buffer, so its stages do not add to the
+// latency of the display.
+
+// Applies OP_CONTROL registers 1 to 4, and produces rgb 4 clocks
+// after the layer colors arrive.
+module compositor(input  logic        clk,
+                  input  logic [31:0] command,
+                  input  logic        command_valid,
+                  input  logic        in_text, in_framebuffer, in_tile,
+                  input  logic [23:0] text_rgb, framebuffer_rgb, tile_rgb,
+                  input  logic [23:0] background_rgb,
+                  output logic [23:0] rgb);
+  import vga_commands::*;
+
+  typedef struct packed {
+    logic [2:0][15:0] color;    // premultiplied channels, as in rgb
+    logic [8:0]       inverse;  // 256 - weight
+  } slot_t;
+
+  // layer 0 text, 1 framebuffer, 2 tiles; order holds the layer in
+  // each slot, top first, and 3 leaves a slot empty
+  logic [7:0]       alpha[3] = '{8'hFF, 8'hFF, 8'hFF};
+  logic [2:0][1:0]  order    = {2'd2, 2'd1, 2'd0};
+  logic [2:0]       covered;
+  logic [2:0][23:0] layer_rgb;
+  slot_t            slot_1[3];
+  slot_t            top_2, top_3, middle_2;
+  logic [23:0]      below_1, below_2, below_3;
+
+  always_ff @(posedge clk)
+    if (command_valid & opcode(command) == OP_CONTROL)
+      case (command[27:24])
+        4'd1    : alpha[0] <= command[7:0];
+        4'd2    : alpha[1] <= command[7:0];
+        4'd3    : alpha[2] <= command[7:0];
+        4'd4    : order    <= command[5:0];
+        default : ;
+      endcase
+
+  assign covered   = {in_tile, in_framebuffer, in_text};
+  assign layer_rgb = {tile_rgb, framebuffer_rgb, text_rgb};
+
+  // stage 1: the layer in each slot, premultiplied
+  always_ff @(posedge clk) begin
+    for (int i = 0; i < 3; i++)
+      slot_1[i] <= premultiply(order[i] != 2'd3 & covered[order[i]],
+                               layer_rgb[order[i]], alpha[order[i]]);
+    below_1 <= background_rgb;
+  end
+
+  // stages 2 to 4: each slot over the ones below it, bottom first
+  always_ff @(posedge clk) begin
+    below_2  <= over(slot_1[2], below_1);
+    middle_2 <= slot_1[1];
+    top_2    <= slot_1[0];
+    below_3  <= over(middle_2, below_2);
+    top_3    <= top_2;
+    rgb      <= over(top_3, below_3);
+  end
+
+  function automatic slot_t premultiply(input logic        shown,
+                                        input logic [23:0] color,
+                                        input logic [7:0]  alpha);
+    logic [8:0] weight;
+    slot_t      slot;
+    weight = shown ? alpha + 9'd1 : 9'd0;
+    for (int c = 0; c < 3; c++)
+      slot.color[c] = weight * color[8*c +: 8] + 16'd128;
+    slot.inverse = 9'd256 - weight;
+    return slot;
+  endfunction
+
+  // the sums are at most 256*255 + 128, so no channel overflows
+  function automatic logic [23:0] over(input slot_t       slot,
+                                       input logic [23:0] below);
+    logic [15:0] sum;
+    logic [23:0] blended;
+    for (int c = 0; c < 3; c++) begin
+      sum = slot.color[c] + slot.inverse * below[8*c +: 8];
+      blended[8*c +: 8] = sum[15:8];
+    end
+    return blended;
+  endfunction
+endmodule
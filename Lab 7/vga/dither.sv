@@ -0,0 +1,56 @@
+// dither.sv
+// Output dither for video DACs narrower than the 8 bits per channel
+// that videoGen produces. Each channel gets an offset from a 4x4
+// ordered (Bayer) threshold before the low bits are dropped, so a
+// smooth gradient such as the background turns into a fine pattern
+// rather than bands. phase rotates the thresholds from frame to
+// frame, so over four frames each pixel averages to a quarter of a
+// DAC step finer still.
+
+// reduces rgb to DAC_BITS (4 to 8) bits per channel, left aligned in
+// each byte so the DAC takes the top bits, for the pixel at x, y
+// (the low two bits of each) in frame phase. rgb_out is
+// combinational; with DAC_BITS = 8 it is rgb.
+module dither #(parameter DAC_BITS = 8)
+              (input  logic [1:0]  x, y,
+               input  logic [1:0]  phase,
+               input  logic [23:0] rgb,
+               output logic [23:0] rgb_out);
+  localparam DROP = 8 - DAC_BITS;
+
+  function automatic logic [3:0] bayer(input logic [1:0] x, y);
+    case ({y, x})
+      4'h0: return 4'd0;   4'h1: return 4'd8;
+      4'h2: return 4'd2;   4'h3: return 4'd10;
+      4'h4: return 4'd12;  4'h5: return 4'd4;
+      4'h6: return 4'd14;  4'h7: return 4'd6;
+      4'h8: return 4'd3;   4'h9: return 4'd11;
+      4'hA: return 4'd1;   4'hB: return 4'd9;
+      4'hC: return 4'd15;  4'hD: return 4'd7;
+      4'hE: return 4'd13;  default: return 4'd5;
+    endcase
+  endfunction
+
+  // add the offset, saturating, then clear the bits the DAC drops
+  function automatic logic [7:0] channel(input logic [7:0] value,
+                                         input logic [7:0] offset);
+    logic [8:0] sum;
+    sum = value + offset;
+    return (sum[8] ? 8'hFF : sum[7:0]) & (8'hFF << DROP);
+  endfunction
+
+  generate
+    if (DROP == 0) begin
+      assign rgb_out = rgb;
+    end else begin
+      logic [3:0] threshold;
+      logic [7:0] offset;
+
+      assign threshold = bayer(x, y) + {phase, 2'b00};
+      assign offset    = threshold >> (4 - DROP);
+      assign rgb_out   = {channel(rgb[23:16], offset),
+                          channel(rgb[15: 8], offset),
+                          channel(rgb[ 7: 0], offset)};
+    end
+  endgenerate
+endmodule
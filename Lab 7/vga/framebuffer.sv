@@ -0,0 +1,156 @@
+// framebuffer.sv
+// Indexed-color framebuffer layer for vga.sv: 320x240 pixels at
+// 8 bits per pixel, looked up in a 256 entry palette and shown at
+// 640x480 by doubling each pixel in x and y. Both memories are
+// built from byte_enabled_simple_dual_port_ram (SystemVerilog1.sv),
+// writing a single byte lane per command.
+//
+// With FORMAT "RGB332" each pixel is instead a direct color, 3 bits
+// of red, 3 of green and 2 of blue, widened to 8 bits per channel by
+// repeating the bits, and the palette is left out. Images for this
+// format are best dithered on the host when they are converted.
+//
+// The pixels are double buffered: the front page is shown while
+// OP_PIXEL writes the back page. A write to OP_CONTROL register 6
+// with bit 0 set asks for the pages to be swapped, which happens on
+// the first frame pulse with blit_busy low, so a frame never shows two
+// pages and a blit or packed image still being drawn lands whole in
+// the page that is shown. The swap has its own register so that
+// asking for it leaves register 0, which shows or hides the
+// framebuffer, alone. flip_pending is high from the request until the
+// swap; the PIC polls it before drawing the next image, since pixels
+// written while it is high land in the page about to be shown.
+//
+// The blitter (blitter.sv) and the unpacker for compressed images
+// (unpacker.sv) draw into the back page as well. OP_PIXEL commands
+// take the write port first, then the unpacker, then the blitter,
+// and the blitter reads for copies only while the display is not
+// reading, in the blanking. blit_busy is high while either of them
+// has work left, and command_lost pulses for a command that found
+// the blitter's or the unpacker's queue full.
+
+// Applies OP_PIXEL, OP_PALETTE and OP_CONTROL commands, passes
+// OP_BLIT and OP_PIXEL_PACKED to the blitter and unpacker, and produces
+// the framebuffer color for x, y 3 clocks after they arrive, with
+// in_frame high where the framebuffer is shown. frame is the one
+// clock pulse per frame from videoGen, during vertical blanking.
+module framebuffer #(parameter FORMAT = "PALETTE")
+                  (input  logic        clk,
+                   input  logic        frame,
+                   input  logic [31:0] command,
+                   input  logic        command_valid,
+                   input  logic [10:0] x, y,
+                   output logic        in_frame,
+                   output logic [23:0] rgb,
+                   output logic        flip_pending,
+                   output logic        blit_busy,
+                   output logic        command_lost);
+  import vga_commands::*;
+
+  localparam FB_WIDTH  = 320;
+  localparam FB_HEIGHT = 240;
+  localparam FB_PIXELS = FB_WIDTH*FB_HEIGHT;
+  localparam PAGE_WORDS = FB_PIXELS/4;
+
+  logic        enabled, front_page;
+  logic        pixel_we, palette_we, show, flip;
+  logic [15:0] pixel_waddr, pixel_raddr, page_offset;
+  logic [31:0] pixel_word, palette_word;
+  logic [16:0] pixel_index;
+  logic        display_read;
+  logic        blit_we, blit_read, blitter_busy;
+  logic [16:0] blit_waddr, blit_raddr;
+  logic [7:0]  blit_color;
+  logic        unpack_we, unpack_busy;
+  logic        blit_dropped, unpack_dropped;
+  logic [16:0] unpack_waddr;
+  logic [7:0]  unpack_color;
+  logic [16:0] write_index;
+  logic [7:0]  write_data;
+  logic [1:0]  lane_1, lane_2;
+  logic        in_1, in_2, in_3;
+  logic [7:0]  color_index;
+
+  // write side: one byte lane of a 4 pixel word per command
+  assign pixel_we   = command_valid & opcode(command) == OP_PIXEL &
+                      command[24:8] < FB_PIXELS;
+  assign palette_we = command_valid & opcode(command) == OP_PALETTE;
+
+  pixel_unpacker unpack(clk, command, command_valid,
+                        unpack_we, unpack_waddr, unpack_color, ~pixel_we,
+                        unpack_busy, unpack_dropped);
+  blitter blit(clk, command, command_valid,
+               blit_we, blit_waddr, blit_color, ~pixel_we & ~unpack_we,
+               blit_read, blit_raddr, ~display_read, pixel_word,
+               blitter_busy, blit_dropped);
+  assign blit_busy    = blitter_busy | unpack_busy;
+  assign command_lost = blit_dropped | unpack_dropped;
+  assign show      = command_valid & opcode(command) == OP_CONTROL &
+                     command[27:24] == 4'd0;
+  assign flip      = command_valid & opcode(command) == OP_CONTROL &
+                     command[27:24] == 4'd6 & command[0];
+
+  // pixels are written to the page that is not shown
+  assign page_offset = front_page ? 16'd0 : PAGE_WORDS;
+  assign write_index = pixel_we  ? command[24:8] :
+                       unpack_we ? unpack_waddr : blit_waddr;
+  assign write_data  = pixel_we  ? command[7:0] :
+                       unpack_we ? unpack_color : blit_color;
+  assign pixel_waddr = write_index[16:2] + page_offset;
+
+  always_ff @(posedge clk) begin
+    if (show)
+      enabled <= command[0];
+    if (frame & flip_pending & ~blit_busy) begin
+      front_page   <= ~front_page;
+      flip_pending <= 1'b0;
+    end else if (flip)
+      flip_pending <= 1'b1;
+  end
+
+  byte_enabled_simple_dual_port_ram #(.ADDR_WIDTH(16), .WORDS(2*PAGE_WORDS))
+    pixels(.waddr(pixel_waddr), .raddr(pixel_raddr),
+           .be(4'b0001 << write_index[1:0]), .wdata(write_data),
+           .we(pixel_we | unpack_we | blit_we), .clk(clk), .q(pixel_word));
+
+  generate
+    if (FORMAT == "RGB332") begin
+      logic [7:0] color_3;
+      always_ff @(posedge clk) color_3 <= color_index;
+      assign palette_word = {8'b0,
+                             color_3[7:5], color_3[7:5], color_3[7:6],
+                             color_3[4:2], color_3[4:2], color_3[4:3],
+                             {4{color_3[1:0]}}};
+    end else begin
+      byte_enabled_simple_dual_port_ram #(.ADDR_WIDTH(8))
+        palette(.waddr(command[15:8]), .raddr(color_index),
+                .be(4'b0001 << command[17:16]), .wdata(command[7:0]),
+                .we(palette_we), .clk(clk), .q(palette_word));
+    end
+  endgenerate
+
+  // read side, stage 1: the doubled pixel address, y*320 + x
+  // the blitter reads the back page when the display does not read
+  assign pixel_index  = {y[8:1], 8'b0} + {y[8:1], 6'b0} + x[9:1];
+  assign display_read = (x < 2*FB_WIDTH) & (y < 2*FB_HEIGHT);
+
+  always_ff @(posedge clk) begin
+    pixel_raddr <= display_read ? pixel_index[16:2] + (front_page ? PAGE_WORDS
+                                                                  : 16'd0)
+                                : blit_raddr[16:2] + page_offset;
+    lane_1      <= pixel_index[1:0];
+    in_1        <= display_read;
+  end
+
+  // stage 2: the pixel word is read; pick this pixel's index
+  always_ff @(posedge clk) begin
+    lane_2 <= lane_1;
+    in_2   <= in_1;
+  end
+  assign color_index = pixel_word[8*lane_2 +: 8];
+
+  // stage 3: the palette entry is read, or the RGB332 color widened
+  always_ff @(posedge clk) in_3 <= in_2;
+  assign rgb      = palette_word[23:0];
+  assign in_frame = in_3 & enabled;
+endmodule
@@ -0,0 +1,99 @@
+// hit_test.sv
+// Widget hit testing for vga.sv. The PIC loads a table of up to 64
+// rectangles, the bounds of its on-screen widgets, with OP_HIT_RECT,
+// and once per frame, after the cursor has moved, the table is
+// searched for the cursor position, one rectangle per clock. The
+// lowest numbered rectangle in use that holds the cursor is the
+// topmost, so overlapping widgets are listed from the top down.
+//
+// The result goes into the SPI status word with the buttons the
+// cursor was drawn with, so the firmware reads which widget was
+// clicked instead of searching its own list on every mouse event.
+// It is published about 70 clocks after the frame pulse, the rising
+// edge of vsync in vertical blanking, and holds until the next
+// frame's search is done.
+
+// Applies OP_HIT_RECT commands, and searches the table for
+// x_cursor, y_cursor at each frame. hit is high when a rectangle
+// holds the cursor, and hit_id is then the topmost one.
+module hit_tester(input  logic        clk,
+                  input  logic        vsync,
+                  input  logic [31:0] command,
+                  input  logic        command_valid,
+                  input  logic [9:0]  x_cursor, y_cursor,
+                  input  logic [2:0]  buttons,
+                  output logic        hit,
+                  output logic [5:0]  hit_id,
+                  output logic [2:0]  hit_buttons);
+  import vga_commands::*;
+
+  localparam RECTS = 64;
+
+  // right and bottom are inclusive
+  logic [9:0]       left[0:RECTS-1], top[0:RECTS-1];
+  logic [9:0]       right[0:RECTS-1], bottom[0:RECTS-1];
+  logic [RECTS-1:0] in_use = '0;
+
+  logic             old_vsync, frame, start, scanning, checking;
+  logic [5:0]       index, checked_index, found_id;
+  logic             found, inside, in_use_q;
+  logic [9:0]       left_q, top_q, right_q, bottom_q;
+  logic [9:0]       cursor_x, cursor_y;
+  logic [2:0]       cursor_buttons;
+
+  // write side
+  always_ff @(posedge clk)
+    if (command_valid & opcode(command) == OP_HIT_RECT)
+      case (command[21:20])
+        2'd0 : begin
+                 in_use[command[27:22]] <= command[15];
+                 left[command[27:22]]   <= command[9:0];
+               end
+        2'd1 : top[command[27:22]]    <= command[9:0];
+        2'd2 : right[command[27:22]]  <= command[9:0];
+        2'd3 : bottom[command[27:22]] <= command[9:0];
+      endcase
+
+  // mouse_reader moves the cursor at the frame pulse, so the search
+  // starts the clock after
+  assign frame = vsync & ~old_vsync;
+
+  always_ff @(posedge clk) begin
+    old_vsync <= vsync;
+    start     <= frame;
+    if (start) begin
+      scanning <= 1'b1;
+      index    <= '0;
+      {cursor_x, cursor_y, cursor_buttons} <= {x_cursor, y_cursor, buttons};
+    end else if (scanning) begin
+      index <= index + 1;
+      if (index == RECTS-1) scanning <= 1'b0;
+    end
+  end
+
+  // stage 1: read the rectangle at index
+  always_ff @(posedge clk) begin
+    {left_q, top_q, right_q, bottom_q} <=
+        {left[index], top[index], right[index], bottom[index]};
+    in_use_q      <= in_use[index];
+    checking      <= scanning;
+    checked_index <= index;
+  end
+
+  // stage 2: compare, keeping the first rectangle that holds the
+  // cursor, and publish after the last
+  assign inside = in_use_q & cursor_x >= left_q & cursor_x <= right_q &
+                  cursor_y >= top_q & cursor_y <= bottom_q;
+
+  always_ff @(posedge clk) begin
+    if (start)
+      found <= 1'b0;
+    else if (checking & inside & ~found)
+      {found, found_id} <= {1'b1, checked_index};
+    if (checking & checked_index == RECTS-1) begin
+      hit         <= found | inside;
+      hit_id      <= found ? found_id : checked_index;
+      hit_buttons <= cursor_buttons;
+    end
+  end
+endmodule
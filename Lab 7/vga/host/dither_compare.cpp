@@ -0,0 +1,162 @@
+/*      dither_compare.cpp
+        Compares the reduced-color output paths of vga.sv with the
+        24-bit background they approximate.
+
+        Build: g++ -std=c++17 -O2 -pthread -o dither_compare \
+                   dither_compare.cpp video_model.cpp
+        Usage: dither_compare [frame] [out_prefix]
+
+        For the background of frame frame (default 100), prints the RMS
+        error of each path against the 24-bit frame, both per pixel and
+        over 4x4 blocks, which is closer to what the eye sees of a fine
+        pattern. The paths are a narrower DAC with the low bits dropped,
+        with dither, and with dither averaged over the four frame
+        phases, and an RGB332 framebuffer loaded with the image as is
+        or dithered by to_rgb332. With out_prefix, each path is written
+        as out_prefix<path>.ppm next to out_prefixreference.ppm. */
+
+#include "video_model.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <string>
+#include <vector>
+
+using namespace video_model;
+
+namespace {
+
+typedef std::vector<uint32_t> Frame;
+
+unsigned channel(uint32_t rgb, unsigned c)
+{
+    return (rgb >> (8 * c)) & 0xFF;
+}
+
+/* Returns the RMS channel error per pixel, or of 4x4 block means. */
+double rms_error(const Frame& a, const Frame& b, unsigned block)
+{
+    double sum = 0;
+    size_t count = 0;
+    for (unsigned by = 0; by < HEIGHT; by += block)
+        for (unsigned bx = 0; bx < WIDTH; bx += block)
+            for (unsigned c = 0; c < 3; ++c) {
+                double diff = 0;
+                for (unsigned y = by; y < by + block; ++y)
+                    for (unsigned x = bx; x < bx + block; ++x) {
+                        size_t i = size_t(y) * WIDTH + x;
+                        diff += double(channel(a[i], c)) - channel(b[i], c);
+                    }
+                diff /= block * block;
+                sum += diff * diff;
+                ++count;
+            }
+    return std::sqrt(sum / count);
+}
+
+Frame map_frame(const Frame& in,
+                const std::function<uint32_t(uint32_t, unsigned, unsigned)>& f)
+{
+    Frame out(in.size());
+    for (unsigned y = 0; y < HEIGHT; ++y)
+        for (unsigned x = 0; x < WIDTH; ++x)
+            out[size_t(y) * WIDTH + x] = f(in[size_t(y) * WIDTH + x], x, y);
+    return out;
+}
+
+/* the four dithered phases averaged, as the eye sees them at 60 Hz */
+Frame temporal_average(const Frame& in, unsigned dac_bits)
+{
+    Frame out(in.size());
+    for (unsigned y = 0; y < HEIGHT; ++y)
+        for (unsigned x = 0; x < WIDTH; ++x) {
+            size_t   i = size_t(y) * WIDTH + x;
+            unsigned sums[3] = {0, 0, 0};
+            for (unsigned phase = 0; phase < 4; ++phase) {
+                uint32_t rgb = dither_pixel(in[i], x, y, phase, dac_bits);
+                for (unsigned c = 0; c < 3; ++c)
+                    sums[c] += channel(rgb, c);
+            }
+            out[i] = ((sums[2] / 4) << 16) | ((sums[1] / 4) << 8) | (sums[0] / 4);
+        }
+    return out;
+}
+
+bool write_ppm(const std::string& path, const Frame& frame)
+{
+    FILE* f = std::fopen(path.c_str(), "wb");
+    if (!f)
+        return false;
+    std::fprintf(f, "P6\n%u %u\n255\n", WIDTH, HEIGHT);
+    for (uint32_t rgb : frame) {
+        unsigned char bytes[3] = {uint8_t(rgb >> 16), uint8_t(rgb >> 8),
+                                  uint8_t(rgb)};
+        std::fwrite(bytes, 1, 3, f);
+    }
+    return std::fclose(f) == 0;
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    unsigned    frame_number = argc > 1 ? unsigned(std::atoi(argv[1])) : 100;
+    const char* prefix       = argc > 2 ? argv[2] : nullptr;
+
+    // the background alone, with the cursor off the screen
+    FrameState state = {uint16_t(frame_number & 0x7FF), 1023, 1023, 0};
+    Frame reference(size_t(WIDTH) * HEIGHT);
+    render_frame(reference.data(), state);
+
+    struct Path {
+        std::string name;
+        Frame       frame;
+    };
+    std::vector<Path> paths;
+    for (unsigned bits = 4; bits <= 6; ++bits) {
+        std::string dac = "dac" + std::to_string(bits);
+        uint32_t    keep = (0xFFu << (8 - bits)) & 0xFF;
+        paths.push_back({dac + "_truncated",
+                         map_frame(reference, [=](uint32_t rgb, unsigned,
+                                                  unsigned) {
+                             return rgb & (keep * 0x010101);
+                         })});
+        paths.push_back({dac + "_dithered",
+                         map_frame(reference, [=](uint32_t rgb, unsigned x,
+                                                  unsigned y) {
+                             return dither_pixel(rgb, x, y, frame_number & 3,
+                                                 bits);
+                         })});
+        paths.push_back({dac + "_temporal", temporal_average(reference, bits)});
+    }
+    paths.push_back({"rgb332_truncated",
+                     map_frame(reference, [](uint32_t rgb, unsigned, unsigned) {
+                         return from_rgb332(uint8_t(((rgb >> 16) & 0xE0) |
+                                                    ((rgb >> 11) & 0x1C) |
+                                                    ((rgb >> 6) & 0x03)));
+                     })});
+    paths.push_back({"rgb332_dithered",
+                     map_frame(reference, [](uint32_t rgb, unsigned x,
+                                             unsigned y) {
+                         return from_rgb332(to_rgb332(rgb, x, y));
+                     })});
+
+    std::printf("%-18s %10s %10s\n", "path", "rms/pixel", "rms/4x4");
+    for (const Path& p : paths)
+        std::printf("%-18s %10.2f %10.2f\n", p.name.c_str(),
+                    rms_error(reference, p.frame, 1),
+                    rms_error(reference, p.frame, 4));
+
+    if (prefix) {
+        bool ok = write_ppm(prefix + std::string("reference.ppm"), reference);
+        for (const Path& p : paths)
+            ok = write_ppm(prefix + p.name + ".ppm", p.frame) && ok;
+        if (!ok) {
+            std::fprintf(stderr, "cannot write the frames to %s\n", prefix);
+            return 1;
+        }
+    }
+    return 0;
+}
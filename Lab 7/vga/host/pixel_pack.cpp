@@ -0,0 +1,465 @@
+/*      pixel_pack.cpp
+        Host-side compressor for framebuffer images, producing the
+        OP_PIXEL_PACKED streams decoded by unpacker.sv.
+
+        Build: g++ -std=c++17 -O2 -pthread -o pixel_pack \
+                   pixel_pack.cpp video_model.cpp
+        Usage: pixel_pack [-b burst_bytes] [-s spi_hz] [-p pixel_hz]
+                          input output
+               pixel_pack --demo [-s spi_hz] [-p pixel_hz]
+
+        input is a 320x240 binary PGM, whose gray levels are used as
+        palette indices, or a binary PPM, converted to RGB332 with
+        ordered dither for an RGB332 framebuffer. output receives the
+        SPI bursts, headers included, ready to send in one or more
+        frames; bursts are burst_bytes long (default 64, the unpacker's
+        FIFO) so the PIC can wait for blit_busy between them at fast
+        SPI clocks.
+
+        Every stream is decoded again with a model of the unpacker and
+        compared with the image before anything is written. --demo
+        does this for built-in sample images and prints their sizes and
+        the upload time at spi_hz (default 8 MHz) against OP_PIXEL.
+
+        The upload time is that of the SPI link alone and that with the
+        unpacker's decode at pixel_hz (default 25.175 MHz, 640x480),
+        2 clocks for every copied pixel, and the PIC waiting for
+        blit_busy to fall before each burst after the first. Also
+        printed is the number of stream bytes that would find the
+        unpacker's queue full, and be dropped, if the PIC sent the
+        bursts back to back instead. */
+
+#include "video_model.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <string>
+#include <vector>
+
+namespace {
+
+const unsigned FB_WIDTH   = 320;
+const unsigned FB_HEIGHT  = 240;
+const size_t   FB_PIXELS  = size_t(FB_WIDTH) * FB_HEIGHT;
+const size_t   WINDOW     = 4096;
+const size_t   MAX_RUN    = 66;    // runs and copies, L+3
+const size_t   MAX_LITERAL = 128;  // literals, L+1
+const size_t   MIN_COPY   = 4;     // a 3 pixel copy saves nothing
+const unsigned BURST_ELEMENTS = 2048;
+const unsigned HEADER_BYTES   = 4;
+const size_t   QUEUE_BYTES    = 64;    // 2**QUEUE_ADDR_BITS of unpacker.sv
+const unsigned PORT_CLOCKS    = 6;     // SPI FIFO, command register, queue
+const uint8_t  OP_PIXEL        = 0x1;
+const uint8_t  OP_PIXEL_PACKED = 0xD;
+
+typedef std::vector<uint8_t> Bytes;
+
+/*
+ * compress
+ *
+ * Greedy LZ77 with runs: at each pixel, the longer of the run of
+ * equal pixels and the longest match in the window found through
+ * hash chains is taken when long enough to save bytes; other pixels
+ * collect into literal tokens.
+ */
+Bytes compress(const Bytes& pixels, uint32_t start_address)
+{
+    Bytes out = {uint8_t(start_address >> 16), uint8_t(start_address >> 8),
+                 uint8_t(start_address)};
+    std::vector<int32_t> head(1 << 16, -1), prev(pixels.size(), -1);
+    size_t literal_start = 0, literal_count = 0;
+
+    auto hash = [&](size_t i) {
+        return (pixels[i] * 2654435761u ^ pixels[i + 1] * 40503u ^
+                pixels[i + 2]) & 0xFFFF;
+    };
+    auto insert = [&](size_t i) {
+        if (i + 2 < pixels.size()) {
+            unsigned h = hash(i);
+            prev[i] = head[h];
+            head[h] = int32_t(i);
+        }
+    };
+    auto flush_literals = [&]() {
+        while (literal_count) {
+            size_t n = std::min(literal_count, MAX_LITERAL);
+            out.push_back(uint8_t(n - 1));
+            out.insert(out.end(), pixels.begin() + literal_start,
+                       pixels.begin() + literal_start + n);
+            literal_start += n;
+            literal_count -= n;
+        }
+    };
+
+    for (size_t i = 0; i < pixels.size(); ) {
+        size_t limit = std::min(MAX_RUN, pixels.size() - i);
+        size_t run = 1;
+        while (run < limit && pixels[i + run] == pixels[i])
+            ++run;
+
+        size_t match = 0, distance = 0;
+        if (i + 2 < pixels.size()) {
+            for (int32_t j = head[hash(i)], tries = 0;
+                 j >= 0 && i - j <= WINDOW && tries < 64; j = prev[j], ++tries) {
+                size_t n = 0;
+                while (n < limit && pixels[j + n] == pixels[i + n])
+                    ++n;
+                if (n > match) {
+                    match    = n;
+                    distance = i - j;
+                }
+            }
+        }
+
+        size_t taken;
+        if (run >= 3 && run >= match) {
+            flush_literals();
+            out.push_back(uint8_t(0x80 | (run - 3)));
+            out.push_back(pixels[i]);
+            taken = run;
+        } else if (match >= MIN_COPY) {
+            flush_literals();
+            out.push_back(uint8_t(0xC0 | (match - 3)));
+            out.push_back(uint8_t((distance - 1) >> 8));
+            out.push_back(uint8_t(distance - 1));
+            taken = match;
+        } else {
+            if (!literal_count)
+                literal_start = i;
+            ++literal_count;
+            taken = 1;
+        }
+        for (size_t k = 0; k < taken; ++k)
+            insert(i + k);
+        i += taken;
+    }
+    flush_literals();
+    return out;
+}
+
+/* Decodes a stream as unpacker.sv does, into a framebuffer. */
+bool decompress(const Bytes& stream, Bytes* framebuffer)
+{
+    if (stream.size() < 3)
+        return false;
+    uint32_t pixel = ((stream[0] & 1u) << 16) | (stream[1] << 8) | stream[2];
+    uint8_t  window[WINDOW];
+    size_t   position = 0;
+    auto put = [&](uint8_t p) {
+        if (pixel < FB_PIXELS)
+            (*framebuffer)[pixel] = p;
+        ++pixel;
+        window[position++ % WINDOW] = p;
+    };
+    for (size_t i = 3; i < stream.size(); ) {
+        uint8_t token = stream[i++];
+        if (!(token & 0x80)) {
+            for (unsigned n = 0; n <= token; ++n) {
+                if (i >= stream.size())
+                    return false;
+                put(stream[i++]);
+            }
+        } else if (!(token & 0x40)) {
+            if (i >= stream.size())
+                return false;
+            uint8_t p = stream[i++];
+            for (unsigned n = 0; n < (token & 0x3Fu) + 3; ++n)
+                put(p);
+        } else {
+            if (i + 1 >= stream.size())
+                return false;
+            size_t distance = (((stream[i] & 0xFu) << 8) | stream[i + 1]) + 1;
+            i += 2;
+            for (unsigned n = 0; n < (token & 0x3Fu) + 3; ++n)
+                put(window[(position - distance) % WINDOW]);
+        }
+    }
+    return true;
+}
+
+/* Splits elements for op into SPI bursts, starting at address. */
+Bytes bursts(uint8_t op, const Bytes& elements, uint32_t address,
+             unsigned burst_bytes)
+{
+    Bytes out;
+    for (size_t i = 0; i < elements.size(); i += burst_bytes) {
+        size_t   n      = std::min<size_t>(burst_bytes, elements.size() - i);
+        uint32_t header = (uint32_t(op) << 28) |
+                          (((address + uint32_t(i)) & 0x1FFFF) << 11) |
+                          uint32_t(n - 1);
+        for (int shift = 24; shift >= 0; shift -= 8)
+            out.push_back(uint8_t(header >> shift));
+        out.insert(out.end(), elements.begin() + i, elements.begin() + i + n);
+    }
+    return out;
+}
+
+bool read_image(const char* path, Bytes* pixels)
+{
+    FILE* f = std::fopen(path, "rb");
+    if (!f)
+        return false;
+    char     magic[3] = {0};
+    unsigned width, height, max_value;
+    bool ok = std::fscanf(f, "%2s %u %u %u", magic, &width, &height,
+                          &max_value) == 4 &&
+              std::fgetc(f) != EOF && width == FB_WIDTH &&
+              height == FB_HEIGHT && max_value == 255 &&
+              (!std::strcmp(magic, "P5") || !std::strcmp(magic, "P6"));
+    if (ok) {
+        bool   color = !std::strcmp(magic, "P6");
+        Bytes  raw(FB_PIXELS * (color ? 3 : 1));
+        ok = std::fread(raw.data(), 1, raw.size(), f) == raw.size();
+        pixels->resize(FB_PIXELS);
+        for (size_t i = 0; ok && i < FB_PIXELS; ++i) {
+            if (!color) {
+                (*pixels)[i] = raw[i];
+            } else {
+                uint32_t rgb = (raw[3 * i] << 16) | (raw[3 * i + 1] << 8) |
+                               raw[3 * i + 2];
+                (*pixels)[i] = video_model::to_rgb332(rgb, i % FB_WIDTH,
+                                                      i / FB_WIDTH);
+            }
+        }
+    }
+    std::fclose(f);
+    return ok;
+}
+
+/* sample images for --demo */
+Bytes demo_ui()
+{
+    Bytes img(FB_PIXELS, 0x24);
+    auto fill = [&](unsigned x0, unsigned y0, unsigned w, unsigned h,
+                    uint8_t c) {
+        for (unsigned y = y0; y < y0 + h; ++y)
+            for (unsigned x = x0; x < x0 + w; ++x)
+                img[y * FB_WIDTH + x] = c;
+    };
+    for (unsigned x = 0; x < FB_WIDTH; ++x)         // title bar gradient
+        fill(x, 0, 1, 16, uint8_t(0x03 | ((x / 40) << 5)));
+    fill(8, 24, 140, 200, 0x92);                     // panels with borders
+    fill(10, 26, 136, 196, 0xDB);
+    fill(160, 24, 152, 96, 0x6D);
+    fill(160, 128, 152, 96, 0x49);
+    uint32_t seed = 12345;                           // lines of "text"
+    for (unsigned line = 0; line < 18; ++line)
+        for (unsigned x = 16; x < 140; ++x)
+            for (unsigned row = 0; row < 7; ++row) {
+                seed = seed * 1103515245 + 12345;
+                if ((seed >> 16) % 3 == 0 && (x / 6 + line) % 7)
+                    img[(30 + line * 10 + row) * FB_WIDTH + x] = 0x00;
+            }
+    for (unsigned b = 0; b < 4; ++b) {               // buttons
+        fill(170 + b * 34, 140, 28, 14, 0xFF);
+        fill(172 + b * 34, 142, 24, 10, 0x1F);
+    }
+    return img;
+}
+
+Bytes demo_tiles()
+{
+    Bytes img(FB_PIXELS);
+    for (size_t i = 0; i < FB_PIXELS; ++i) {
+        unsigned x = i % FB_WIDTH, y = unsigned(i / FB_WIDTH);
+        unsigned tx = x % 16, ty = y % 16;
+        img[i] = uint8_t((tx == 0 || ty == 0) ? 0x00
+                         : (tx * tx + ty * ty < 64) ? 0xE0 + (x / 16) % 4
+                                                    : 0x1C);
+    }
+    return img;
+}
+
+Bytes demo_background()
+{
+    std::vector<uint32_t> frame(video_model::WIDTH * video_model::HEIGHT);
+    video_model::FrameState state = {100, 1023, 1023, 0};
+    video_model::render_frame(frame.data(), state);
+    Bytes img(FB_PIXELS);
+    for (unsigned y = 0; y < FB_HEIGHT; ++y)
+        for (unsigned x = 0; x < FB_WIDTH; ++x)
+            img[y * FB_WIDTH + x] = video_model::to_rgb332(
+                frame[(2 * y) * video_model::WIDTH + 2 * x], x, y);
+    return img;
+}
+
+double upload_seconds(size_t bytes, double spi_hz)
+{
+    return bytes * 8.0 / spi_hz;
+}
+
+/* For each stream byte, the unpacker clocks that follow the one it
+   is taken in before the next byte can be: the pixels of a run
+   after its value and the 2 clocks of each copied pixel after the
+   distance. Every other byte, literal pixels included, takes its one
+   clock only. The stream has been checked to decode. */
+std::vector<uint32_t> decode_clocks(const Bytes& stream)
+{
+    std::vector<uint32_t> clocks(stream.size(), 0);
+    for (size_t i = 3; i < stream.size(); ) {
+        uint8_t token = stream[i++];
+        if (!(token & 0x80))
+            i += token + 1u;
+        else if (!(token & 0x40))
+            clocks[i++] = (token & 0x3Fu) + 3;
+        else {
+            i += 2;
+            clocks[i - 1] = 2 * ((token & 0x3Fu) + 3);
+        }
+    }
+    return clocks;
+}
+
+struct Upload {
+    double seconds;        // to the last pixel written
+    size_t lost_unwaited;  // bytes finding the queue full, back to back
+};
+
+/*
+ * upload_time
+ *
+ * Element j of a burst ends (HEADER_BYTES + j + 1) SPI bytes after
+ * the burst starts and can be taken by the unpacker PORT_CLOCKS pixel
+ * clocks later, in a clock of its own and after the clocks of the
+ * bytes before. With wait, each burst after the first starts when
+ * blit_busy falls: the burst is sent and every byte of it taken, with
+ * the run or copy it ends in written. Without, bursts follow each
+ * other on the link, and a byte is counted lost when it enters the
+ * queue with QUEUE_BYTES bytes not yet taken; the decode goes on as
+ * if it had been kept.
+ */
+Upload upload_time(const Bytes& stream, unsigned burst_bytes, double spi_hz,
+                   double pixel_hz, bool wait)
+{
+    std::vector<uint32_t> clocks = decode_clocks(stream);
+    double   byte_clocks = 8 * pixel_hz / spi_hz;
+    double   start = 0;
+    uint64_t free  = 0;
+    std::deque<uint64_t> queued;  // the clocks queued bytes are taken in
+    Upload   upload = {0, 0};
+    for (size_t i = 0; i < stream.size(); i += burst_bytes) {
+        size_t n = std::min<size_t>(burst_bytes, stream.size() - i);
+        for (size_t j = 0; j < n; ++j) {
+            uint64_t ready = uint64_t(std::ceil(start + (HEADER_BYTES + j + 1) *
+                                                byte_clocks)) + PORT_CLOCKS;
+            uint64_t taken = std::max(ready, free);
+            free = taken + 1 + clocks[i + j];
+            // it enters the queue 2 clocks before empty shows it
+            while (!queued.empty() && queued.front() <= ready - 2)
+                queued.pop_front();
+            if (queued.size() >= QUEUE_BYTES)
+                ++upload.lost_unwaited;
+            queued.push_back(taken);
+        }
+        double sent = start + (HEADER_BYTES + n) * byte_clocks;
+        start = wait ? std::max(sent, double(free)) : sent;
+    }
+    upload.seconds = free / pixel_hz;
+    return upload;
+}
+
+/* Returns the compressed stream after checking it decodes to pixels. */
+bool pack(const Bytes& pixels, Bytes* stream)
+{
+    *stream = compress(pixels, 0);
+    Bytes check(FB_PIXELS, 0);
+    return decompress(*stream, &check) && check == pixels;
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    unsigned    burst_bytes = 64;
+    double      spi_hz      = 8e6;
+    double      pixel_hz    = 25.175e6;
+    bool        demo        = false;
+    const char* paths[2]    = {nullptr, nullptr};
+    unsigned    path_count  = 0;
+
+    for (int i = 1; i < argc; ++i) {
+        if (!std::strcmp(argv[i], "--demo"))
+            demo = true;
+        else if (!std::strcmp(argv[i], "-b") && i + 1 < argc)
+            burst_bytes = unsigned(std::atoi(argv[++i]));
+        else if (!std::strcmp(argv[i], "-s") && i + 1 < argc)
+            spi_hz = std::atof(argv[++i]);
+        else if (!std::strcmp(argv[i], "-p") && i + 1 < argc)
+            pixel_hz = std::atof(argv[++i]);
+        else if (path_count < 2)
+            paths[path_count++] = argv[i];
+    }
+    if (burst_bytes == 0 || burst_bytes > BURST_ELEMENTS || spi_hz <= 0 ||
+        pixel_hz <= 0 || (!demo && path_count != 2)) {
+        std::fprintf(stderr, "usage: pixel_pack [-b burst_bytes] [-s spi_hz] "
+                             "[-p pixel_hz] input output\n"
+                             "       pixel_pack --demo [-s spi_hz] [-p pixel_hz]\n");
+        return 2;
+    }
+
+    Bytes raw_bursts = bursts(OP_PIXEL, Bytes(FB_PIXELS), 0, BURST_ELEMENTS);
+
+    if (demo) {
+        struct Sample {
+            const char* name;
+            Bytes       pixels;
+        } samples[] = {{"ui", demo_ui()},
+                       {"tiles", demo_tiles()},
+                       {"background", demo_background()}};
+        std::printf("%-11s %8s %8s %7s %9s %9s %9s %13s\n", "image", "pixels",
+                    "packed", "ratio", "raw ms", "link ms", "packed ms",
+                    "bytes dropped");
+        for (const Sample& s : samples) {
+            Bytes stream;
+            if (!pack(s.pixels, &stream)) {
+                std::fprintf(stderr, "%s: stream does not decode\n", s.name);
+                return 1;
+            }
+            Bytes  packed   = bursts(OP_PIXEL_PACKED, stream, 0, burst_bytes);
+            Upload waited   = upload_time(stream, burst_bytes, spi_hz, pixel_hz, true);
+            Upload unwaited = upload_time(stream, burst_bytes, spi_hz, pixel_hz, false);
+            std::printf("%-11s %8zu %8zu %6.1fx %9.1f %9.1f %9.1f %13zu\n", s.name,
+                        s.pixels.size(), stream.size(),
+                        double(raw_bursts.size()) / packed.size(),
+                        1e3 * upload_seconds(raw_bursts.size(), spi_hz),
+                        1e3 * upload_seconds(packed.size(), spi_hz),
+                        1e3 * waited.seconds, unwaited.lost_unwaited);
+        }
+        return 0;
+    }
+
+    Bytes pixels, stream;
+    if (!read_image(paths[0], &pixels)) {
+        std::fprintf(stderr, "%s: not a 320x240 binary PGM or PPM\n", paths[0]);
+        return 1;
+    }
+    if (!pack(pixels, &stream)) {
+        std::fprintf(stderr, "%s: stream does not decode\n", paths[0]);
+        return 1;
+    }
+    Bytes packed = bursts(OP_PIXEL_PACKED, stream, 0, burst_bytes);
+    FILE* f = std::fopen(paths[1], "wb");
+    if (!f || std::fwrite(packed.data(), 1, packed.size(), f) != packed.size() ||
+        std::fclose(f) != 0) {
+        std::fprintf(stderr, "cannot write %s\n", paths[1]);
+        return 1;
+    }
+    Upload waited   = upload_time(stream, burst_bytes, spi_hz, pixel_hz, true);
+    Upload unwaited = upload_time(stream, burst_bytes, spi_hz, pixel_hz, false);
+    std::printf("%zu pixels -> %zu stream bytes, %zu with headers (%.1fx); "
+                "%.1f ms, %.1f ms of it on the link, instead of %.1f ms at %.0f Hz\n",
+                pixels.size(), stream.size(), packed.size(),
+                double(raw_bursts.size()) / packed.size(), 1e3 * waited.seconds,
+                1e3 * upload_seconds(packed.size(), spi_hz),
+                1e3 * upload_seconds(raw_bursts.size(), spi_hz), spi_hz);
+    if (unwaited.lost_unwaited)
+        std::printf("wait for blit_busy between bursts: sent back to back, %zu "
+                    "bytes would find the unpacker's queue full\n",
+                    unwaited.lost_unwaited);
+    return 0;
+}
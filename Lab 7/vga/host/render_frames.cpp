@@ -0,0 +1,159 @@
+/*      render_frames.cpp
+        Checks and times the video_model renderers, and writes frames
+        as images for looking at effects without the board.
+
+        Build: g++ -std=c++17 -O2 -pthread -o render_frames \
+                   render_frames.cpp video_model.cpp
+        Usage: render_frames [frames] [threads] [out_prefix]
+
+        Every kernel is first compared pixel by pixel with the scalar
+        reference video_pixel over a few frames. Then frames frames
+        (default 300) of an animation, the background running and the
+        cursor circling the screen, are rendered on one core with each
+        kernel into one frame buffer, then as one batch, a frame per
+        thread, into a buffer of all frames, on 1 thread and on threads
+        threads (default all cores), printing frames per second and the
+        speedup of the threads over 1 thread on the same batch. With
+        out_prefix, the batch is also written as out_prefix0000.ppm,
+        out_prefix0001.ppm, ... */
+
+#include "video_model.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace video_model;
+
+namespace {
+
+const size_t FRAME_PIXELS = size_t(WIDTH) * HEIGHT;
+
+FrameState animation(unsigned frame)
+{
+    double angle = frame * 0.05;
+    FrameState s;
+    s.counter  = uint16_t(frame & 0x7FF);
+    s.x_cursor = uint16_t(320 + 300 * std::cos(angle));
+    s.y_cursor = uint16_t(240 + 220 * std::sin(angle));
+    s.buttons  = uint8_t((frame / 32) & 7);
+    return s;
+}
+
+/* Returns the number of pixels that differ from video_pixel. */
+size_t check_kernel(Kernel kernel)
+{
+    std::vector<uint32_t> frame(FRAME_PIXELS);
+    size_t mismatches = 0;
+    // 2047 wraps the counter; the cursor at the edges clips its spans
+    const unsigned frames[] = {0, 1, 77, 2047};
+    for (unsigned f : frames) {
+        FrameState s = animation(f);
+        if (f == 2047) {
+            s.x_cursor = 0;
+            s.y_cursor = 479;
+        }
+        render_frame(frame.data(), s, kernel);
+        for (unsigned y = 0; y < HEIGHT; ++y)
+            for (unsigned x = 0; x < WIDTH; ++x)
+                if (frame[size_t(y) * WIDTH + x] != video_pixel(x, y, s))
+                    ++mismatches;
+    }
+    return mismatches;
+}
+
+double seconds_since(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                         start).count();
+}
+
+bool write_ppm(const std::string& path, const uint32_t* frame)
+{
+    FILE* f = std::fopen(path.c_str(), "wb");
+    if (!f)
+        return false;
+    std::fprintf(f, "P6\n%u %u\n255\n", WIDTH, HEIGHT);
+    for (size_t i = 0; i < FRAME_PIXELS; ++i) {
+        unsigned char rgb[3] = {uint8_t(frame[i] >> 16), uint8_t(frame[i] >> 8),
+                                uint8_t(frame[i])};
+        std::fwrite(rgb, 1, 3, f);
+    }
+    return std::fclose(f) == 0;
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    unsigned frames  = argc > 1 ? unsigned(std::atoi(argv[1])) : 300;
+    unsigned threads = argc > 2 ? unsigned(std::atoi(argv[2]))
+                                : std::thread::hardware_concurrency();
+    if (frames == 0)
+        frames = 1;
+    if (threads == 0)
+        threads = 1;
+
+    std::vector<Kernel> kernels = {Kernel::Scalar};
+    if (best_kernel() != Kernel::Scalar)
+        kernels.push_back(Kernel::SSE2);
+    if (best_kernel() == Kernel::AVX2)
+        kernels.push_back(Kernel::AVX2);
+
+    int status = 0;
+    for (Kernel k : kernels) {
+        size_t mismatches = check_kernel(k);
+        std::printf("%-6s check: %zu mismatched pixels\n", kernel_name(k),
+                    mismatches);
+        if (mismatches)
+            status = 1;
+    }
+
+    std::vector<FrameState> states(frames);
+    for (unsigned f = 0; f < frames; ++f)
+        states[f] = animation(f);
+
+    std::vector<uint32_t> frame(FRAME_PIXELS);
+    for (Kernel k : kernels) {
+        auto start = std::chrono::steady_clock::now();
+        for (unsigned f = 0; f < frames; ++f)
+            render_frame(frame.data(), states[f], k);
+        std::printf("%-6s 1 thread:  %8.1f frames/s\n", kernel_name(k),
+                    frames / seconds_since(start));
+    }
+
+    // the batch writes every frame to its own place in memory, unlike
+    // the loops above, so it is timed on 1 thread too: the speedup is
+    // against that, not against the 1 thread rates above
+    std::vector<uint32_t> batch(FRAME_PIXELS * frames);
+    render_frames(batch.data(), states.data(), frames, 1);
+    auto start = std::chrono::steady_clock::now();
+    render_frames(batch.data(), states.data(), frames, 1);
+    double one_thread = seconds_since(start);
+    start = std::chrono::steady_clock::now();
+    render_frames(batch.data(), states.data(), frames, threads);
+    double threaded = seconds_since(start);
+    std::printf("%-6s batch of %u frames, %.0f MB: 1 thread %8.1f frames/s, "
+                "%u threads %8.1f frames/s, %.2fx on %u cores\n",
+                kernel_name(Kernel::Auto), frames,
+                batch.size() * sizeof(uint32_t) / 1e6, frames / one_thread,
+                threads, frames / threaded, one_thread / threaded,
+                std::thread::hardware_concurrency());
+
+    if (argc > 3) {
+        for (unsigned f = 0; f < frames; ++f) {
+            char name[16];
+            std::snprintf(name, sizeof name, "%04u.ppm", f);
+            if (!write_ppm(argv[3] + std::string(name),
+                           batch.data() + f * FRAME_PIXELS)) {
+                std::fprintf(stderr, "cannot write %s%s\n", argv[3], name);
+                return 1;
+            }
+        }
+    }
+    return status;
+}
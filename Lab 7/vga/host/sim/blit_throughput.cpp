@@ -0,0 +1,588 @@
+/*      blit_throughput.cpp
+        Cycle model of blitter.sv behind the SPI command port, with the
+        commands and pixels per second it reaches.
+
+        Build: g++ -std=c++17 -O2 -o blit_throughput blit_throughput.cpp
+        Usage: blit_throughput [spi_hz]
+
+        Blitter below models blitter.sv register by register, its queue
+        as the spi_model.h AsyncFifo with both sides on vgaclk, drawing
+        into the back page of framebuffer.sv: writes are always ready,
+        as no OP_PIXEL or unpacked pixels compete, and copy reads are
+        ready only where the 640x480 display is not reading, and return
+        the word 2 clocks later. Commands come from a PIC model at
+        spi_hz (default 10 MHz) through the spi_command_port model,
+        with a 25.175 MHz vgaclk.
+
+        Three checks, each of which must pass:
+          - 300 random fills, copies, lines and glyphs, partly off the
+            page and overlapping for copies, each sent as one frame;
+            once blit_busy falls the page must match a plain C++
+            drawing of the same operations.
+          - blit_busy must be high on every clock from the one a
+            register write arrives until the queue is empty and the
+            operation is done. The busy of the queue's empty flag
+            alone, as before, is counted for comparison.
+          - 64 register writes sent while a full page fill runs: the
+            writes that find the queue full must each pulse dropped,
+            and the queue must apply the others.
+
+        Then each kind of operation is sent for 50 ms, in frames of up
+        to 32 words with the PIC waiting for blit_busy to fall between
+        frames, and the operations, OP_BLIT commands and pixels drawn
+        per second are reported. */
+
+#include "spi_model.h"
+#include "vga_sim.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+using namespace vga_sim;
+
+namespace {
+
+const unsigned FB_WIDTH  = 320;
+const unsigned FB_HEIGHT = 240;
+const unsigned FB_PIXELS = FB_WIDTH * FB_HEIGHT;
+const double   PIXEL_HZ  = 25.175e6;
+
+int32_t signed_bits(uint32_t value, unsigned bits)
+{
+    return int32_t(value << (32 - bits)) >> (32 - bits);
+}
+
+/*
+ * Blitter
+ *
+ * blitter.sv. The outputs are functions of the registers and of
+ * read_ready; clock() applies one vgaclk edge.
+ */
+struct Blitter {
+    enum State { IDLE, FILL, COPY_READ, COPY_WAIT, COPY_DATA, COPY_WRITE, LINE, GLYPH };
+
+    AsyncFifo queue = AsyncFifo(5);
+    unsigned  pushed = 0;
+    unsigned  dst_x = 0, dst_y = 0, size_x = 0, size_y = 0, src_x = 0, src_y = 0;
+    unsigned  fg = 0, bg = 0, glyph[16] = {}, glyph_row = 0;
+    bool      transparent = false, reverse = false;
+    State     state = IDLE;
+    unsigned  cx = 0, cy = 0, read_lane = 0, copy_pixel = 0;
+    bool      copy_in = false;
+    int32_t   line_x = 0, line_y = 0, line_dx = 0, line_dy = 0, line_err = 0;
+    int32_t   line_sx = 0, line_sy = 0;
+
+    unsigned off_x() const { return reverse ? (size_x - 1 - cx) & 0x3FF : cx; }
+    unsigned off_y() const { return reverse ? (size_y - 1 - cy) & 0x3FF : cy; }
+    bool     last_pixel() const { return cx == size_x - 1 && cy == size_y - 1; }
+    bool     glyph_bit() const { return (glyph[cy & 15] >> (15 - (cx & 15))) & 1; }
+
+    // the pixel to write in this state: px, py, plot and color
+    void pixel(unsigned& px, unsigned& py, bool& plot, unsigned& color) const
+    {
+        px = (dst_x + off_x()) & 0xFFF;
+        py = (dst_y + off_y()) & 0xFFF;
+        plot  = state == FILL;
+        color = fg;
+        if (state == COPY_WRITE) {
+            plot  = copy_in;
+            color = copy_pixel;
+        } else if (state == LINE) {
+            px   = uint32_t(line_x) & 0xFFF;
+            py   = uint32_t(line_y) & 0xFFF;
+            plot = true;
+        } else if (state == GLYPH) {
+            plot  = glyph_bit() || !transparent;
+            color = glyph_bit() ? fg : bg;
+        }
+    }
+    bool write(unsigned& address, unsigned& color) const
+    {
+        unsigned px, py;
+        bool plot;
+        pixel(px, py, plot, color);
+        address = (py & 0xFF) * 320 + (px & 0x1FF);
+        return plot && px < FB_WIDTH && py < FB_HEIGHT;
+    }
+    bool source_in() const
+    {
+        return ((src_x + off_x()) & 0xFFF) < FB_WIDTH && ((src_y + off_y()) & 0xFFF) < FB_HEIGHT;
+    }
+    unsigned read_address() const
+    {
+        return ((src_y + off_y()) & 0xFF) * 320 + ((src_x + off_x()) & 0x1FF);
+    }
+    bool read() const { return state == COPY_READ && source_in(); }
+    bool pop() const { return state == IDLE && !queue.empty(); }
+    bool busy(bool push) const
+    {
+        return state != IDLE || !queue.empty() || push || pushed;
+    }
+    bool queue_busy() const { return state != IDLE || !queue.empty(); }
+    bool dropped(bool push) const { return push && queue.full(); }
+
+    void clock(bool push, uint32_t command, bool read_ready, uint32_t pixel_word)
+    {
+        // write_ready is high, so every state advances
+        bool     popped = pop();
+        uint32_t word   = queue.rdata();
+        State    next   = state;
+
+        switch (state) {
+        case IDLE:
+            if (!popped)
+                break;
+            switch ((word >> 24) & 15) {
+            case 0: dst_x  = word & 0x3FF; break;
+            case 1: dst_y  = word & 0x3FF; break;
+            case 2: size_x = word & 0x3FF; break;
+            case 3: size_y = word & 0x3FF; break;
+            case 4: src_x  = word & 0x3FF; break;
+            case 5: src_y  = word & 0x3FF; break;
+            case 6: fg = word & 0xFF; bg = (word >> 8) & 0xFF; break;
+            case 7:
+                glyph[glyph_row] = word & 0xFFFF;
+                glyph_row = (glyph_row + 1) & 15;
+                break;
+            case 15: {
+                cx = cy = 0;
+                glyph_row   = 0;
+                transparent = (word >> 2) & 1;
+                reverse     = (word & 3) == 1 &&
+                              (dst_y > src_y || (dst_y == src_y && dst_x > src_x));
+                int32_t dx = int32_t(size_x) - int32_t(dst_x);
+                int32_t dy = int32_t(size_y) - int32_t(dst_y);
+                line_x   = int32_t(dst_x);
+                line_y   = int32_t(dst_y);
+                line_dx  = std::abs(dx);
+                line_dy  = -std::abs(dy);
+                line_sx  = size_x > dst_x ? 1 : -1;
+                line_sy  = size_y > dst_y ? 1 : -1;
+                line_err = signed_bits(uint32_t(line_dx + line_dy), 13);
+                if ((word & 3) == 2)
+                    next = LINE;
+                else if (size_x != 0 && size_y != 0)
+                    switch (word & 3) {
+                    case 0: next = FILL; break;
+                    case 1: next = COPY_READ; break;
+                    case 3:
+                        if (size_x <= 16 && size_y <= 16)
+                            next = GLYPH;
+                        break;
+                    }
+                break;
+            }
+            default:
+                break;
+            }
+            break;
+        case COPY_READ:
+            if (!source_in() || read_ready) {
+                copy_in   = source_in();
+                read_lane = read_address() & 3;
+                next      = COPY_WAIT;
+            }
+            break;
+        case COPY_WAIT:
+            next = COPY_DATA;
+            break;
+        case COPY_DATA:
+            copy_pixel = (pixel_word >> (8 * read_lane)) & 0xFF;
+            next       = COPY_WRITE;
+            break;
+        case LINE: {
+            int32_t e2 = signed_bits(uint32_t(line_err) << 1, 13);
+            if (line_x == int32_t(size_x) && line_y == int32_t(size_y))
+                next = IDLE;
+            if (e2 >= line_dy && e2 <= line_dx) {
+                line_err = signed_bits(uint32_t(line_err + line_dy + line_dx), 13);
+                line_x   = signed_bits(uint32_t(line_x + line_sx), 12);
+                line_y   = signed_bits(uint32_t(line_y + line_sy), 12);
+            } else if (e2 >= line_dy) {
+                line_err = signed_bits(uint32_t(line_err + line_dy), 13);
+                line_x   = signed_bits(uint32_t(line_x + line_sx), 12);
+            } else if (e2 <= line_dx) {
+                line_err = signed_bits(uint32_t(line_err + line_dx), 13);
+                line_y   = signed_bits(uint32_t(line_y + line_sy), 12);
+            }
+            break;
+        }
+        default:
+            if (last_pixel())
+                next = IDLE;
+            else if (state == COPY_WRITE)
+                next = COPY_READ;
+            if (cx == size_x - 1) {
+                cx = 0;
+                cy = (cy + 1) & 0x3FF;
+            } else {
+                cx = (cx + 1) & 0x3FF;
+            }
+            break;
+        }
+        state  = next;
+        pushed = ((pushed << 1) | push) & 3;
+        queue.write_clock(push, command);
+        queue.read_clock(popped);
+    }
+};
+
+/*
+ * BackPage
+ *
+ * The back page of framebuffer.sv as the blitter sees it: a write
+ * lands at the edge, and a read address registered at one edge gives
+ * pixel_word after the next.
+ */
+struct BackPage {
+    std::vector<uint8_t> pixels = std::vector<uint8_t>(FB_PIXELS, 0);
+    unsigned raddr = 0;
+    uint32_t pixel_word = 0;
+
+    void clock(bool write, unsigned waddr, unsigned color, unsigned blit_raddr)
+    {
+        pixel_word = 0;
+        for (unsigned lane = 0; lane < 4; ++lane)
+            if (raddr * 4 + lane < FB_PIXELS)
+                pixel_word |= uint32_t(pixels[raddr * 4 + lane]) << (8 * lane);
+        raddr = blit_raddr >> 2;
+        if (write)
+            pixels[waddr] = uint8_t(color);
+    }
+};
+
+/* One operation, as the PIC sends it and as plain C++ draws it. */
+struct Operation {
+    unsigned kind;   // start [1:0]: 0 fill, 1 copy, 2 line, 3 glyph
+    unsigned x, y, width, height, src_x, src_y, fg, bg;
+    bool     transparent;
+    unsigned rows[16];
+
+    std::vector<uint32_t> commands() const
+    {
+        std::vector<uint32_t> words;
+        auto reg = [&](unsigned r, uint32_t value) {
+            words.push_back(burst_command(OP_BLIT, r, value));
+        };
+        reg(0, x); reg(1, y); reg(2, width); reg(3, height);
+        if (kind == 1) {
+            reg(4, src_x);
+            reg(5, src_y);
+        } else {
+            reg(6, (bg << 8) | fg);
+        }
+        if (kind == 3)
+            for (unsigned i = 0; i < height && i < 16; ++i)
+                reg(7, rows[i]);
+        reg(15, kind | (transparent << 2));
+        return words;
+    }
+
+    /* The bytes of commands(): a burst for each run of registers. */
+    std::vector<uint8_t> bytes() const
+    {
+        std::vector<uint32_t> words = commands();
+        std::vector<uint8_t> out;
+        for (size_t i = 0; i < words.size();) {
+            unsigned first = (words[i] >> 24) & 15;
+            std::vector<uint32_t> elements;
+            while (i < words.size() && ((words[i] >> 24) & 15) == first + elements.size() &&
+                   (elements.empty() || first != 7)) {
+                elements.push_back(words[i] & 0xFFFF);
+                ++i;
+            }
+            std::vector<uint8_t> b = burst(OP_BLIT, first, elements);
+            out.insert(out.end(), b.begin(), b.end());
+        }
+        return out;
+    }
+
+    unsigned pixels() const
+    {
+        if (kind == 2)
+            return unsigned(std::max(std::abs(int(width) - int(x)),
+                                     std::abs(int(height) - int(y)))) + 1;
+        return width * height;
+    }
+
+    void draw(std::vector<uint8_t>& page) const
+    {
+        auto plot = [&](int px, int py, unsigned color) {
+            if (px >= 0 && py >= 0 && px < int(FB_WIDTH) && py < int(FB_HEIGHT))
+                page[py * FB_WIDTH + px] = uint8_t(color);
+        };
+        if (kind == 2) {
+            int x0 = int(x), y0 = int(y), x1 = int(width), y1 = int(height);
+            int dx = std::abs(x1 - x0), sx = x0 < x1 ? 1 : -1;
+            int dy = -std::abs(y1 - y0), sy = y0 < y1 ? 1 : -1;
+            for (int err = dx + dy;;) {
+                plot(x0, y0, fg);
+                if (x0 == x1 && y0 == y1)
+                    break;
+                int e2 = 2 * err;
+                if (e2 >= dy) { err += dy; x0 += sx; }
+                if (e2 <= dx) { err += dx; y0 += sy; }
+            }
+            return;
+        }
+        if (kind == 3 && (width > 16 || height > 16))
+            return;
+        std::vector<uint8_t> source = page;
+        for (unsigned j = 0; j < height; ++j)
+            for (unsigned i = 0; i < width; ++i) {
+                if (kind == 0) {
+                    plot(int(x + i), int(y + j), fg);
+                } else if (kind == 1) {
+                    unsigned sx = src_x + i, sy = src_y + j;
+                    if (sx < FB_WIDTH && sy < FB_HEIGHT)
+                        plot(int(x + i), int(y + j), source[sy * FB_WIDTH + sx]);
+                } else {
+                    bool bit = (rows[j] >> (15 - i)) & 1;
+                    if (bit || !transparent)
+                        plot(int(x + i), int(y + j), bit ? fg : bg);
+                }
+            }
+    }
+};
+
+/*
+ * Bench
+ *
+ * The PIC, the SPI command port, the blitter and its back page on one
+ * vgaclk, with the frame timing of 640x480 for the read port.
+ */
+class Bench {
+public:
+    explicit Bench(double spi_hz)
+        : controller_(Timing{"640X480_60", 0, 640, 16, 96, 48, 480, 10, 2, 33,
+                             false, false, 25175}, 5),
+          link_(port_, spi_hz, PIXEL_HZ, [this]() { pixel_clock(); })
+    {
+    }
+
+    Blitter  blitter;
+    BackPage page;
+    uint64_t blit_commands = 0, drawn = 0, dropped = 0, popped = 0;
+    uint64_t busy_gaps = 0, queue_busy_gaps = 0;
+
+    SpiLink&       link() { return link_; }
+    SpiCommandPort& port() { return port_; }
+
+    /* Waits, as the PIC does, until blit_busy is low. */
+    void wait_idle()
+    {
+        do
+            link_.advance_to(link_.now_ps() + 100000);
+        while (busy_);
+    }
+
+private:
+    void pixel_clock()
+    {
+        bool push = port_.command_valid && opcode(port_.command) == OP_BLIT;
+        // the framebuffer reads for the display at x, y+1
+        unsigned x = controller_.x(), next_y = (controller_.y() + 1) & 0x7FF;
+        bool read_ready = !(x < 640 && next_y < 480);
+
+        // work is pending from the clock a write arrives
+        pending_ += push;
+        bool pending = pending_ > popped || blitter.state != Blitter::IDLE;
+        busy_ = blitter.busy(push);
+        busy_gaps       += pending && !busy_;
+        queue_busy_gaps += pending && !blitter.queue_busy();
+
+        unsigned waddr, color;
+        bool write = blitter.write(waddr, color);
+        blit_commands += push;
+        drawn   += write;
+        dropped += blitter.dropped(push);
+        pending_ -= blitter.dropped(push);
+        popped  += blitter.pop();
+        page.clock(write, waddr, color, blitter.read_address());
+        blitter.clock(push, port_.command, read_ready, page.pixel_word);
+        controller_.clock();
+    }
+
+    VgaController  controller_;
+    SpiCommandPort port_;
+    SpiLink        link_;
+    uint64_t       pending_ = 0;
+    bool           busy_ = false;
+};
+
+Operation random_operation(std::mt19937& rng)
+{
+    Operation op = {};
+    op.kind = unsigned(rng() % 4);
+    // mostly on the page, sometimes across or past its edges
+    auto coordinate = [&](unsigned limit) {
+        return rng() % 8 == 0 ? unsigned(rng() % 1024) : unsigned(rng() % limit);
+    };
+    op.x = coordinate(FB_WIDTH);
+    op.y = coordinate(FB_HEIGHT);
+    op.fg = unsigned(rng() & 0xFF);
+    op.bg = unsigned(rng() & 0xFF);
+    op.transparent = rng() & 1;
+    switch (op.kind) {
+    case 0:
+        op.width  = unsigned(rng() % 64);
+        op.height = unsigned(rng() % 64);
+        break;
+    case 1:
+        op.width  = 1 + unsigned(rng() % 40);
+        op.height = 1 + unsigned(rng() % 40);
+        // overlapping copies in every direction
+        op.src_x = rng() % 2 ? coordinate(FB_WIDTH)
+                             : unsigned(std::clamp(int(op.x) + int(rng() % 21) - 10, 0, 1023));
+        op.src_y = rng() % 2 ? coordinate(FB_HEIGHT)
+                             : unsigned(std::clamp(int(op.y) + int(rng() % 21) - 10, 0, 1023));
+        break;
+    case 2:
+        op.width  = coordinate(FB_WIDTH);
+        op.height = coordinate(FB_HEIGHT);
+        break;
+    default:
+        op.width  = 1 + unsigned(rng() % 16);
+        op.height = 1 + unsigned(rng() % 16);
+        for (unsigned& row : op.rows)
+            row = unsigned(rng() & 0xFFFF);
+        break;
+    }
+    return op;
+}
+
+bool check_operations(double spi_hz)
+{
+    Bench bench(spi_hz);
+    std::vector<uint8_t> expected(FB_PIXELS, 0);
+    std::mt19937 rng(42);
+    unsigned failures = 0, ops = 0;
+    // a noisy page, so copies move something
+    Operation noise = {};
+    for (unsigned i = 0; i < 300; ++i, ++ops) {
+        Operation op = i < 40 ? noise : random_operation(rng);
+        if (i < 40) {
+            op.kind = 3;
+            op.x = (i % 20) * 16;
+            op.y = (i / 20) * 16 + unsigned(rng() % 200);
+            op.width = op.height = 16;
+            op.fg = unsigned(rng() & 0xFF);
+            op.bg = unsigned(rng() & 0xFF);
+            for (unsigned& row : op.rows)
+                row = unsigned(rng() & 0xFFFF);
+        }
+        bench.link().send_frame(op.bytes());
+        bench.wait_idle();
+        op.draw(expected);
+        if (bench.page.pixels != expected) {
+            if (failures < 5)
+                std::printf("    operation %u, kind %u at %u,%u size %u,%u src %u,%u: "
+                            "page differs\n", i, op.kind, op.x, op.y, op.width,
+                            op.height, op.src_x, op.src_y);
+            ++failures;
+            bench.page.pixels = expected;
+        }
+    }
+    bool ok = failures == 0 && bench.dropped == 0 && bench.port().dropped() == 0;
+    std::printf("  %u random operations against plain C++: %u differ: %s\n", ops,
+                failures, ok ? "ok" : "FAIL");
+    bool busy_ok = bench.busy_gaps == 0;
+    std::printf("  clocks with work pending and blit_busy low: %llu, with the queue's "
+                "empty flag alone: %llu: %s\n", (unsigned long long)bench.busy_gaps,
+                (unsigned long long)bench.queue_busy_gaps, busy_ok ? "ok" : "FAIL");
+    return ok && busy_ok;
+}
+
+bool check_overrun(double spi_hz)
+{
+    Bench bench(spi_hz);
+    Operation fill = {};
+    fill.width  = FB_WIDTH;
+    fill.height = FB_HEIGHT;
+    fill.fg     = 0x5A;
+    bench.link().send_frame(fill.bytes());
+    uint64_t popped_before = bench.popped, sent_before = bench.blit_commands;
+
+    // 64 writes to the x register, while the fill still has ms to go
+    std::vector<uint32_t> values(64);
+    for (unsigned i = 0; i < values.size(); ++i)
+        values[i] = i;
+    std::vector<uint8_t> frame;
+    for (uint32_t v : values) {
+        std::vector<uint8_t> b = burst(OP_BLIT, 0, {v});
+        frame.insert(frame.end(), b.begin(), b.end());
+    }
+    bench.link().send_frame(frame);
+    bench.wait_idle();
+
+    uint64_t sent    = bench.blit_commands - sent_before;
+    uint64_t applied = bench.popped - popped_before;
+    bool ok = sent == 64 && bench.dropped > 0 && applied + bench.dropped == sent &&
+              bench.port().dropped() == 0;
+    std::printf("  64 writes during a full page fill: %llu queued, %llu dropped by the "
+                "blitter, %u by the SPI FIFO: %s\n", (unsigned long long)applied,
+                (unsigned long long)bench.dropped, bench.port().dropped(),
+                ok ? "ok" : "FAIL");
+    return ok;
+}
+
+struct Rate {
+    double ops, commands, pixels;
+};
+
+/* Sends batches of operations like op for 50 ms of link time. */
+Rate measure(double spi_hz, Operation op, unsigned per_frame)
+{
+    Bench bench(spi_hz);
+    std::vector<uint8_t> frame;
+    for (unsigned i = 0; i < per_frame; ++i) {
+        std::vector<uint8_t> b = op.bytes();
+        frame.insert(frame.end(), b.begin(), b.end());
+    }
+    uint64_t ops = 0;
+    while (bench.link().now_ps() < 50000000000ull) {
+        bench.link().send_frame(frame);
+        bench.wait_idle();
+        ops += per_frame;
+    }
+    double seconds = bench.link().now_ps() * 1e-12;
+    return {ops / seconds, bench.blit_commands / seconds, bench.drawn / seconds};
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    double spi_hz = argc > 1 ? std::atof(argv[1]) : 10e6;
+
+    std::printf("SPI %.1f MHz, vgaclk %.3f MHz, 640x480\n", spi_hz / 1e6, PIXEL_HZ / 1e6);
+    bool ok = check_operations(spi_hz);
+    ok = check_overrun(spi_hz) && ok;
+
+    Operation page_fill = {0, 0, 0, FB_WIDTH, FB_HEIGHT, 0, 0, 0x21, 0, false, {}};
+    Operation small_fill = {0, 100, 100, 8, 8, 0, 0, 0x21, 0, false, {}};
+    Operation glyph = {3, 100, 100, 8, 8, 0, 0, 0x21, 0x10, false,
+                       {0x1800, 0x3C00, 0x6600, 0x7E00, 0x6600, 0x6600, 0x6600, 0}};
+    Operation line = {2, 0, 0, FB_WIDTH - 1, FB_HEIGHT - 1, 0, 0, 0x21, 0, false, {}};
+    Operation half_copy = {1, 0, 120, FB_WIDTH, 120, 0, 0, 0, 0, false, {}};
+    Operation small_copy = {1, 100, 100, 8, 8, 200, 50, 0, 0, false, {}};
+    struct {
+        const char* name;
+        Operation   op;
+        unsigned    per_frame;
+    } runs[] = {
+        {"fill 320x240", page_fill, 1},  {"fill 8x8", small_fill, 6},
+        {"glyph 8x8", glyph, 2},         {"line 320x240", line, 1},
+        {"copy 320x120", half_copy, 1},  {"copy 8x8", small_copy, 5},
+    };
+    for (const auto& run : runs) {
+        Rate r = measure(spi_hz, run.op, run.per_frame);
+        std::printf("  %-13s %u a frame: %8.0f ops/s, %7.0f commands/s, "
+                    "%6.2f Mpixels/s\n", run.name, run.per_frame, r.ops, r.commands,
+                    r.pixels / 1e6);
+    }
+    return ok ? 0 : 1;
+}
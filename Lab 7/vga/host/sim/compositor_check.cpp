@@ -0,0 +1,209 @@
+/*      compositor_check.cpp
+        Check of compositor.sv, the alpha compositing of the layers in
+        videoGen, against video_model::composite_pixel.
+
+        Build: g++ -std=c++17 -O2 -o compositor_check compositor_check.cpp ../video_model.cpp
+        Usage: compositor_check [cycles]
+
+        Compositor below models compositor.sv register by register: the
+        alpha and order registers, the premultiplied slots of stage 1
+        and the three over stages, so rgb for the layer colors of one
+        clock comes out 4 clocks later. It is driven every clock for
+        cycles clocks (default 20M) with random layer colors, coverage
+        and background, and OP_CONTROL commands at random clocks set
+        the alphas and the order, empty and repeated slots included,
+        or other registers that must not affect it. Each output must
+        equal composite_pixel for the layers in the slots as they were
+        set when the colors went in, and be within 1.5 of each channel
+        of the exact over, one half for the rounding of each stage.
+
+        With the power-up settings, all opaque and text over
+        framebuffer over tiles, the output must be the color of the
+        topmost covering layer, or the background, as videoGen chose
+        it before the compositor. */
+
+#include "spi_model.h"
+#include "../video_model.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+using namespace vga_sim;
+
+namespace {
+
+struct Slot {
+    unsigned color[3];  // premultiplied channels, blue first
+    unsigned inverse;   // 256 - weight
+};
+
+Slot premultiply(bool shown, uint32_t rgb, unsigned alpha)
+{
+    unsigned weight = shown ? alpha + 1 : 0;
+    Slot slot;
+    for (unsigned c = 0; c < 3; ++c)
+        slot.color[c] = (weight * ((rgb >> 8 * c) & 0xFF) + 128) & 0xFFFF;
+    slot.inverse = (256 - weight) & 0x1FF;
+    return slot;
+}
+
+uint32_t over(const Slot& slot, uint32_t below)
+{
+    uint32_t blended = 0;
+    for (unsigned c = 0; c < 3; ++c) {
+        unsigned sum = (slot.color[c] + slot.inverse * ((below >> 8 * c) & 0xFF)) & 0xFFFF;
+        blended |= (sum >> 8) << 8 * c;
+    }
+    return blended;
+}
+
+/*
+ * Compositor
+ *
+ * compositor.sv. Layer 0 is text, 1 the framebuffer and 2 the tiles;
+ * order holds the layer in each slot, 2 bits each, top first.
+ */
+struct Compositor {
+    unsigned alpha[3] = {255, 255, 255};
+    unsigned order    = 2 << 4 | 1 << 2 | 0;
+    Slot     slot_1[3] = {}, top_2 = {}, middle_2 = {}, top_3 = {};
+    uint32_t below_1 = 0, below_2 = 0, below_3 = 0, rgb = 0;
+
+    unsigned layer(unsigned slot) const { return (order >> 2 * slot) & 3; }
+
+    void clock(uint32_t command, bool command_valid, const bool covered[3],
+               const uint32_t layer_rgb[3], uint32_t background)
+    {
+        // stages 4 to 1, from the registers before the edge
+        rgb      = over(top_3, below_3);
+        below_3  = over(middle_2, below_2);
+        top_3    = top_2;
+        below_2  = over(slot_1[2], below_1);
+        middle_2 = slot_1[1];
+        top_2    = slot_1[0];
+        for (unsigned i = 0; i < 3; ++i) {
+            unsigned l = layer(i);
+            slot_1[i] = l == 3 ? premultiply(false, 0, 0)
+                               : premultiply(covered[l], layer_rgb[l], alpha[l]);
+        }
+        below_1 = background;
+
+        if (command_valid && opcode(command) == OP_CONTROL)
+            switch ((command >> 24) & 15) {
+            case 1: case 2: case 3:
+                alpha[((command >> 24) & 15) - 1] = command & 0xFF;
+                break;
+            case 4:
+                order = command & 0x3F;
+                break;
+            }
+    }
+};
+
+/* The layers in the slots of c, top first, for composite_pixel. */
+void slot_layers(const Compositor& c, const bool covered[3], const uint32_t layer_rgb[3],
+                 video_model::Layer layers[3])
+{
+    for (unsigned i = 0; i < 3; ++i) {
+        unsigned l = c.layer(i);
+        layers[i] = l == 3 ? video_model::Layer{false, 0, 0}
+                           : video_model::Layer{covered[l], layer_rgb[l], uint8_t(c.alpha[l])};
+    }
+}
+
+/* The largest difference of a channel of rgb from the exact over. */
+double exact_error(const video_model::Layer layers[3], uint32_t background, uint32_t rgb)
+{
+    double worst = 0;
+    for (unsigned c = 0; c < 3; ++c) {
+        double v = (background >> 8 * c) & 0xFF;
+        for (unsigned i = 3; i-- > 0; )
+            if (layers[i].covered) {
+                double a = (layers[i].alpha + 1) / 256.0;
+                v = a * ((layers[i].rgb >> 8 * c) & 0xFF) + (1 - a) * v;
+            }
+        worst = std::max(worst, std::fabs(v - ((rgb >> 8 * c) & 0xFF)));
+    }
+    return worst;
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    uint64_t cycles = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 20000000;
+    std::mt19937 rng(49);
+
+    // random settings and colors
+    Compositor model;
+    uint32_t expected[4] = {};
+    video_model::Layer went_in[4][3];
+    uint32_t backgrounds[4] = {};
+    uint64_t errors = 0, commands = 0;
+    double   worst = 0;
+    for (uint64_t c = 0; c < cycles + 4; ++c) {
+        if (c >= 4) {
+            unsigned at = c % 4;
+            if (model.rgb != expected[at]) {
+                if (errors < 5)
+                    std::printf("  clock %llu: rgb %06X, expected %06X\n",
+                                (unsigned long long)c, model.rgb, expected[at]);
+                ++errors;
+            }
+            worst = std::max(worst, exact_error(went_in[at], backgrounds[at], model.rgb));
+        }
+        bool     covered[3];
+        uint32_t layer_rgb[3];
+        for (unsigned l = 0; l < 3; ++l) {
+            covered[l]   = rng() & 1;
+            layer_rgb[l] = rng() & 0xFFFFFF;
+        }
+        uint32_t background = rng() & 0xFFFFFF;
+        uint32_t command = 0;
+        bool     valid   = rng() % 64 == 0;
+        if (valid) {
+            unsigned reg = rng() % 7, value = rng() & 0xFF;
+            // opaque and clear alphas more often than by chance
+            if (reg >= 1 && reg <= 3 && rng() % 4 == 0)
+                value = rng() & 1 ? 255 : 0;
+            command = burst_command(OP_CONTROL, reg, value);
+            ++commands;
+        }
+        unsigned at = c % 4;
+        slot_layers(model, covered, layer_rgb, went_in[at]);
+        backgrounds[at] = background;
+        expected[at] = video_model::composite_pixel(went_in[at], 3, background);
+        model.clock(command, valid, covered, layer_rgb, background);
+    }
+    bool ok = errors == 0 && worst <= 1.5;
+    std::printf("%llu clocks, %llu OP_CONTROL commands: %llu differ from composite_pixel, "
+                "largest error %.3f against the exact over: %s\n",
+                (unsigned long long)cycles, (unsigned long long)commands,
+                (unsigned long long)errors, worst, ok ? "ok" : "FAIL");
+
+    // power-up settings against the topmost covering layer
+    Compositor power_up;
+    uint32_t chosen[4] = {};
+    uint64_t differ = 0;
+    for (uint64_t c = 0; c < 1000000 + 4; ++c) {
+        if (c >= 4 && power_up.rgb != chosen[c % 4])
+            ++differ;
+        bool     covered[3];
+        uint32_t layer_rgb[3];
+        for (unsigned l = 0; l < 3; ++l) {
+            covered[l]   = rng() & 1;
+            layer_rgb[l] = rng() & 0xFFFFFF;
+        }
+        uint32_t background = rng() & 0xFFFFFF;
+        chosen[c % 4] = covered[0] ? layer_rgb[0] : covered[1] ? layer_rgb[1]
+                      : covered[2] ? layer_rgb[2] : background;
+        power_up.clock(0, false, covered, layer_rgb, background);
+    }
+    std::printf("power-up settings, 1000000 clocks: %llu differ from the topmost "
+                "covering layer: %s\n", (unsigned long long)differ, differ ? "FAIL" : "ok");
+    return ok && !differ ? 0 : 1;
+}
@@ -0,0 +1,308 @@
+/*      fb_bandwidth.cpp
+        Full frame upload to the framebuffer over the SPI model, with
+        the frame update bandwidth it reaches.
+
+        Build: g++ -std=c++17 -O2 -o fb_bandwidth fb_bandwidth.cpp
+        Usage: fb_bandwidth [spi_hz ...]
+
+        For each SPI clock (default 4, 8, 10 and 20 MHz) and for 0 and
+        2 idle clocks between bytes, a PIC model sends a 320x240 image
+        in one frame of OP_PIXEL bursts of 2048 pixels, then a frame
+        that shows the framebuffer with OP_CONTROL register 0 and asks
+        for a page swap with register 6. Every byte goes through the
+        spi_command_port model into the framebuffer pages on a
+        25.175 MHz vgaclk, with the frame pulse from the 640x480
+        vgaController model. Once the swap has happened the page shown
+        must hold the image, and no command may have been dropped.
+
+        The swap is also asked for while the blitter fills most of the
+        back page, about a millisecond before a frame pulse, so the
+        fill is still running at the pulse. The swap must wait for
+        blit_busy to fall, and the page shown must then hold the whole
+        fill. The pixels that differ when the swap does not wait, as
+        framebuffer.sv did before, are counted for comparison.
+
+        Reported per run: the upload time from fsync rising to the
+        last pixel written, the pixel rate, the frame rate that allows,
+        and the time until the new page is shown, which adds the wait
+        for the next vsync. */
+
+#include "spi_model.h"
+#include "vga_sim.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+using namespace vga_sim;
+
+namespace {
+
+const unsigned FB_WIDTH   = 320;
+const unsigned FB_HEIGHT  = 240;
+const unsigned FB_PIXELS  = FB_WIDTH * FB_HEIGHT;
+const double   PIXEL_HZ   = 25.175e6;
+
+/*
+ * FillBlitter
+ *
+ * The fill of blitter.sv: its register queue, with busy from the
+ * clock a write arrives, and one pixel per clock that the write port
+ * is free. The other operations are modelled in blit_throughput.cpp.
+ */
+struct FillBlitter {
+    AsyncFifo queue = AsyncFifo(5);
+    unsigned  pushed = 0;
+    unsigned  dst_x = 0, dst_y = 0, size_x = 0, size_y = 0, fg = 0;
+    bool      filling = false;
+    unsigned  cx = 0, cy = 0;
+
+    bool busy(bool push) const { return filling || !queue.empty() || push || pushed; }
+    bool write(unsigned& address) const
+    {
+        unsigned px = (dst_x + cx) & 0xFFF, py = (dst_y + cy) & 0xFFF;
+        address = (py & 0xFF) * FB_WIDTH + (px & 0x1FF);
+        return filling && px < FB_WIDTH && py < FB_HEIGHT;
+    }
+
+    void clock(bool push, uint32_t command, bool write_ready)
+    {
+        bool     popped = !filling && !queue.empty();
+        uint32_t word   = queue.rdata();
+        unsigned address;
+        if (popped) {
+            switch ((word >> 24) & 15) {
+            case 0: dst_x  = word & 0x3FF; break;
+            case 1: dst_y  = word & 0x3FF; break;
+            case 2: size_x = word & 0x3FF; break;
+            case 3: size_y = word & 0x3FF; break;
+            case 6: fg     = word & 0xFF;  break;
+            case 15:
+                cx = cy = 0;
+                filling = (word & 3) == 0 && size_x != 0 && size_y != 0;
+                break;
+            }
+        } else if (filling && (!write(address) || write_ready)) {
+            if (cx == size_x - 1 && cy == size_y - 1)
+                filling = false;
+            if (cx == size_x - 1) {
+                cx = 0;
+                cy = (cy + 1) & 0x3FF;
+            } else {
+                cx = (cx + 1) & 0x3FF;
+            }
+        }
+        pushed = ((pushed << 1) | push) & 3;
+        queue.write_clock(push, command);
+        queue.read_clock(popped);
+    }
+};
+
+/*
+ * Framebuffer
+ *
+ * The pages of framebuffer.sv, the commands that write and swap them
+ * and the blitter's fills, applied on each vgaclk edge. wait_for_blit
+ * false swaps at the frame pulse whatever blit_busy is.
+ */
+struct Framebuffer {
+    std::vector<uint8_t> pages = std::vector<uint8_t>(2 * FB_PIXELS, 0);
+    bool        enabled = false, front_page = false, flip_pending = false;
+    bool        wait_for_blit = true;
+    FillBlitter blitter;
+    uint64_t    pixels_written = 0, waited_pulses = 0;
+
+    const uint8_t* front() const { return &pages[front_page ? FB_PIXELS : 0]; }
+    uint8_t*       back() { return &pages[front_page ? 0 : FB_PIXELS]; }
+
+    void clock(bool frame, uint32_t command, bool command_valid)
+    {
+        bool pixel_we = command_valid && opcode(command) == OP_PIXEL &&
+                        ((command >> 8) & 0x1FFFF) < FB_PIXELS;
+        bool show     = command_valid && opcode(command) == OP_CONTROL &&
+                        ((command >> 24) & 15) == 0;
+        bool flip     = command_valid && opcode(command) == OP_CONTROL &&
+                        ((command >> 24) & 15) == 6 && (command & 1);
+        bool push     = command_valid && opcode(command) == OP_BLIT;
+        bool blit_busy = blitter.busy(push);
+        unsigned blit_address;
+        bool blit_we  = blitter.write(blit_address) && !pixel_we;
+        if (pixel_we) {
+            back()[(command >> 8) & 0x1FFFF] = uint8_t(command);
+            ++pixels_written;
+        } else if (blit_we) {
+            back()[blit_address] = uint8_t(blitter.fg);
+        }
+        blitter.clock(push, command, !pixel_we);
+        if (show)
+            enabled = command & 1;
+        if (frame && flip_pending && blit_busy && wait_for_blit)
+            ++waited_pulses;
+        if (frame && flip_pending && (!blit_busy || !wait_for_blit)) {
+            front_page   = !front_page;
+            flip_pending = false;
+        } else if (flip) {
+            flip_pending = true;
+        }
+    }
+};
+
+struct Result {
+    double upload_s, shown_s;
+    bool   ok;
+};
+
+Result run(double spi_hz, unsigned byte_gap, unsigned seed)
+{
+    std::vector<uint8_t> image(FB_PIXELS);
+    std::mt19937 rng(seed);
+    for (uint8_t& p : image)
+        p = uint8_t(rng());
+
+    std::vector<uint8_t> frame;
+    for (unsigned start = 0; start < FB_PIXELS; start += 2048) {
+        unsigned n = std::min(2048u, FB_PIXELS - start);
+        std::vector<uint32_t> elements(image.begin() + start, image.begin() + start + n);
+        std::vector<uint8_t> b = burst(OP_PIXEL, start, elements);
+        frame.insert(frame.end(), b.begin(), b.end());
+    }
+
+    Timing vga = {"640X480_60", 0, 640, 16, 96, 48, 480, 10, 2, 33, false, false, 25175};
+    VgaController controller(vga, 5);
+    SpiCommandPort port;
+    Framebuffer fb;
+    bool old_vsync = true;
+    uint64_t last_write_ps = 0, shown_ps = 0;
+    SpiLink* link_ptr = nullptr;
+
+    SpiLink link(port, spi_hz, PIXEL_HZ, [&]() {
+        // videoGen's frame pulse, at the end of vsync
+        bool vsync = controller.vsync();
+        bool frame_pulse = vsync && !old_vsync;
+        old_vsync = vsync;
+        bool was_front = fb.front_page;
+        uint64_t written = fb.pixels_written;
+        fb.clock(frame_pulse, port.command, port.command_valid);
+        if (fb.pixels_written != written)
+            last_write_ps = link_ptr->now_ps();
+        if (fb.front_page != was_front && !shown_ps)
+            shown_ps = link_ptr->now_ps();
+        controller.clock();
+    });
+    link_ptr = &link;
+    link.byte_gap = byte_gap;
+
+    // start somewhere in the middle of a frame
+    link.advance_to(uint64_t(rng() % 16683) * 1000000);
+    uint64_t start = link.now_ps();
+    link.send_frame(frame);
+    std::vector<uint8_t> control = burst(OP_CONTROL, 0, {1});
+    std::vector<uint8_t> flip    = burst(OP_CONTROL, 6, {1});
+    control.insert(control.end(), flip.begin(), flip.end());
+    link.send_frame(control);
+    while (!shown_ps)
+        link.advance_to(link.now_ps() + 1000000);
+
+    bool ok = fb.enabled && port.dropped() == 0 && fb.pixels_written == FB_PIXELS &&
+              std::equal(image.begin(), image.end(), fb.front());
+    return {(last_write_ps - start) * 1e-12, (shown_ps - start) * 1e-12, ok};
+}
+
+struct FlipResult {
+    uint64_t waited_pulses, differ;
+    bool     dropped;
+};
+
+/* Asks for the swap while a fill of most of the back page, which holds
+   a random image, is still running at the next frame pulse. */
+FlipResult flip_during_fill(bool wait_for_blit, unsigned seed)
+{
+    const unsigned X = 10, Y = 10, WIDTH = 300, HEIGHT = 220, COLOR = 0xA5;
+    std::mt19937 rng(seed);
+    Timing vga = {"640X480_60", 0, 640, 16, 96, 48, 480, 10, 2, 33, false, false, 25175};
+    VgaController controller(vga, 5);
+    SpiCommandPort port;
+    Framebuffer fb;
+    fb.wait_for_blit = wait_for_blit;
+    // the image is in the back page already
+    std::vector<uint8_t> expected(FB_PIXELS);
+    for (unsigned i = 0; i < FB_PIXELS; ++i)
+        fb.back()[i] = expected[i] = uint8_t(rng());
+    for (unsigned y = Y; y < Y + HEIGHT; ++y)
+        for (unsigned x = X; x < X + WIDTH; ++x)
+            expected[y * FB_WIDTH + x] = COLOR;
+
+    bool old_vsync = true, swapped = false;
+    std::vector<uint8_t> shown;
+    SpiLink link(port, 10e6, PIXEL_HZ, [&]() {
+        bool vsync = controller.vsync();
+        bool frame_pulse = vsync && !old_vsync;
+        old_vsync = vsync;
+        bool was_front = fb.front_page;
+        fb.clock(frame_pulse, port.command, port.command_valid);
+        // the page as the first frame after the swap shows it
+        if (fb.front_page != was_front && !swapped) {
+            swapped = true;
+            shown.assign(fb.front(), fb.front() + FB_PIXELS);
+        }
+        controller.clock();
+    });
+
+    // about 30 lines before the frame pulse, which ends vsync
+    while (controller.vcnt != vga.v_total() - 30)
+        link.advance_to(link.now_ps() + 1000000);
+    std::vector<uint8_t> fill = burst(OP_BLIT, 0, {X, Y, WIDTH, HEIGHT});
+    for (auto b : {burst(OP_BLIT, 6, {COLOR}), burst(OP_BLIT, 15, {0}),
+                   burst(OP_CONTROL, 0, {1}), burst(OP_CONTROL, 6, {1})})
+        fill.insert(fill.end(), b.begin(), b.end());
+    link.send_frame(fill);
+    while (!swapped && link.now_ps() < uint64_t(100e9))
+        link.advance_to(link.now_ps() + 1000000);
+
+    uint64_t differ = FB_PIXELS;
+    if (swapped) {
+        differ = 0;
+        for (unsigned i = 0; i < FB_PIXELS; ++i)
+            differ += shown[i] != expected[i];
+    }
+    return {fb.waited_pulses, differ, port.dropped() != 0};
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    std::vector<double> clocks;
+    for (int i = 1; i < argc; ++i)
+        clocks.push_back(std::atof(argv[i]));
+    if (clocks.empty())
+        clocks = {4e6, 8e6, 10e6, 20e6};
+
+    unsigned bursts = (FB_PIXELS + 2047) / 2048;
+    std::printf("320x240 frame: %u OP_PIXEL bursts, %u bytes\n", bursts,
+                FB_PIXELS + 4 * bursts);
+    int failures = 0;
+    unsigned seed = 34;
+    for (double hz : clocks)
+        for (unsigned gap : {0u, 2u}) {
+            Result r = run(hz, gap, seed++);
+            std::printf("  SPI %5.1f MHz, %u idle clocks per byte: upload %6.2f ms, "
+                        "%5.0fk pixels/s, %5.1f frames/s, shown after %6.2f ms: %s\n",
+                        hz / 1e6, gap, 1e3 * r.upload_s, FB_PIXELS / r.upload_s / 1e3,
+                        1 / r.upload_s, 1e3 * r.shown_s, r.ok ? "ok" : "FAIL");
+            failures += !r.ok;
+        }
+
+    FlipResult waited = flip_during_fill(true, seed);
+    FlipResult before = flip_during_fill(false, seed);
+    bool ok = waited.waited_pulses >= 1 && waited.differ == 0 && !waited.dropped;
+    std::printf("swap asked for during a 300x220 fill: waited %llu frame pulses, "
+                "%llu pixels of the page shown differ: %s\n",
+                (unsigned long long)waited.waited_pulses,
+                (unsigned long long)waited.differ, ok ? "ok" : "FAIL");
+    std::printf("swapping without waiting for blit_busy: %llu pixels differ\n",
+                (unsigned long long)before.differ);
+    failures += !ok;
+    return failures ? 1 : 0;
+}
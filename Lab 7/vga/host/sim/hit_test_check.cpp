@@ -0,0 +1,258 @@
+/*      hit_test_check.cpp
+        Cycle model and check of the widget hit test, hit_tester in
+        hit_test.sv.
+
+        Build: g++ -std=c++17 -O2 -o hit_test_check hit_test_check.cpp
+        Usage: hit_test_check [frames]
+
+        HitTester below models hit_tester register by register: the
+        table written by OP_HIT_RECT, the scan started the clock after
+        the frame pulse, the read stage and the compare stage, which
+        publishes hit, hit_id and hit_buttons after rectangle 63. It is
+        clocked with vsync from the 640x480 vgaController model for
+        frames frames (default 300). In each frame, OP_HIT_RECT commands
+        rewrite some rectangles, in use or not, empty or inverted
+        (right left of left, or bottom above top) among them, while the
+        display area is drawn. The cursor and buttons change at the
+        frame pulse, as mouse_reader changes them, and half the time
+        the cursor is put on or one past an edge of a rectangle.
+
+        After each frame pulse, the published result must be the lowest
+        numbered rectangle in use that holds the cursor, right and
+        bottom inclusive, or no hit, with the buttons latched at the
+        start of the search. It must be published the same number of
+        clocks after every frame pulse, no more than the 70 that
+        hit_test.sv gives. */
+
+#include "spi_model.h"
+#include "vga_sim.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <random>
+
+using namespace vga_sim;
+
+namespace {
+
+const unsigned RECTS = 64;
+
+struct Rect {
+    bool     in_use;
+    unsigned left, top, right, bottom;
+};
+
+/*
+ * HitTester
+ *
+ * hit_tester. published is set for the edge that writes hit, hit_id
+ * and hit_buttons.
+ */
+struct HitTester {
+    // old_vsync starts high, so the first pulse is the end of a vsync
+    Rect     table[RECTS] = {};
+    bool     old_vsync = true, start = false, scanning = false, checking = false;
+    unsigned index = 0, checked_index = 0, found_id = 0;
+    bool     found = false, in_use_q = false;
+    unsigned left_q = 0, top_q = 0, right_q = 0, bottom_q = 0;
+    unsigned cursor_x = 0, cursor_y = 0, cursor_buttons = 0;
+    bool     hit = false, published = false;
+    unsigned hit_id = 0, hit_buttons = 0;
+
+    bool frame(bool vsync) const { return vsync && !old_vsync; }
+
+    void clock(bool vsync, uint32_t command, bool command_valid, unsigned x_cursor,
+               unsigned y_cursor, unsigned buttons)
+    {
+        // stage 2, from the registers before the edge
+        bool inside = in_use_q && cursor_x >= left_q && cursor_x <= right_q &&
+                      cursor_y >= top_q && cursor_y <= bottom_q;
+        published = checking && checked_index == RECTS - 1;
+        if (published) {
+            hit         = found || inside;
+            hit_id      = found ? found_id : checked_index;
+            hit_buttons = cursor_buttons;
+        }
+        if (start)
+            found = false;
+        else if (checking && inside && !found) {
+            found    = true;
+            found_id = checked_index;
+        }
+
+        // stage 1
+        const Rect& r = table[index];
+        left_q        = r.left;
+        top_q         = r.top;
+        right_q       = r.right;
+        bottom_q      = r.bottom;
+        in_use_q      = r.in_use;
+        checking      = scanning;
+        checked_index = index;
+
+        // scan
+        bool was_start = start;
+        start     = frame(vsync);
+        old_vsync = vsync;
+        if (was_start) {
+            scanning       = true;
+            index          = 0;
+            cursor_x       = x_cursor;
+            cursor_y       = y_cursor;
+            cursor_buttons = buttons;
+        } else if (scanning) {
+            if (index == RECTS - 1)
+                scanning = false;
+            index = (index + 1) % RECTS;
+        }
+
+        // write side
+        if (command_valid && opcode(command) == OP_HIT_RECT) {
+            Rect&    w     = table[(command >> 22) & 0x3F];
+            unsigned value = command & 0x3FF;
+            switch ((command >> 20) & 3) {
+            case 0:
+                w.in_use = (command >> 15) & 1;
+                w.left   = value;
+                break;
+            case 1:
+                w.top = value;
+                break;
+            case 2:
+                w.right = value;
+                break;
+            case 3:
+                w.bottom = value;
+                break;
+            }
+        }
+    }
+};
+
+/* The topmost rectangle of table holding x, y, or -1. */
+int reference_hit(const Rect table[RECTS], unsigned x, unsigned y)
+{
+    for (unsigned i = 0; i < RECTS; ++i) {
+        const Rect& r = table[i];
+        if (r.in_use && x >= r.left && x <= r.right && y >= r.top && y <= r.bottom)
+            return int(i);
+    }
+    return -1;
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    unsigned frames = argc > 1 ? unsigned(std::atoi(argv[1])) : 300;
+    Timing   t{"640X480_60", 0, 640, 16, 96, 48, 480, 10, 2, 33, false, false, 25175};
+    VgaController controller(t, 5);
+    HitTester     tester;
+    std::mt19937  rng(50);
+
+    // the table as written, the cursor and buttons as mouse_reader
+    // holds them
+    Rect     written[RECTS] = {};
+    unsigned x_cursor = 0, y_cursor = 0, buttons = 0;
+    std::deque<uint32_t> commands;
+    int      expected = -1;
+    unsigned expected_buttons = 0;
+    bool     pending = false;
+    uint64_t since_frame = 0;
+    unsigned seen_frames = 0, errors = 0, hits = 0, bad_latency = 0;
+    uint64_t latency = 0;
+
+    auto rewrite = [&]() {
+        unsigned count = rng() % 9 ? rng() % 16 : RECTS;
+        for (unsigned n = 0; n < count; ++n) {
+            unsigned i = rng() % RECTS;
+            Rect r;
+            r.in_use = rng() % 3 != 0;
+            r.left   = rng() % 700;
+            r.top    = rng() % 520;
+            // mostly widget sized, some a single pixel or inverted
+            int w = rng() % 8 ? int(rng() % 200) : int(rng() % 11) - 5;
+            int h = rng() % 8 ? int(rng() % 150) : int(rng() % 11) - 5;
+            r.right  = unsigned(int(r.left) + w) & 0x3FF;
+            r.bottom = unsigned(int(r.top) + h) & 0x3FF;
+            commands.push_back(burst_command(OP_HIT_RECT, i << 2 | 0,
+                                             uint32_t(r.in_use) << 15 | r.left));
+            commands.push_back(burst_command(OP_HIT_RECT, i << 2 | 1, r.top));
+            commands.push_back(burst_command(OP_HIT_RECT, i << 2 | 2, r.right));
+            commands.push_back(burst_command(OP_HIT_RECT, i << 2 | 3, r.bottom));
+            written[i] = r;
+        }
+    };
+    auto move_cursor = [&]() {
+        buttons = rng() % 8;
+        const Rect& r = written[rng() % RECTS];
+        if (rng() % 2) {
+            x_cursor = rng() % 640;
+            y_cursor = rng() % 480;
+        } else {
+            int off = int(rng() % 3) - 1;
+            x_cursor = unsigned(int(rng() % 2 ? r.left : r.right) + off) & 0x3FF;
+            y_cursor = rng() % 2 ? unsigned(int(rng() % 2 ? r.top : r.bottom) + off) & 0x3FF
+                                 : (r.top + r.bottom) / 2;
+        }
+    };
+
+    // the first search is of the empty table
+    while (seen_frames < frames) {
+        bool vsync = controller.vsync();
+        bool frame = tester.frame(vsync);
+        // commands only while the display area is drawn, away from
+        // the search
+        bool     valid   = false;
+        uint32_t command = 0;
+        if (controller.raw_valid() && !commands.empty() && rng() % 4 == 0) {
+            command = commands.front();
+            commands.pop_front();
+            valid = true;
+        }
+        tester.clock(vsync, command, valid, x_cursor, y_cursor, buttons);
+        ++since_frame;
+        if (tester.published) {
+            if (!pending || (expected >= 0) != tester.hit ||
+                (expected >= 0 && int(tester.hit_id) != expected) ||
+                tester.hit_buttons != expected_buttons) {
+                if (errors < 5)
+                    std::printf("  frame %u: hit %d id %u buttons %u, expected %d "
+                                "buttons %u\n", seen_frames, tester.hit, tester.hit_id,
+                                tester.hit_buttons, expected, expected_buttons);
+                ++errors;
+            }
+            if (latency == 0)
+                latency = since_frame;
+            bad_latency += since_frame != latency;
+            hits += tester.hit;
+            pending = false;
+            ++seen_frames;
+            rewrite();
+        }
+        if (frame) {
+            // the table is settled and mouse_reader moves the cursor
+            // at this edge, which the search takes the clock after
+            if (pending || !commands.empty()) {
+                std::printf("  frame %u: %s\n", seen_frames, pending
+                            ? "no result before the next frame"
+                            : "table not written before the frame pulse");
+                ++errors;
+                ++seen_frames;
+            }
+            move_cursor();
+            expected         = reference_hit(written, x_cursor, y_cursor);
+            expected_buttons = buttons;
+            pending          = true;
+            since_frame      = 0;
+        }
+        controller.clock();
+    }
+    bool ok = errors == 0 && bad_latency == 0 && latency <= 70;
+    std::printf("%u frames, %u with a hit: %u results wrong, published %llu clocks "
+                "after the frame pulse%s: %s\n", seen_frames, hits, errors,
+                (unsigned long long)latency, bad_latency ? ", not in every frame" : "",
+                ok ? "ok" : "FAIL");
+    return ok ? 0 : 1;
+}
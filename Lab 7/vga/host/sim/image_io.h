@@ -0,0 +1,123 @@
+/*      image_io.h
+        PPM and PNG writers for frames captured by the harnesses, with
+        pixels packed as 0x00RRGGBB.
+
+        The PNG is written without compression, in stored deflate
+        blocks, so no zlib is needed; a 640x480 frame is about 900 KB. */
+
+#ifndef IMAGE_IO_H
+#define IMAGE_IO_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace image_io {
+
+inline bool write_ppm(const std::string& path, const uint32_t* pixels,
+                      unsigned width, unsigned height)
+{
+    FILE* f = std::fopen(path.c_str(), "wb");
+    if (!f)
+        return false;
+    std::fprintf(f, "P6\n%u %u\n255\n", width, height);
+    for (size_t i = 0; i < size_t(width) * height; ++i) {
+        unsigned char rgb[3] = {uint8_t(pixels[i] >> 16), uint8_t(pixels[i] >> 8),
+                                uint8_t(pixels[i])};
+        std::fwrite(rgb, 1, 3, f);
+    }
+    return std::fclose(f) == 0;
+}
+
+inline uint32_t crc32(const uint8_t* data, size_t size, uint32_t crc = 0)
+{
+    static uint32_t table[256];
+    if (table[1] == 0)
+        for (uint32_t n = 0; n < 256; ++n) {
+            uint32_t c = n;
+            for (int k = 0; k < 8; ++k)
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            table[n] = c;
+        }
+    crc = ~crc;
+    for (size_t i = 0; i < size; ++i)
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+inline void put_be32(std::vector<uint8_t>& out, uint32_t value)
+{
+    for (int shift = 24; shift >= 0; shift -= 8)
+        out.push_back(uint8_t(value >> shift));
+}
+
+inline void png_chunk(std::vector<uint8_t>& out, const char* type,
+                      const std::vector<uint8_t>& data)
+{
+    put_be32(out, uint32_t(data.size()));
+    size_t start = out.size();
+    out.insert(out.end(), type, type + 4);
+    out.insert(out.end(), data.begin(), data.end());
+    put_be32(out, crc32(out.data() + start, out.size() - start));
+}
+
+inline bool write_png(const std::string& path, const uint32_t* pixels,
+                      unsigned width, unsigned height)
+{
+    // each row is filter type 0 followed by the RGB bytes
+    std::vector<uint8_t> raw;
+    raw.reserve(size_t(height) * (1 + 3 * size_t(width)));
+    for (unsigned y = 0; y < height; ++y) {
+        raw.push_back(0);
+        for (unsigned x = 0; x < width; ++x) {
+            uint32_t p = pixels[size_t(y) * width + x];
+            raw.push_back(uint8_t(p >> 16));
+            raw.push_back(uint8_t(p >> 8));
+            raw.push_back(uint8_t(p));
+        }
+    }
+
+    // zlib stream of stored blocks of up to 65535 bytes
+    std::vector<uint8_t> zlib = {0x78, 0x01};
+    uint32_t a = 1, b = 0;
+    for (size_t at = 0; at < raw.size() || at == 0;) {
+        size_t n = std::min<size_t>(65535, raw.size() - at);
+        bool last = at + n == raw.size();
+        zlib.push_back(last ? 1 : 0);
+        zlib.push_back(uint8_t(n));
+        zlib.push_back(uint8_t(n >> 8));
+        zlib.push_back(uint8_t(~n));
+        zlib.push_back(uint8_t(~n >> 8));
+        zlib.insert(zlib.end(), raw.begin() + long(at), raw.begin() + long(at + n));
+        for (size_t i = at; i < at + n; ++i) {
+            a = (a + raw[i]) % 65521;
+            b = (b + a) % 65521;
+        }
+        at += n;
+        if (last)
+            break;
+    }
+    put_be32(zlib, (b << 16) | a);
+
+    std::vector<uint8_t> header;
+    put_be32(header, width);
+    put_be32(header, height);
+    header.insert(header.end(), {8, 2, 0, 0, 0});   // 8 bit RGB
+
+    std::vector<uint8_t> png = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    png_chunk(png, "IHDR", header);
+    png_chunk(png, "IDAT", zlib);
+    png_chunk(png, "IEND", {});
+
+    FILE* f = std::fopen(path.c_str(), "wb");
+    if (!f)
+        return false;
+    std::fwrite(png.data(), 1, png.size(), f);
+    return std::fclose(f) == 0;
+}
+
+}  // namespace image_io
+
+#endif
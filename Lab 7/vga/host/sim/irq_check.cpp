@@ -0,0 +1,151 @@
+/*      irq_check.cpp
+        Cycle model and timing check of the scanline interrupt,
+        scanline_irq in vga.sv.
+
+        Build: g++ -std=c++17 -O2 -o irq_check irq_check.cpp
+        Usage: irq_check [rtl_dir]
+
+        For every mode in vga_modes.sv (read from rtl_dir, default
+        ../..), a PIC model sends OP_LINE_IRQ over the spi_model.h
+        command port at 10 MHz for each of a set of lines: the first
+        line of vsync, the first and last lines of the display area,
+        the last line of the frame, and lines at and past the frame's
+        line count, which never come. It also sends the command with
+        the enable bit clear. After the command, two whole frames are
+        watched, with vcnt and hcnt from the vgaController model:
+        line_irq must rise once per frame, 1 clock after vcnt reaches
+        the line, that is with hcnt at 1, and stay high for exactly one
+        line; it must never rise for lines that do not come or while
+        disabled. Reported is also the time from the end of the
+        command's last SPI byte to the line being set in scanline_irq. */
+
+#include "spi_model.h"
+#include "vga_sim.h"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using namespace vga_sim;
+
+namespace {
+
+/*
+ * ScanlineIrq
+ *
+ * scanline_irq: the enable and line registers, and irq registered
+ * from them and vcnt.
+ */
+struct ScanlineIrq {
+    bool     enabled = false, irq = false;
+    unsigned line = 0;
+
+    void clock(uint32_t command, bool command_valid, unsigned vcnt)
+    {
+        bool next_irq = enabled && vcnt == line;
+        if (command_valid && opcode(command) == OP_LINE_IRQ) {
+            enabled = (command >> 11) & 1;
+            line    = command & 0x7FF;
+        }
+        irq = next_irq;
+    }
+};
+
+struct Observed {
+    unsigned rises = 0, bad_rises = 0, bad_lengths = 0;
+    double   armed_us = -1;
+};
+
+Observed run(const Timing& t, unsigned line, bool enable)
+{
+    VgaController controller(t, 0);
+    SpiCommandPort port;
+    ScanlineIrq irq;
+    Observed seen;
+    bool     watching = false, old_irq = false;
+    uint64_t frames_left = 0, high_clocks = 0;
+    SpiLink* link_ptr = nullptr;
+    uint64_t sent_ps = 0;
+
+    SpiLink link(port, 10e6, t.pixel_khz * 1e3, [&]() {
+        // irq as registered at the last edge, with the counters it is
+        // registered from at this one
+        if (watching) {
+            if (irq.irq && !old_irq) {
+                ++seen.rises;
+                if (controller.vcnt != line || controller.hcnt != 1)
+                    ++seen.bad_rises;
+                high_clocks = 0;
+            }
+            if (irq.irq)
+                ++high_clocks;
+            if (!irq.irq && old_irq && high_clocks != t.h_total())
+                ++seen.bad_lengths;
+            if (controller.vcnt == 0 && controller.hcnt == 0 && frames_left)
+                --frames_left;
+        }
+        old_irq = irq.irq;
+        irq.clock(port.command, port.command_valid, controller.vcnt);
+        if (seen.armed_us < 0 && irq.line == (line & 0x7FF) && irq.enabled == enable)
+            seen.armed_us = (link_ptr->now_ps() - sent_ps) * 1e-6;
+        controller.clock();
+    });
+    link_ptr = &link;
+
+    // a different setting beforehand, so the command's arrival shows;
+    // the command is sent part way into a frame
+    irq.line = (line + 1) & 0x7FF;
+    irq.enabled = !enable;
+    link.advance_to(uint64_t(1e12 / t.refresh_hz() / 3));
+    // the command's last byte ends here
+    sent_ps = link.now_ps() + 6 * uint64_t(1e12 / 10e6 + 0.5) * 8;
+    link.send_frame(burst(OP_LINE_IRQ, 0, {(uint32_t(enable) << 11) | (line & 0x7FF)}));
+    watching = true;
+
+    // the rest of this frame, then two whole frames
+    frames_left = 3;
+    while (frames_left)
+        link.advance_to(link.now_ps() + 1000000);
+    // a rise in the last frame is watched to its end
+    link.advance_to(link.now_ps() + uint64_t(2e12 / (t.pixel_khz * 1e3) * t.h_total()));
+    return seen;
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    std::string rtl_dir = argc > 1 ? argv[1] : "../..";
+
+    std::vector<Timing> modes = read_modes(rtl_dir + "/vga_modes.sv");
+    if (modes.empty()) {
+        std::printf("cannot read the modes from %s/vga_modes.sv\n", rtl_dir.c_str());
+        return 1;
+    }
+    int failures = 0;
+    for (const Timing& t : modes) {
+        unsigned vstart = t.v_sync + t.v_back;
+        struct {
+            unsigned line;
+            bool     enable;
+        } cases[] = {
+            {0, true},  {vstart, true}, {vstart + t.v_active - 1, true},
+            {t.v_total() - 1, true}, {t.v_total(), true}, {2047, true},
+            {vstart, false},
+        };
+        std::printf("%s, %u lines of %u clocks\n", t.name.c_str(), t.v_total(), t.h_total());
+        for (const auto& c : cases) {
+            Observed o = run(t, c.line, c.enable);
+            bool comes = c.enable && c.line < t.v_total();
+            // the frame the command lands in may or may not reach the line
+            bool ok = o.armed_us >= 0 && o.bad_rises == 0 && o.bad_lengths == 0 &&
+                      (comes ? o.rises >= 2 && o.rises <= 3 : o.rises == 0);
+            std::printf("  line %4u%s: %u rises, %u not at hcnt 1 of the line, %u not one "
+                        "line long, set %.2f us after the command: %s\n", c.line,
+                        c.enable ? "" : " disabled", o.rises, o.bad_rises, o.bad_lengths,
+                        o.armed_us, ok ? "ok" : "FAIL");
+            failures += !ok;
+        }
+    }
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,404 @@
+/*      mouse_replay.cpp
+        Trace driven check of mouse_reader in vga.sv: HID mouse reports
+        replayed into a cycle model of it, frame by frame against a
+        plain C++ cursor.
+
+        Build: g++ -std=c++17 -O2 -o mouse_replay mouse_replay.cpp
+        Usage: mouse_replay [-w dir] [trace ...] [-r rtl_dir]
+
+        A trace is a text file with one mouse event per line, in time
+        order; blank lines and text after # are ignored:
+            time_ms d buttons dx dy    a report, as OP_MOUSE_DELTA sends
+                                       it: dx and dy are the signed
+                                       counts of the HID report
+            time_ms a buttons x y      an absolute OP_MOUSE packet
+        buttons is the 3 bit button field, left in bit 0.
+
+        No traces recorded from a mouse are in the tree, so with no
+        trace files the built-in synthetic traces are replayed: slow
+        single count drift, flicks into the screen edges, a circle at
+        1000 reports a second, clicks without movement, and absolute
+        jumps mixed with reports. -w writes them to dir in the format
+        above, as a starting point for recorded ones.
+
+        Each trace is replayed in every mode of vga_modes.sv (read
+        from rtl_dir, default ../..). An event reaches the model as a
+        command on the first vgaclk edge at or after its time, with
+        vsync from the vgaController model delayed by VIDEO_LATENCY as
+        in vga.sv. At every frame pulse the cursor, buttons, updates
+        and superseded counts must match a reference that groups the
+        events by the frame pulse that applies them, accelerates each
+        report by its size, sums in sixteenths of a pixel and clamps
+        to the screen. Reported per trace: events, most events in one
+        frame, superseded packets, and the time from an event to the
+        frame that shows it. */
+
+#include "spi_model.h"
+#include "vga_sim.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace vga_sim;
+
+namespace {
+
+const unsigned VIDEO_LATENCY = 5;
+
+struct Event {
+    double   time_ms;
+    bool     absolute;
+    unsigned buttons;
+    int      x, y;   // counts for a report, pixels for an absolute packet
+
+    uint32_t command() const
+    {
+        if (absolute)
+            return burst_command(OP_MOUSE, 0, (buttons & 7) << 20 |
+                                 (unsigned(x) & 0x3FF) << 10 | (unsigned(y) & 0x3FF));
+        return burst_command(OP_MOUSE_DELTA, 0, (buttons & 7) << 16 |
+                             (unsigned(x) & 0xFF) << 8 | (unsigned(y) & 0xFF));
+    }
+};
+
+struct Trace {
+    std::string        name;
+    std::vector<Event> events;
+};
+
+int32_t signed_bits(uint32_t value, unsigned bits)
+{
+    return int32_t(value << (32 - bits)) >> (32 - bits);
+}
+
+/*
+ * MouseReader
+ *
+ * mouse_reader: outputs are the position registers; clock() applies
+ * one vgaclk edge from the old register values.
+ */
+struct MouseReader {
+    MouseReader(unsigned x_max, unsigned y_max) : x_limit(x_max * 16 + 15),
+                                                  y_limit(y_max * 16 + 15) {}
+
+    int32_t  x_limit, y_limit;
+    bool     old_vsync = false, has_pending = false, has_absolute = false;
+    unsigned pending_buttons = 0, absolute_x = 0, absolute_y = 0;
+    int32_t  moved_x = 0, moved_y = 0;
+    int32_t  position_x = 0, position_y = 0;
+    unsigned button_state = 0, updates = 0, superseded = 0;
+
+    unsigned x_pixel() const { return unsigned(position_x) >> 4; }
+    unsigned y_pixel() const { return unsigned(position_y) >> 4; }
+
+    static int32_t accelerate(uint32_t byte)
+    {
+        int32_t  d    = signed_bits(byte, 8);
+        unsigned size = unsigned(d < 0 ? -d : d) & 0xFF;
+        int32_t  step = size < 4 ? d * 8 + d * 4 : size < 8 ? d * 16
+                      : size < 16 ? d * 16 + d * 8 : d * 32;
+        return signed_bits(uint32_t(step), 14);
+    }
+    static int32_t clamp(int32_t value, int32_t limit)
+    {
+        return value < 0 ? 0 : value > limit ? limit : value;
+    }
+
+    void clock(bool vsync, uint32_t command, bool command_valid)
+    {
+        bool absolute = command_valid && opcode(command) == OP_MOUSE;
+        bool relative = command_valid && opcode(command) == OP_MOUSE_DELTA;
+        bool packet   = absolute || relative;
+        bool frame    = vsync && !old_vsync;
+        int32_t base_x = has_absolute ? int32_t(absolute_x << 4) : position_x;
+        int32_t base_y = has_absolute ? int32_t(absolute_y << 4) : position_y;
+
+        if (frame && has_pending) {
+            position_x   = clamp(base_x + moved_x, x_limit);
+            position_y   = clamp(base_y + moved_y, y_limit);
+            button_state = pending_buttons;
+            updates      = (updates + 1) & 0xFFFF;
+        }
+        if (absolute) {
+            pending_buttons = (command >> 20) & 7;
+            absolute_x      = (command >> 10) & 0x3FF;
+            absolute_y      = command & 0x3FF;
+            has_absolute    = true;
+            moved_x = moved_y = 0;
+        } else if (relative) {
+            pending_buttons = (command >> 16) & 7;
+            has_absolute    = has_absolute && !frame;
+            moved_x = signed_bits(uint32_t((frame ? 0 : moved_x) + accelerate(command >> 8)), 20);
+            moved_y = signed_bits(uint32_t((frame ? 0 : moved_y) + accelerate(command)), 20);
+        } else if (frame) {
+            has_absolute = false;
+            moved_x = moved_y = 0;
+        }
+        if (absolute && has_pending && !frame)
+            superseded = (superseded + 1) & 0xFFFF;
+        has_pending = packet || (has_pending && !frame);
+        old_vsync   = vsync;
+    }
+};
+
+/*
+ * Cursor
+ *
+ * The reference: applies the events of one frame at once.
+ */
+struct Cursor {
+    int      x_limit, y_limit;
+    int      x = 0, y = 0;   // sixteenths of a pixel
+    unsigned buttons = 0, updates = 0, superseded = 0;
+
+    static int sixteenths(int counts)
+    {
+        int size = std::abs(counts);
+        // x0.75 below 4 counts, x1 below 8, x1.5 below 16, then x2
+        int scale = size < 4 ? 12 : size < 8 ? 16 : size < 16 ? 24 : 32;
+        return counts * scale;
+    }
+
+    void frame(const std::vector<Event>& events)
+    {
+        if (events.empty())
+            return;
+        int sum_x = x, sum_y = y;
+        for (const Event& e : events) {
+            if (e.absolute) {
+                // the events before it in the frame are discarded
+                superseded += &e != &events.front();
+                sum_x = e.x * 16;
+                sum_y = e.y * 16;
+            } else {
+                sum_x += sixteenths(e.x);
+                sum_y += sixteenths(e.y);
+            }
+            buttons = e.buttons;
+        }
+        x = std::clamp(sum_x, 0, x_limit);
+        y = std::clamp(sum_y, 0, y_limit);
+        ++updates;
+    }
+};
+
+struct Result {
+    size_t   events = 0, frames = 0, mismatches = 0;
+    unsigned most_per_frame = 0;
+    unsigned superseded = 0;
+    double   mean_lag_ms = 0, max_lag_ms = 0;
+};
+
+Result replay(const Trace& trace, const Timing& t)
+{
+    unsigned x_max = std::min(t.h_active, 1024u) - 1;
+    unsigned y_max = std::min(t.v_active, 1024u) - 1;
+    VgaController controller(t, VIDEO_LATENCY);
+    MouseReader   reader(x_max, y_max);
+    Cursor        cursor = {int(x_max * 16 + 15), int(y_max * 16 + 15)};
+    Result        r;
+
+    const double ms_per_clock = 1.0 / t.pixel_khz;
+    double   end_ms = trace.events.empty() ? 0 : trace.events.back().time_ms + 40;
+    uint64_t clocks = uint64_t(end_ms / ms_per_clock) + 1;
+    size_t   next = 0;
+    std::vector<Event> frame_events;
+    std::vector<double> frame_times;
+    double   lag_sum = 0;
+    bool     old_vsync = controller.vsync();
+
+    for (uint64_t c = 0; c < clocks; ++c) {
+        double now_ms = c * ms_per_clock;
+        bool   frame  = controller.vsync() && !old_vsync;
+        old_vsync = controller.vsync();
+
+        bool     valid   = next < trace.events.size() && trace.events[next].time_ms <= now_ms;
+        uint32_t command = valid ? trace.events[next].command() : 0;
+        reader.clock(controller.vsync(), command, valid);
+
+        // the registers after this edge, against the reference
+        if (frame) {
+            r.most_per_frame = std::max(r.most_per_frame, unsigned(frame_events.size()));
+            for (double at : frame_times) {
+                lag_sum     += now_ms - at;
+                r.max_lag_ms = std::max(r.max_lag_ms, now_ms - at);
+            }
+            cursor.frame(frame_events);
+            frame_events.clear();
+            frame_times.clear();
+            ++r.frames;
+            bool same = reader.position_x == cursor.x && reader.position_y == cursor.y &&
+                        reader.button_state == cursor.buttons &&
+                        reader.updates == cursor.updates &&
+                        reader.superseded == cursor.superseded;
+            if (!same) {
+                if (r.mismatches < 5)
+                    std::printf("    %s frame %zu: model %u,%u buttons %u updates %u "
+                                "superseded %u, reference %d,%d %u %u %u\n",
+                                t.name.c_str(), r.frames, reader.x_pixel(),
+                                reader.y_pixel(), reader.button_state, reader.updates,
+                                reader.superseded, cursor.x >> 4, cursor.y >> 4,
+                                cursor.buttons, cursor.updates, cursor.superseded);
+                ++r.mismatches;
+            }
+        }
+        // an event on the frame pulse's clock counts towards the next
+        if (valid) {
+            frame_events.push_back(trace.events[next]);
+            frame_times.push_back(trace.events[next].time_ms);
+            ++next;
+        }
+        controller.clock();
+    }
+    r.events     = trace.events.size();
+    r.superseded = reader.superseded;
+    r.mean_lag_ms = r.events ? lag_sum / r.events : 0;
+    return r;
+}
+
+std::vector<Trace> synthetic_traces()
+{
+    std::vector<Trace> traces;
+    auto report = [](double ms, unsigned buttons, int dx, int dy) {
+        return Event{ms, false, buttons, dx, dy};
+    };
+
+    // single counts every 8 ms, which only move the cursor through
+    // the kept fraction
+    Trace drift = {"drift", {}};
+    for (unsigned i = 0; i < 250; ++i)
+        drift.events.push_back(report(i * 8.0, 0, 1, i % 3 == 0 ? -1 : 0));
+    traces.push_back(drift);
+
+    // flicks to each edge and past it, with the largest counts
+    Trace flick = {"flick", {}};
+    double ms = 0;
+    const int directions[4][2] = {{1, 0}, {0, 1}, {-1, 0}, {0, -1}};
+    for (const auto& d : directions)
+        for (int i = 0; i < 60; ++i, ms += 8) {
+            int size = i < 30 ? 4 * i + 7 : 127;
+            flick.events.push_back(report(ms, 1, d[0] * size, d[1] * size));
+        }
+    flick.events.push_back(report(ms, 0, -128, -128));
+    traces.push_back(flick);
+
+    // a circle from a 1000 Hz mouse, many reports a frame
+    Trace circle = {"circle", {}};
+    for (unsigned i = 0; i < 1500; ++i) {
+        double angle = i * 0.01;
+        circle.events.push_back(report(i * 1.0, 0, int(std::lround(12 * std::cos(angle))),
+                                       int(std::lround(12 * std::sin(angle)))));
+    }
+    traces.push_back(circle);
+
+    // clicks with the mouse still
+    Trace clicks = {"clicks", {}};
+    for (unsigned i = 0; i < 64; ++i)
+        clicks.events.push_back(report(i * 23.0, i & 7, 0, 0));
+    traces.push_back(clicks);
+
+    // absolute jumps, within a frame of reports and alone
+    Trace jumps = {"jumps", {}};
+    for (unsigned i = 0; i < 400; ++i) {
+        double at = i * 4.0;
+        if (i % 50 == 10)
+            jumps.events.push_back({at, true, 2, int(i % 640), int(i % 480)});
+        else
+            jumps.events.push_back(report(at, 0, int(i % 17) - 8, 5 - int(i % 11)));
+    }
+    traces.push_back(jumps);
+    return traces;
+}
+
+bool read_trace(const std::string& path, Trace& trace)
+{
+    std::string text = read_file(path);
+    if (text.empty())
+        return false;
+    trace.name = path;
+    std::stringstream lines(text);
+    std::string line;
+    while (std::getline(lines, line)) {
+        line = line.substr(0, line.find('#'));
+        std::stringstream fields(line);
+        Event e = {};
+        std::string kind;
+        if (!(fields >> e.time_ms))
+            continue;
+        if (!(fields >> kind >> e.buttons >> e.x >> e.y) || (kind != "d" && kind != "a"))
+            return false;
+        e.absolute = kind == "a";
+        trace.events.push_back(e);
+    }
+    return true;
+}
+
+bool write_trace(const std::string& path, const Trace& trace)
+{
+    FILE* f = std::fopen(path.c_str(), "w");
+    if (!f)
+        return false;
+    std::fprintf(f, "# %s: time_ms d buttons dx dy | time_ms a buttons x y\n",
+                 trace.name.c_str());
+    for (const Event& e : trace.events)
+        std::fprintf(f, "%.3f %c %u %d %d\n", e.time_ms, e.absolute ? 'a' : 'd',
+                     e.buttons, e.x, e.y);
+    return std::fclose(f) == 0;
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    std::string rtl_dir = "../..", write_dir;
+    std::vector<Trace> traces;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if ((arg == "-r" || arg == "-w") && i + 1 < argc) {
+            (arg == "-r" ? rtl_dir : write_dir) = argv[++i];
+        } else {
+            Trace trace;
+            if (!read_trace(arg, trace)) {
+                std::printf("cannot read the trace %s\n", arg.c_str());
+                return 1;
+            }
+            traces.push_back(trace);
+        }
+    }
+    if (traces.empty()) {
+        traces = synthetic_traces();
+        if (!write_dir.empty())
+            for (const Trace& trace : traces)
+                if (!write_trace(write_dir + "/" + trace.name + ".txt", trace)) {
+                    std::printf("cannot write %s/%s.txt\n", write_dir.c_str(),
+                                trace.name.c_str());
+                    return 1;
+                }
+    }
+
+    std::vector<Timing> modes = read_modes(rtl_dir + "/vga_modes.sv");
+    if (modes.empty()) {
+        std::printf("cannot read the modes from %s/vga_modes.sv\n", rtl_dir.c_str());
+        return 1;
+    }
+    int failures = 0;
+    for (const Timing& t : modes) {
+        std::printf("%s\n", t.name.c_str());
+        for (const Trace& trace : traces) {
+            Result r = replay(trace, t);
+            bool ok = r.mismatches == 0;
+            std::printf("  %-8s %5zu events over %4zu frames, up to %2u a frame, "
+                        "%4u superseded, shown %4.1f ms after on average, at most "
+                        "%4.1f: %zu frames differ: %s\n", trace.name.c_str(), r.events,
+                        r.frames, r.most_per_frame, r.superseded, r.mean_lag_ms,
+                        r.max_lag_ms, r.mismatches, ok ? "ok" : "FAIL");
+            failures += !ok;
+        }
+    }
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,162 @@
+/*      pipeline_check.cpp
+        Equivalence check of the pipelined background and draw_cursor
+        blend in vga.sv against the unpipelined design they replaced.
+
+        Build: g++ -std=c++17 -O2 -o pipeline_check pipeline_check.cpp ../video_model.cpp
+        Usage: pipeline_check [cycles]
+
+        BackgroundPipe below models background register by register:
+        stage 1 registers diff, sum and the waves with the counter they
+        were computed from, stage 2 the product, and rgb the color, so
+        the color for x_screen, y_screen comes out 3 clocks later. It is
+        driven every clock, through whole raster frames and then random
+        x, y for cycles clocks (default 20M), with frame pulses at
+        random clocks, also in the middle of a line. Each output is
+        compared with the unpipelined background, transcribed from the
+        always_comb block as it was before pipelining, for the x, y and
+        counter that went in 3 clocks earlier, and with
+        video_model::background_pixel.
+
+        The unpipelined draw_cursor averaged the cursor color and the
+        pixel below, (color + below) >> 1; the pipelined one blends with
+        weight alpha+1 of 256, and at the power-up alpha of 127 must give
+        the same result for every pair of 8-bit values. */
+
+#include "../video_model.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+namespace {
+
+/* background before pipelining: one always_comb block. */
+uint32_t unpipelined_background(unsigned x_screen, unsigned y_screen, unsigned counter)
+{
+    unsigned x = x_screen & 0x3FF, y = y_screen & 0x3FF;
+    counter &= 0x7FF;
+    unsigned diff      = (x - y + counter) & 0x3FF;
+    unsigned sum       = (x + y - counter) & 0x3FF;
+    unsigned product   = (diff * sum) & 0xFFFFF;
+    unsigned intensity = (((product >> 4) + (counter << 2)) & 0xFF) >> 3;
+    unsigned x_wave    = ((((x << 2) - counter) & 0xFF) >> 5) +
+                         (((0u - (x << 2) - counter) & 0xFF) >> 5);
+    unsigned y_wave    = ((((y << 2) - counter) & 0xFF) >> 6) +
+                         (((0u - (y << 2) - counter) & 0xFF) >> 6);
+    unsigned r = (0x70 + x_wave + y_wave) & 0xFF;
+    unsigned g = (0x80 + (~intensity & 0xFF)) & 0xFF;
+    unsigned b = (0xC0 + intensity + x_wave + y_wave) & 0xFF;
+    return (r << 16) | (g << 8) | b;
+}
+
+/*
+ * BackgroundPipe
+ *
+ * background after pipelining, with its registers as in vga.sv.
+ */
+struct BackgroundPipe {
+    unsigned counter = 0;
+    unsigned diff_1 = 0, sum_1 = 0, x_wave_1 = 0, y_wave_1 = 0, counter_1 = 0;
+    unsigned product_2 = 0, x_wave_2 = 0, y_wave_2 = 0, counter_2 = 0;
+    uint32_t rgb = 0;
+
+    void clock(bool frame, unsigned x_screen, unsigned y_screen)
+    {
+        // stage 1
+        unsigned x = x_screen & 0x3FF, y = y_screen & 0x3FF;
+        unsigned diff   = (x - y + counter) & 0x3FF;
+        unsigned sum    = (x + y - counter) & 0x3FF;
+        unsigned x_wave = (((((x << 2) - counter) & 0xFF) >> 5) +
+                           (((0u - (x << 2) - counter) & 0xFF) >> 5)) & 0xFF;
+        unsigned y_wave = (((((y << 2) - counter) & 0xFF) >> 6) +
+                           (((0u - (y << 2) - counter) & 0xFF) >> 6)) & 0xFF;
+        // stage 3
+        unsigned intensity = (((product_2 >> 4) + (counter_2 << 2)) & 0xFF) >> 3;
+        unsigned r = (0x70 + x_wave_2 + y_wave_2) & 0xFF;
+        unsigned g = (0x80 + (~intensity & 0xFF)) & 0xFF;
+        unsigned b = (0xC0 + intensity + x_wave_2 + y_wave_2) & 0xFF;
+
+        rgb = (r << 16) | (g << 8) | b;
+        product_2 = (diff_1 * sum_1) & 0xFFFFF;
+        x_wave_2 = x_wave_1; y_wave_2 = y_wave_1; counter_2 = counter_1;
+        diff_1 = diff; sum_1 = sum; x_wave_1 = x_wave; y_wave_1 = y_wave;
+        counter_1 = counter;
+        if (frame)
+            counter = (counter + 1) & 0x7FF;
+    }
+};
+
+struct Input {
+    unsigned x, y, counter;
+};
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    uint64_t cycles = argc > 1 ? std::strtoull(argv[1], nullptr, 0) : 20000000;
+    const unsigned LATENCY = 3;
+
+    BackgroundPipe pipe;
+    Input history[LATENCY + 1] = {};
+    std::mt19937_64 rng(32);
+    uint64_t checked = 0, errors = 0, frames = 0;
+
+    // 4 raster frames of 800x525 with the pulse at the end of vsync,
+    // then random positions and pulses
+    const uint64_t raster = 4ull * 800 * 525;
+    for (uint64_t t = 0; t < raster + cycles; ++t) {
+        unsigned x, y;
+        bool frame;
+        if (t < raster) {
+            unsigned hcnt = unsigned(t % 800), vcnt = unsigned(t / 800 % 525);
+            x = (hcnt - 144) & 0x7FF;
+            y = (vcnt - 35 + 1) & 0x7FF;   // next_y, as videoGen passes it
+            frame = hcnt == 96 && vcnt == 2;
+        } else {
+            x = unsigned(rng() & 0x7FF);
+            y = unsigned(rng() & 0x7FF);
+            frame = rng() % 97 == 0;
+        }
+
+        // the input of LATENCY clocks ago must be on rgb now
+        if (t >= LATENCY) {
+            const Input& in = history[(t - LATENCY) % (LATENCY + 1)];
+            uint32_t expected = unpipelined_background(in.x, in.y, in.counter);
+            uint32_t model    = video_model::background_pixel(in.x & 0x3FF, in.y & 0x3FF,
+                                                               in.counter);
+            if (pipe.rgb != expected || model != expected) {
+                if (errors < 5)
+                    std::printf("  cycle %llu: x %u y %u counter %u: pipelined %06X, "
+                                "unpipelined %06X, video_model %06X\n",
+                                (unsigned long long)t, in.x, in.y, in.counter, pipe.rgb,
+                                expected, model);
+                ++errors;
+            }
+            ++checked;
+        }
+        history[t % (LATENCY + 1)] = {x, y, pipe.counter};
+        frames += frame;
+        pipe.clock(frame, x, y);
+    }
+    std::printf("background: %llu pixels checked %u clocks after x, y across %llu "
+                "frame pulses, %llu mismatches: %s\n", (unsigned long long)checked,
+                LATENCY, (unsigned long long)frames, (unsigned long long)errors,
+                errors ? "FAIL" : "ok");
+
+    // draw_cursor blend at the power-up alpha against the old average
+    uint64_t blend_errors = 0;
+    for (unsigned color = 0; color < 256; ++color)
+        for (unsigned below = 0; below < 256; ++below) {
+            uint32_t blended = video_model::blend_pixel(color * 0x010101, 127,
+                                                        below * 0x010101);
+            uint32_t average = (color + below) >> 1;
+            if (blended != average * 0x010101)
+                ++blend_errors;
+        }
+    std::printf("draw_cursor blend at alpha 127 against (color + below) >> 1: "
+                "%llu of 65536 pairs differ: %s\n", (unsigned long long)blend_errors,
+                blend_errors ? "FAIL" : "ok");
+    return errors || blend_errors ? 1 : 0;
+}
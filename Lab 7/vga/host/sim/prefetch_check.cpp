@@ -0,0 +1,159 @@
+/*      prefetch_check.cpp
+        Check of line_prefetch.sv, the line buffer videoGen draws the
+        layers through, in every display mode.
+
+        Build: g++ -std=c++17 -O2 -o prefetch_check prefetch_check.cpp
+        Usage: prefetch_check [frames] [rtl_dir]
+
+        LinePrefetch below models line_prefetch register by register,
+        with the parameters videoGen gives it: LATENCY 7, OUT_DELAY 3
+        and LINE_WIDTH the active width of the mode. For every mode in
+        vga_modes.sv (read from rtl_dir, default ../..), x and y come
+        from the vgaController model for frames frames (default 3),
+        and the layer output for x, y+1, a hash of the two, arrives
+        LATENCY clocks after them, as the compositor delivers it.
+        The halves are LINE_WIDTH rounded up to a power of two, as
+        line_prefetch sizes them. shown, 3 clocks after x, y, must be
+        the hash of x, y on every pixel of the display area.
+
+        The same is run for the buffer as it was before, with halves of
+        1024 pixels addressed by x[9:0] and the default LINE_WIDTH of
+        640, and the pixels that differ are counted for comparison. */
+
+#include "vga_sim.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <string>
+#include <vector>
+
+using vga_sim::Timing;
+
+namespace {
+
+const unsigned LATENCY   = 7;
+const unsigned OUT_DELAY = 3;
+
+uint32_t layer_pixel(unsigned x, unsigned y)
+{
+    uint32_t h = x * 2654435761u ^ (y + 1) * 40503u;
+    return (h ^ h >> 15) & 0xFFFFFF;
+}
+
+/*
+ * LinePrefetch
+ *
+ * line_prefetch with halves of 2**addr_bits pixels, addressed by the
+ * low addr_bits of x.
+ */
+struct LinePrefetch {
+    struct Write {
+        bool     valid, half;
+        unsigned addr;
+    };
+
+    LinePrefetch(unsigned addr_bits, unsigned line_width)
+        : bits(addr_bits), width(line_width), lines(size_t(2) << addr_bits, 0),
+          write_pipe(LATENCY, Write{false, false, 0}), out_pipe(OUT_DELAY - 1, 0)
+    {
+    }
+
+    unsigned              bits, width;
+    std::vector<uint32_t> lines;
+    std::deque<Write>     write_pipe;
+    uint32_t              q = 0;
+    std::deque<uint32_t>  out_pipe;
+
+    uint32_t shown() const { return out_pipe.empty() ? q : out_pipe.back(); }
+
+    void clock(unsigned x, unsigned y, uint32_t ahead)
+    {
+        unsigned mask = (1u << bits) - 1;
+        Write w = write_pipe.back();
+        if (!out_pipe.empty()) {
+            out_pipe.pop_back();
+            out_pipe.push_front(q);
+        }
+        // the read gives the word from before this edge's write
+        q = lines[((y & 1) << bits) | (x & mask)];
+        if (w.valid)
+            lines[(unsigned(w.half) << bits) | w.addr] = ahead;
+        write_pipe.pop_back();
+        write_pipe.push_front(Write{x < width, !(y & 1), x & mask});
+    }
+};
+
+uint64_t run_mode(const Timing& t, unsigned frames, unsigned addr_bits,
+                  unsigned line_width, uint64_t& pixels)
+{
+    vga_sim::VgaController controller(t, 0);
+    LinePrefetch buffer(addr_bits, line_width);
+    // x, y of the last LATENCY clocks, for the layer output and shown
+    std::deque<std::pair<unsigned, unsigned>> in(LATENCY, {0, 0});
+    uint64_t errors = 0;
+    uint64_t clocks = uint64_t(frames) * t.h_total() * t.v_total();
+    pixels = 0;
+    for (uint64_t c = 0; c < clocks; ++c) {
+        unsigned x = controller.x(), y = controller.y();
+        // shown, after the edge before, is for x, y of OUT_DELAY
+        // clocks ago
+        if (c >= OUT_DELAY) {
+            auto at = in[OUT_DELAY - 1];
+            if (at.first < t.h_active && at.second < t.v_active) {
+                ++pixels;
+                if (buffer.shown() != layer_pixel(at.first, at.second)) {
+                    if (errors < 3 && line_width == t.h_active)
+                        std::printf("    %s x %u y %u: shown %06X, expected %06X\n",
+                                    t.name.c_str(), at.first, at.second, buffer.shown(),
+                                    layer_pixel(at.first, at.second));
+                    ++errors;
+                }
+            }
+        }
+        // the layers were given x and y+1 LATENCY clocks ago
+        auto given = in[LATENCY - 1];
+        uint32_t ahead = layer_pixel(given.first, (given.second + 1) & 0x7FF);
+        buffer.clock(x, y, ahead);
+        in.pop_back();
+        in.push_front({x, y});
+        controller.clock();
+    }
+    return errors;
+}
+
+/* $clog2(width): the address bits of a half of width pixels. */
+unsigned clog2(unsigned width)
+{
+    unsigned bits = 0;
+    while ((1u << bits) < width)
+        ++bits;
+    return bits;
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    unsigned    frames  = argc > 1 ? unsigned(std::atoi(argv[1])) : 3;
+    std::string rtl_dir = argc > 2 ? argv[2] : "../..";
+
+    std::vector<Timing> modes = vga_sim::read_modes(rtl_dir + "/vga_modes.sv");
+    if (modes.empty()) {
+        std::printf("cannot read the modes from %s/vga_modes.sv\n", rtl_dir.c_str());
+        return 1;
+    }
+    int failures = 0;
+    for (const Timing& t : modes) {
+        uint64_t pixels, old_pixels;
+        uint64_t errors     = run_mode(t, frames, clog2(t.h_active), t.h_active, pixels);
+        uint64_t old_errors = run_mode(t, frames, 10, 640, old_pixels);
+        bool ok = errors == 0 && pixels == uint64_t(frames) * t.h_active * t.v_active;
+        std::printf("%-12s %u frames, %u pixel halves, %llu pixels: %llu differ, with 1024 "
+                    "pixel halves and LINE_WIDTH 640 %llu differ: %s\n", t.name.c_str(), frames,
+                    1u << clog2(t.h_active), (unsigned long long)pixels, (unsigned long long)errors,
+                    (unsigned long long)old_errors, ok ? "ok" : "FAIL");
+        failures += !ok;
+    }
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,240 @@
+/*      span_check.cpp
+        Pixel identity check of the span based in_ellipse in vga.sv
+        against the per-pixel multiplier version it replaced.
+
+        Build: g++ -std=c++17 -O2 -o span_check span_check.cpp
+        Usage: span_check [frames] [rtl_dir]
+
+        Both versions are modelled clock by clock: MultiplierEllipse
+        squares d_x and d_y for every pixel in three register stages,
+        and SpanEllipse finds the half width of line y+1 by shift and
+        add and a bit serial square root while line y is shown, then
+        compares |x - cent_x| with it. For every mode in vga_modes.sv
+        (read from rtl_dir, default ../..), x and y come from the
+        vgaController model for frames frames (default 12). Three
+        ellipses are checked on every clock: draw_cursor's cursor
+        (rad_squared 140, x_reduce 1) and hitbox (8), and one with a
+        random radius and reductions. Centers, including the screen
+        edges, change at the frame pulse, as the cursor does in
+        mouse_reader. is_in must be the same from both on every pixel
+        of the display area, and the span search must end before the
+        next line starts. */
+
+#include "vga_sim.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+using vga_sim::Timing;
+
+namespace {
+
+struct Shape {
+    unsigned cent_x, cent_y;
+    uint32_t rad_squared;
+    unsigned x_reduce, y_reduce;
+};
+
+/*
+ * MultiplierEllipse
+ *
+ * in_ellipse before the span search: signed 16-bit distances, their
+ * 32-bit squares, then the compare, one register stage each.
+ */
+struct MultiplierEllipse {
+    int32_t  d_x = 0, d_y = 0;
+    uint32_t d_x_squared = 0, d_y_squared = 0;
+    bool     is_in = false;
+
+    void clock(unsigned x, unsigned y, const Shape& s)
+    {
+        is_in       = d_x_squared + d_y_squared < s.rad_squared;
+        d_x_squared = uint32_t(d_x * d_x);
+        d_y_squared = uint32_t(d_y * d_y);
+        d_x = int16_t(uint16_t((x - s.cent_x) << s.x_reduce));
+        d_y = int16_t(uint16_t((y - s.cent_y) << s.y_reduce));
+    }
+};
+
+/*
+ * SpanEllipse
+ *
+ * in_ellipse as it is now, with the IDLE, SQUARE and ROOT states of
+ * the span search and the three stage compare.
+ */
+struct SpanEllipse {
+    enum State { IDLE, SQUARE, ROOT } state = IDLE;
+    uint32_t multiplier = 0, multiplicand = 0, d_y_squared = 0;
+    uint32_t remainder = 0, root = 0, root_bit = 0;
+    bool     next_hit = false, line_hit = false;
+    uint32_t next_half = 0, line_half = 0;
+    int32_t  d_x = 0;
+    uint32_t d_x_size = 0;
+    bool     is_in = false;
+    unsigned busy_clocks = 0, max_busy_clocks = 0;
+
+    void clock(unsigned x, unsigned y, const Shape& s)
+    {
+        unsigned next_y   = (y + 1) & 0x7FF;
+        int32_t  d_y      = int16_t(uint16_t((next_y - s.cent_y) << s.y_reduce));
+        uint32_t d_y_size = uint16_t(d_y < 0 ? -d_y : d_y);
+
+        is_in    = line_hit && d_x_size <= line_half;
+        d_x_size = uint32_t(d_x < 0 ? -d_x : d_x) & 0x7FF;
+        d_x      = int32_t((x - s.cent_x) << 20) >> 20;   // 12-bit signed
+
+        if (state != IDLE)
+            max_busy_clocks = std::max(max_busy_clocks, ++busy_clocks);
+        switch (state) {
+        case IDLE:
+            if (x == 0) {
+                line_hit     = next_hit;
+                line_half    = next_half;
+                d_y_squared  = 0;
+                multiplicand = d_y_size;
+                multiplier   = d_y_size;
+                state        = SQUARE;
+                busy_clocks  = 0;
+            }
+            break;
+        case SQUARE:
+            if (multiplier == 0) {
+                next_hit  = d_y_squared < s.rad_squared;
+                remainder = s.rad_squared - d_y_squared - 1;
+                root      = 0;
+                root_bit  = 0x40000000;
+                state     = ROOT;
+            } else {
+                if (multiplier & 1)
+                    d_y_squared += multiplicand;
+                multiplicand <<= 1;
+                multiplier   >>= 1;
+            }
+            break;
+        case ROOT:
+            if (root_bit == 0) {
+                next_half = (root >> s.x_reduce) & 0xFFFF;
+                state     = IDLE;
+            } else {
+                if (remainder >= root + root_bit) {
+                    remainder -= root + root_bit;
+                    root       = (root >> 1) + root_bit;
+                } else {
+                    root >>= 1;
+                }
+                root_bit >>= 2;
+            }
+            break;
+        }
+    }
+};
+
+struct Totals {
+    uint64_t pixels = 0, inside = 0, mismatches = 0;
+    unsigned max_busy = 0;
+};
+
+Totals run_mode(const Timing& t, unsigned frames, std::mt19937& rng)
+{
+    vga_sim::VgaController controller(t, 0);
+    const unsigned LATENCY = 3;
+    const unsigned SHAPES  = 3;
+    Shape shapes[SHAPES];
+    MultiplierEllipse reference[SHAPES];
+    SpanEllipse       span[SHAPES];
+    std::vector<bool> valid_pipe(LATENCY, false);
+    Totals totals;
+
+    auto new_shapes = [&](unsigned frame) {
+        // the cursor is kept within the screen and 10 bits, as
+        // mouse_reader keeps it; the corners are tried first
+        unsigned x_max = std::min(t.h_active, 1024u) - 1;
+        unsigned y_max = std::min(t.v_active, 1024u) - 1;
+        unsigned cx = frame == 0 ? 0 : frame == 1 ? x_max : unsigned(rng() % (x_max + 1));
+        unsigned cy = frame == 0 ? 0 : frame == 1 ? y_max : unsigned(rng() % (y_max + 1));
+        shapes[0] = {cx, cy, 140, 1, 0};
+        shapes[1] = {cx, cy, 8, 0, 0};
+        uint32_t radius = uint32_t(rng() % 700);
+        shapes[2] = {unsigned(rng() % 1024), unsigned(rng() % 1024),
+                     radius * radius + uint32_t(rng() % (2 * radius + 1)),
+                     unsigned(rng() % 4), unsigned(rng() % 4)};
+    };
+
+    bool old_vsync = controller.vsync();
+    unsigned frame = 0;
+    new_shapes(frame++);
+    uint64_t clocks = uint64_t(frames + 1) * t.h_total() * t.v_total();
+    bool started = false;
+    for (uint64_t c = 0; c < clocks; ++c) {
+        unsigned x = controller.x(), y = controller.y();
+        bool valid_out = valid_pipe[LATENCY - 1];
+        // compare from the first whole frame, once every span is known
+        if (started && valid_out) {
+            ++totals.pixels;
+            for (unsigned i = 0; i < SHAPES; ++i) {
+                totals.inside += reference[i].is_in;
+                if (span[i].is_in != reference[i].is_in) {
+                    if (totals.mismatches < 5)
+                        std::printf("    %s shape %u center %u,%u rad_squared %u "
+                                    "reduce %u,%u: span %d, multiplier %d\n",
+                                    t.name.c_str(), i, shapes[i].cent_x, shapes[i].cent_y,
+                                    shapes[i].rad_squared, shapes[i].x_reduce,
+                                    shapes[i].y_reduce, span[i].is_in,
+                                    reference[i].is_in);
+                    ++totals.mismatches;
+                }
+            }
+        }
+        for (unsigned i = 0; i < SHAPES; ++i) {
+            reference[i].clock(x, y, shapes[i]);
+            span[i].clock(x, y, shapes[i]);
+        }
+        for (unsigned i = LATENCY - 1; i > 0; --i)
+            valid_pipe[i] = valid_pipe[i - 1];
+        valid_pipe[0] = controller.raw_valid();
+
+        // mouse_reader moves the cursor at the frame pulse
+        bool vsync = controller.vsync();
+        if (vsync && !old_vsync) {
+            if (started)
+                new_shapes(frame++);
+            started = true;
+        }
+        old_vsync = vsync;
+        controller.clock();
+    }
+    for (const SpanEllipse& s : span)
+        totals.max_busy = std::max(totals.max_busy, s.max_busy_clocks);
+    return totals;
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    unsigned    frames  = argc > 1 ? unsigned(std::atoi(argv[1])) : 12;
+    std::string rtl_dir = argc > 2 ? argv[2] : "../..";
+
+    std::vector<Timing> modes = vga_sim::read_modes(rtl_dir + "/vga_modes.sv");
+    if (modes.empty()) {
+        std::printf("cannot read the modes from %s/vga_modes.sv\n", rtl_dir.c_str());
+        return 1;
+    }
+    std::mt19937 rng(40);
+    int failures = 0;
+    for (const Timing& t : modes) {
+        Totals r = run_mode(t, frames, rng);
+        bool ok = r.mismatches == 0 && r.max_busy < t.h_total();
+        std::printf("%-12s %u frames, %llu pixels x 3 shapes, %llu inside: %llu differ; "
+                    "span search at most %u clocks of a %u clock line: %s\n",
+                    t.name.c_str(), frames, (unsigned long long)r.pixels,
+                    (unsigned long long)r.inside, (unsigned long long)r.mismatches,
+                    r.max_busy, t.h_total(), ok ? "ok" : "FAIL");
+        failures += !ok;
+    }
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,308 @@
+/*      spi_model.h
+        Cycle models of the SPI command path of vga.sv: the burst
+        decoder and command port of spi_burst.sv, with its
+        asynchronous FIFO, the burst encoding of vga_commands.sv, and
+        a PIC that sends frames of bursts at a given SPI clock.
+
+        spi_clk and vgaclk are unrelated, so SpiLink steps time in
+        picoseconds and clocks each model on its own edges. */
+
+#ifndef SPI_MODEL_H
+#define SPI_MODEL_H
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace vga_sim {
+
+/* vga_commands.sv */
+enum Opcode : unsigned {
+    OP_MOUSE = 0x0, OP_PIXEL = 0x1, OP_PALETTE = 0x2, OP_CONTROL = 0x3,
+    OP_TEXT = 0x4, OP_TEXT_CONTROL = 0x5, OP_SPRITE_PATTERN = 0x6,
+    OP_SPRITE = 0x7, OP_BLIT = 0x8, OP_LINE_IRQ = 0x9, OP_MOUSE_DELTA = 0xA,
+    OP_TILE = 0xB, OP_TILE_CONTROL = 0xC, OP_PIXEL_PACKED = 0xD,
+    OP_HIT_RECT = 0xE, OP_NOP = 0xF
+};
+
+inline unsigned opcode(uint32_t command) { return command >> 28; }
+
+inline unsigned element_bytes(unsigned op)
+{
+    switch (op) {
+    case OP_MOUSE: case OP_MOUSE_DELTA:
+        return 3;
+    case OP_TEXT: case OP_TEXT_CONTROL: case OP_SPRITE_PATTERN: case OP_SPRITE:
+    case OP_BLIT: case OP_LINE_IRQ: case OP_TILE_CONTROL: case OP_HIT_RECT:
+        return 2;
+    default:
+        return 1;
+    }
+}
+
+inline uint32_t burst_command(unsigned op, uint32_t address, uint32_t element)
+{
+    uint32_t top = uint32_t(op) << 28;
+    address &= 0x1FFFF;
+    element &= 0xFFFFFF;
+    switch (op) {
+    case OP_MOUSE:
+        return top | (element & 0x7FFFFF);
+    case OP_PIXEL: case OP_PIXEL_PACKED:
+        return top | (address << 8) | (element & 0xFF);
+    case OP_PALETTE:
+        return top | ((address & 3) << 16) | (((address >> 2) & 0xFF) << 8) |
+               (element & 0xFF);
+    case OP_CONTROL:
+        return top | ((address & 15) << 24) | (element & 0xFF);
+    case OP_TEXT: case OP_SPRITE_PATTERN:
+        return top | ((address & 0xFFF) << 16) | (element & 0xFFFF);
+    case OP_SPRITE:
+        return top | ((address & 0x3F) << 22) | (element & 0xFFFF);
+    case OP_BLIT: case OP_TILE_CONTROL:
+        return top | ((address & 15) << 24) | (element & 0xFFFF);
+    case OP_TILE:
+        return top | ((address & 0x3FFF) << 8) | (element & 0xFF);
+    case OP_HIT_RECT:
+        return top | ((address & 0xFF) << 20) | (element & 0xFFFF);
+    default:
+        return top | element;
+    }
+}
+
+/* The bytes of one burst: header, then each element most significant
+   byte first. elements must hold 1 to 2048 values. */
+inline std::vector<uint8_t> burst(unsigned op, uint32_t address,
+                                  const std::vector<uint32_t>& elements)
+{
+    uint32_t header = (uint32_t(op) << 28) | ((address & 0x1FFFF) << 11) |
+                      uint32_t(elements.size() - 1);
+    std::vector<uint8_t> bytes = {uint8_t(header >> 24), uint8_t(header >> 16),
+                                  uint8_t(header >> 8), uint8_t(header)};
+    for (uint32_t e : elements)
+        for (unsigned i = element_bytes(op); i-- > 0;)
+            bytes.push_back(uint8_t(e >> (8 * i)));
+    return bytes;
+}
+
+/*
+ * SpiBurstSlave
+ *
+ * spi_burst_slave: push is a function of the registers, and command
+ * of the registers and the bit on serial_input, as in the RTL.
+ */
+struct SpiBurstSlave {
+    unsigned bit_count = 0, shift = 0, byte_index = 0;
+    bool     in_header = true;
+    uint32_t partial = 0, address = 0, remaining = 0;
+    unsigned op = 0;
+
+    unsigned byte_in(bool bit) const { return ((shift << 1) | bit) & 0xFF; }
+    bool     byte_done() const { return bit_count == 7; }
+    bool     push() const
+    {
+        return byte_done() && !in_header && byte_index == element_bytes(op) - 1;
+    }
+    uint32_t command(bool bit) const
+    {
+        return burst_command(op, address, ((partial << 8) | byte_in(bit)) & 0xFFFFFF);
+    }
+
+    void fsync_low()
+    {
+        bit_count  = 0;
+        in_header  = true;
+        byte_index = 0;
+    }
+
+    void clock(bool bit)
+    {
+        unsigned in = byte_in(bit);
+        bool element_done = push();
+        if (byte_done() && in_header) {
+            if (byte_index == 3) {
+                uint32_t header = ((partial & 0xFFFFFF) << 8) | in;
+                op         = header >> 28;
+                address    = (header >> 11) & 0x1FFFF;
+                remaining  = header & 0x7FF;
+                partial    = 0;
+                in_header  = false;
+                byte_index = 0;
+            } else {
+                partial    = ((partial << 8) | in) & 0xFFFFFF;
+                byte_index = byte_index + 1;
+            }
+        } else if (element_done) {
+            address    = (address + 1) & 0x1FFFF;
+            in_header  = remaining == 0;
+            remaining  = (remaining - 1) & 0x7FF;
+            partial    = 0;
+            byte_index = 0;
+        } else if (byte_done()) {
+            partial    = ((partial << 8) | in) & 0xFFFFFF;
+            byte_index = (byte_index + 1) & 3;
+        }
+        shift     = in & 0x7F;
+        bit_count = (bit_count + 1) & 7;
+    }
+};
+
+inline uint32_t gray(uint32_t binary) { return binary ^ (binary >> 1); }
+
+/*
+ * AsyncFifo
+ *
+ * async_fifo: Gray coded pointers, each crossing through two
+ * registers into the other clock domain.
+ */
+struct AsyncFifo {
+    explicit AsyncFifo(unsigned addr_bits)
+        : bits(addr_bits), mask((2u << addr_bits) - 1), ram(size_t(1) << addr_bits)
+    {
+    }
+
+    unsigned              bits, mask;
+    std::vector<uint32_t> ram;
+    uint32_t wbin = 0, wgray = 0, rbin = 0, rgray = 0;
+    uint32_t wgray_r1 = 0, wgray_r2 = 0, rgray_w1 = 0, rgray_w2 = 0;
+
+    bool full() const
+    {
+        uint32_t top = 3u << (bits - 1);
+        return wgray == ((rgray_w2 ^ top) & mask);
+    }
+    bool     empty() const { return rgray == wgray_r2; }
+    uint32_t rdata() const { return ram[rbin & ((1u << bits) - 1)]; }
+
+    void write_clock(bool push, uint32_t wdata)
+    {
+        bool     write = push && !full();
+        uint32_t next  = (wbin + write) & mask;
+        if (write)
+            ram[wbin & ((1u << bits) - 1)] = wdata;
+        rgray_w2 = rgray_w1;
+        rgray_w1 = rgray;
+        wbin  = next;
+        wgray = gray(next);
+    }
+
+    void read_clock(bool pop)
+    {
+        uint32_t next = (rbin + (pop && !empty())) & mask;
+        wgray_r2 = wgray_r1;
+        wgray_r1 = wgray;
+        rbin  = next;
+        rgray = gray(next);
+    }
+};
+
+/*
+ * SpiCommandPort
+ *
+ * spi_command_port: the burst decoder feeding the FIFO on spi_clk,
+ * the command register and the Gray coded dropped count on clk.
+ */
+struct SpiCommandPort {
+    explicit SpiCommandPort(unsigned fifo_addr_bits = 4) : fifo(fifo_addr_bits) {}
+
+    SpiBurstSlave slave;
+    AsyncFifo     fifo;
+    uint32_t      command = 0;
+    bool          command_valid = false;
+    uint32_t      dropped_bin = 0, dropped_gray = 0;
+    uint32_t      dropped_gray_1 = 0, dropped_gray_2 = 0;
+
+    uint32_t dropped() const
+    {
+        uint32_t binary = 0;
+        for (int i = 15; i >= 0; --i)
+            binary |= (((binary >> (i + 1)) ^ (dropped_gray_2 >> i)) & 1) << i;
+        return binary;
+    }
+
+    void fsync_low() { slave.fsync_low(); }
+
+    void spi_clock(bool bit)
+    {
+        bool push = slave.push();
+        if (push && fifo.full()) {
+            dropped_bin  = (dropped_bin + 1) & 0xFFFF;
+            dropped_gray = gray(dropped_bin);
+        }
+        fifo.write_clock(push, slave.command(bit));
+        slave.clock(bit);
+    }
+
+    void clock()
+    {
+        command        = fifo.rdata();
+        command_valid  = !fifo.empty();
+        dropped_gray_2 = dropped_gray_1;
+        dropped_gray_1 = dropped_gray;
+        fifo.read_clock(!fifo.empty());
+    }
+};
+
+/*
+ * SpiLink
+ *
+ * A PIC sending frames to a SpiCommandPort: fsync rises, each byte
+ * is sent most significant bit first with the bit set up half a
+ * period before the rising edge, byte_gap idle periods follow each
+ * byte, and fsync falls for frame_gap_ps between frames. pixel_clock
+ * is called for every vgaclk edge, before the port is clocked, so it
+ * sees command and command_valid as registered at the edge before.
+ */
+class SpiLink {
+public:
+    SpiLink(SpiCommandPort& port, double spi_hz, double pixel_hz,
+            std::function<void()> pixel_clock)
+        : port_(port), spi_ps_(uint64_t(1e12 / spi_hz + 0.5)),
+          pixel_ps_(uint64_t(1e12 / pixel_hz + 0.5)),
+          pixel_clock_(std::move(pixel_clock))
+    {
+    }
+
+    unsigned byte_gap = 0;
+    uint64_t frame_gap_ps = 1000000;
+
+    uint64_t now_ps() const { return now_; }
+    uint64_t spi_clocks() const { return spi_clocks_; }
+
+    /* Runs the pixel clock until time. */
+    void advance_to(uint64_t time)
+    {
+        while (next_pixel_ <= time) {
+            now_ = next_pixel_;
+            pixel_clock_();
+            port_.clock();
+            next_pixel_ += pixel_ps_;
+        }
+        now_ = time;
+    }
+
+    void send_frame(const std::vector<uint8_t>& bytes)
+    {
+        for (uint8_t byte : bytes) {
+            for (int i = 7; i >= 0; --i) {
+                advance_to(now_ + spi_ps_ / 2);
+                port_.spi_clock((byte >> i) & 1);
+                ++spi_clocks_;
+                advance_to(now_ + spi_ps_ - spi_ps_ / 2);
+            }
+            advance_to(now_ + uint64_t(byte_gap) * spi_ps_);
+        }
+        port_.fsync_low();
+        advance_to(now_ + frame_gap_ps);
+    }
+
+private:
+    SpiCommandPort&       port_;
+    uint64_t              spi_ps_, pixel_ps_;
+    std::function<void()> pixel_clock_;
+    uint64_t              now_ = 0, next_pixel_ = 0, spi_clocks_ = 0;
+};
+
+}  // namespace vga_sim
+
+#endif
@@ -0,0 +1,142 @@
+/*      spi_throughput.cpp
+        Sustained throughput of the burst SPI command port, on the
+        spi_model.h models of spi_burst.sv.
+
+        Build: g++ -std=c++17 -O2 -o spi_throughput spi_throughput.cpp
+        Usage: spi_throughput [spi_hz]
+
+        At spi_hz (default 10 MHz, within what a PIC SPI master runs)
+        and a 25.175 MHz vgaclk, random elements are sent for 50 ms to
+        each kind of write target: the cursor (OP_MOUSE), the palette,
+        framebuffer pixels, and text cells. Each is sent once as bursts
+        of 2048 elements in long frames, and once as one element per
+        frame, as the old one word per frame protocol did, with 2 us of
+        fsync low between frames. Every command the port produces must
+        match, in order, the command burst_command gives for its
+        element. Reported are the element bytes and commands per second
+        actually delivered, against the 1 byte per 8 SPI clocks the
+        link carries.
+
+        The last run sends pixels with vgaclk at a sixteenth of the
+        SPI clock, so elements arrive twice as fast as the FIFO is
+        emptied: the commands delivered must then be the ones sent, in
+        order, with gaps, and dropped must count exactly the commands
+        missing. */
+
+#include "spi_model.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+using namespace vga_sim;
+
+namespace {
+
+struct Target {
+    const char* name;
+    unsigned    op;
+    uint32_t    address_limit;
+};
+
+struct Result {
+    uint64_t sent = 0, received = 0, bytes = 0;
+    double   seconds = 0;
+    uint32_t dropped = 0;
+    bool     in_order = true;
+};
+
+Result run(const Target& target, double spi_hz, double pixel_hz, unsigned per_frame,
+           double duration_s, unsigned seed)
+{
+    std::mt19937 rng(seed);
+    SpiCommandPort port;
+    std::vector<uint32_t> expected, received;
+    SpiLink link(port, spi_hz, pixel_hz, [&]() {
+        if (port.command_valid)
+            received.push_back(port.command);
+    });
+    link.frame_gap_ps = 2000000;
+
+    Result r;
+    uint32_t mask = element_bytes(target.op) == 3 ? 0xFFFFFF
+                  : element_bytes(target.op) == 2 ? 0xFFFF : 0xFF;
+    uint64_t end_ps = uint64_t(duration_s * 1e12);
+    while (link.now_ps() < end_ps) {
+        std::vector<uint8_t> frame;
+        for (unsigned sent = 0; sent < per_frame;) {
+            unsigned n = std::min(2048u, per_frame - sent);
+            uint32_t address = uint32_t(rng() % (target.address_limit - n + 1));
+            std::vector<uint32_t> elements(n);
+            for (unsigned i = 0; i < n; ++i) {
+                elements[i] = rng() & mask;
+                expected.push_back(burst_command(target.op, address + i, elements[i]));
+            }
+            std::vector<uint8_t> b = burst(target.op, address, elements);
+            frame.insert(frame.end(), b.begin(), b.end());
+            r.bytes += n * element_bytes(target.op);
+            sent += n;
+        }
+        link.send_frame(frame);
+    }
+    // let the FIFO and the dropped count settle
+    link.advance_to(link.now_ps() + uint64_t(64e12 / pixel_hz));
+    r.seconds = link.now_ps() * 1e-12;
+    r.sent     = expected.size();
+    r.received = received.size();
+    r.dropped  = port.dropped();
+
+    // received must be expected with some commands left out
+    size_t j = 0;
+    for (uint32_t c : received) {
+        while (j < expected.size() && expected[j] != c)
+            ++j;
+        if (j == expected.size()) {
+            r.in_order = false;
+            break;
+        }
+        ++j;
+    }
+    return r;
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    double spi_hz = argc > 1 ? std::atof(argv[1]) : 10e6;
+    const double PIXEL_HZ = 25.175e6;
+
+    const Target targets[] = {
+        {"cursor   OP_MOUSE",   OP_MOUSE,   0x1FFFF},
+        {"palette  OP_PALETTE", OP_PALETTE, 1024},
+        {"pixels   OP_PIXEL",   OP_PIXEL,   76800},
+        {"text     OP_TEXT",    OP_TEXT,    2400},
+    };
+
+    std::printf("SPI %.1f MHz, link %.0f kB/s; vgaclk %.3f MHz\n", spi_hz / 1e6,
+                spi_hz / 8 / 1e3, PIXEL_HZ / 1e6);
+    int failures = 0;
+    unsigned seed = 36;
+    for (const Target& t : targets)
+        for (unsigned per_frame : {65536u, 1u}) {
+            Result r = run(t, spi_hz, PIXEL_HZ, per_frame, 0.05, seed++);
+            bool ok = r.in_order && r.received == r.sent && r.dropped == 0;
+            std::printf("  %-20s %s: %7.0f bytes/s, %7.0f commands/s, "
+                        "%5.1f%% of the link: %s\n", t.name,
+                        per_frame == 1 ? "1 per frame " : "2048 a burst",
+                        r.bytes / r.seconds, r.received / r.seconds,
+                        100.0 * r.bytes / r.seconds / (spi_hz / 8), ok ? "ok" : "FAIL");
+            failures += !ok;
+        }
+
+    // overrun: an element every 8 SPI clocks, a command every 16
+    Result r = run(targets[2], spi_hz, spi_hz / 16, 65536, 0.05, seed++);
+    bool ok = r.in_order && r.received < r.sent && r.dropped == r.sent - r.received;
+    std::printf("  overrun, vgaclk %.3f MHz: %llu sent, %llu delivered in order, "
+                "dropped %u: %s\n", spi_hz / 16 / 1e6, (unsigned long long)r.sent,
+                (unsigned long long)r.received, r.dropped, ok ? "ok" : "FAIL");
+    failures += !ok;
+    return failures ? 1 : 0;
+}
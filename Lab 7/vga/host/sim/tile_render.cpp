@@ -0,0 +1,284 @@
+/*      tile_render.cpp
+        Render check of the tile map layer, tilemap.sv, at the edges of
+        its scroll range.
+
+        Build: g++ -std=c++17 -O2 -o tile_render tile_render.cpp
+        Usage: tile_render [out_prefix]
+
+        Tilemap below models tilemap.sv register by register: the
+        write side, the scroll taken at the frame pulse, and the three
+        read stages, so in_tile and rgb for x, y come out 3 clocks
+        later. A random map, random patterns with some transparent
+        pixels and a random palette are written with OP_TILE and
+        OP_TILE_CONTROL commands. Then, for each x scroll of 0, 1, 7,
+        8, 639, 640, 641, 1016 and 1023 with each y scroll of 0, 1,
+        479, 480, 481, 959, 960 and 1023, the scroll is written
+        halfway through a frame, and the rest of that frame must still
+        show the old scroll. The next whole frame, with x and y as
+        videoGen passes them (y one line ahead) from the 640x480
+        vgaController model, must match a plain C++ drawing of the map
+        scrolled by the written values modulo 640 and 480, on every
+        pixel. The same frames are also drawn by the model without the
+        reduction of the scroll on write, as tilemap.sv was before,
+        and its differing pixels are counted for comparison.
+
+        With out_prefix, the frame at each scroll is written as
+        out_prefix_<x>_<y>.png. */
+
+#include "image_io.h"
+#include "spi_model.h"
+#include "vga_sim.h"
+
+#include <cstdio>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace vga_sim;
+
+namespace {
+
+const unsigned COLUMNS = 80;
+const unsigned ROWS    = 60;
+const unsigned CELLS   = COLUMNS * ROWS;
+
+/*
+ * Tilemap
+ *
+ * tilemap.sv. reduce_on_write false models the scroll registers as
+ * they were, taking the written value as it is.
+ */
+struct Tilemap {
+    explicit Tilemap(bool reduce) : reduce_on_write(reduce) {}
+
+    bool                  reduce_on_write;
+    std::vector<uint8_t>  map = std::vector<uint8_t>(CELLS, 0);
+    std::vector<uint8_t>  patterns = std::vector<uint8_t>(8192, 0);
+    uint16_t              palette[16] = {};
+    bool                  enabled = false;
+    unsigned              scroll_x = 0, scroll_y = 0, next_scroll_x = 0, next_scroll_y = 0;
+    unsigned              map_addr = 0, fine_x_1 = 0, fine_y_1 = 0, tile = 0;
+    unsigned              fine_x_2 = 0, fine_y_2 = 0, pair = 0;
+    bool                  in_1 = false, in_2 = false, in_3 = false, right_3 = false;
+
+    unsigned color() const { return right_3 ? pair & 15 : pair >> 4; }
+    bool     in_tile() const { return enabled && in_3 && color() != 0; }
+    uint32_t rgb() const
+    {
+        unsigned p = palette[color()];
+        return ((p >> 8 & 15) * 0x11) << 16 | ((p >> 4 & 15) * 0x11) << 8 | (p & 15) * 0x11;
+    }
+
+    void clock(bool frame, uint32_t command, bool command_valid, unsigned x, unsigned y)
+    {
+        // stage 3, 2 and 1, from the registers before the edge
+        pair    = patterns[(tile << 5) | (fine_y_2 << 2) | (fine_x_2 >> 1)];
+        right_3 = fine_x_2 & 1;
+        in_3    = in_2;
+        // cells past the map are never shown; read them as 0
+        tile     = map_addr < CELLS ? map[map_addr] : 0;
+        fine_x_2 = fine_x_1;
+        fine_y_2 = fine_y_1;
+        in_2     = in_1;
+        unsigned map_x = ((x & 0x3FF) + scroll_x) & 0x7FF;
+        unsigned map_y = ((y & 0x3FF) + scroll_y) & 0x7FF;
+        if (map_x >= 8 * COLUMNS)
+            map_x = map_x - 8 * COLUMNS;
+        if (map_y >= 8 * ROWS)
+            map_y = map_y - 8 * ROWS;
+        map_addr = (((map_y >> 3) & 0x3F) * 80 + ((map_x >> 3) & 0x7F)) & 0x1FFF;
+        fine_x_1 = map_x & 7;
+        fine_y_1 = map_y & 7;
+        in_1     = x < 8 * COLUMNS && y < 8 * ROWS;
+
+        // write side
+        if (command_valid && opcode(command) == OP_TILE) {
+            unsigned address = (command >> 8) & 0x1FFF;
+            if (command & (1u << 21))
+                patterns[address] = uint8_t(command);
+            else if (address < CELLS)
+                map[address] = uint8_t(command);
+        }
+        if (frame) {
+            scroll_x = next_scroll_x;
+            scroll_y = next_scroll_y;
+        }
+        if (command_valid && opcode(command) == OP_TILE_CONTROL) {
+            unsigned value = command & 0x3FF;
+            switch ((command >> 24) & 15) {
+            case 0:
+                next_scroll_x = !reduce_on_write ? value : value >= 640 ? value - 640 : value;
+                break;
+            case 1:
+                next_scroll_y = !reduce_on_write ? value : value >= 960 ? value - 960
+                                                 : value >= 480 ? value - 480 : value;
+                break;
+            case 2:
+                enabled = command & 1;
+                break;
+            case 3:
+                palette[(command >> 12) & 15] = command & 0xFFF;
+                break;
+            }
+        }
+    }
+};
+
+/* The tile layer at x, y of the screen, scrolled by sx, sy: 0 where
+   it is transparent, else the color with bit 24 set. */
+uint32_t reference_pixel(const Tilemap& written, unsigned sx, unsigned sy,
+                         unsigned x, unsigned y)
+{
+    unsigned mx = (x + sx % 640) % 640, my = (y + sy % 480) % 480;
+    unsigned tile = written.map[(my / 8) * COLUMNS + mx / 8];
+    unsigned pair = written.patterns[tile * 32 + (my % 8) * 4 + (mx % 8) / 2];
+    unsigned color = mx % 2 ? pair & 15 : pair >> 4;
+    if (color == 0)
+        return 0;
+    unsigned p = written.palette[color];
+    return 1u << 24 | ((p >> 8 & 15) * 0x11) << 16 | ((p >> 4 & 15) * 0x11) << 8 |
+           (p & 15) * 0x11;
+}
+
+/*
+ * Screen
+ *
+ * The model driven from the 640x480 vgaController, x and y + 1 as
+ * videoGen passes them, with the frame pulse at the end of vsync.
+ */
+struct Screen {
+    explicit Screen(bool reduce)
+        : tiles(reduce),
+          controller(Timing{"640X480_60", 0, 640, 16, 96, 48, 480, 10, 2, 33, false,
+                            false, 25175}, 5)
+    {
+    }
+
+    Tilemap       tiles;
+    VgaController controller;
+    bool          old_vsync = true;
+    unsigned      x_in[4] = {}, y_in[4] = {};
+    uint64_t      clocks = 0;
+
+    /* One clock; calls out(x, y, pixel) for the pixel that leaves the
+       read stages at this edge. */
+    template <class Out>
+    bool clock(uint32_t command, bool command_valid, Out out)
+    {
+        bool vsync = controller.vsync();
+        bool frame = vsync && !old_vsync;
+        old_vsync  = vsync;
+        unsigned x = controller.x(), y = (controller.y() + 1) & 0x7FF;
+        if (clocks >= 3) {
+            unsigned at = (clocks - 3) % 4;
+            if (tiles.in_3)
+                out(x_in[at], y_in[at], tiles.in_tile() ? 1u << 24 | tiles.rgb() : 0u);
+        }
+        x_in[clocks % 4] = x;
+        y_in[clocks % 4] = y;
+        tiles.clock(frame, command, command_valid, x, y);
+        controller.clock();
+        ++clocks;
+        return frame;
+    }
+
+    void command(uint32_t c)
+    {
+        clock(c, true, [](unsigned, unsigned, uint32_t) {});
+    }
+
+    /* Runs to the next frame pulse, calling out for every pixel. */
+    template <class Out>
+    void to_frame(Out out)
+    {
+        while (!clock(0, false, out))
+            ;
+    }
+};
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    std::string prefix = argc > 1 ? argv[1] : "";
+    std::mt19937 rng(46);
+    std::vector<uint32_t> setup;
+    for (unsigned cell = 0; cell < CELLS; ++cell)
+        setup.push_back(burst_command(OP_TILE, cell, rng() & 0xFF));
+    for (unsigned i = 0; i < 8192; ++i) {
+        // about one pixel in eight transparent
+        unsigned left = rng() % 8 ? 1 + rng() % 15 : 0, right = rng() % 8 ? 1 + rng() % 15 : 0;
+        setup.push_back(burst_command(OP_TILE, 8192 + i, left << 4 | right));
+    }
+    for (unsigned i = 1; i < 16; ++i)
+        setup.push_back(burst_command(OP_TILE_CONTROL, 3, i << 12 | (rng() & 0xFFF)));
+    setup.push_back(burst_command(OP_TILE_CONTROL, 2, 1));
+
+    Screen screen(true), old_screen(false);
+    for (uint32_t c : setup) {
+        screen.command(c);
+        old_screen.command(c);
+    }
+    auto ignore = [](unsigned, unsigned, uint32_t) {};
+    screen.to_frame(ignore);
+    old_screen.to_frame(ignore);
+
+    const unsigned xs[] = {0, 1, 7, 8, 639, 640, 641, 1016, 1023};
+    const unsigned ys[] = {0, 1, 479, 480, 481, 959, 960, 1023};
+    unsigned shown_x = 0, shown_y = 0;
+    uint64_t errors = 0, stale = 0, pixels = 0, old_errors = 0;
+    int failures = 0;
+    for (unsigned sx : xs)
+        for (unsigned sy : ys) {
+            std::vector<uint32_t> image(640 * 480, 0);
+            // write the scroll halfway down the frame; the rest of it
+            // must show the scroll before
+            auto before = [&](unsigned x, unsigned y, uint32_t pixel) {
+                if (pixel != reference_pixel(screen.tiles, shown_x, shown_y, x, y))
+                    ++stale;
+            };
+            while (screen.controller.vcnt != 300)
+                screen.clock(0, false, before);
+            screen.command(burst_command(OP_TILE_CONTROL, 0, sx));
+            screen.command(burst_command(OP_TILE_CONTROL, 1, sy));
+            screen.to_frame(before);
+            old_screen.command(burst_command(OP_TILE_CONTROL, 0, sx));
+            old_screen.command(burst_command(OP_TILE_CONTROL, 1, sy));
+            old_screen.to_frame(ignore);
+            uint64_t frame_errors = 0;
+            screen.to_frame([&](unsigned x, unsigned y, uint32_t pixel) {
+                ++pixels;
+                image[y * 640 + x] = pixel & 0xFFFFFF;
+                if (pixel != reference_pixel(screen.tiles, sx, sy, x, y))
+                    ++frame_errors;
+            });
+            old_screen.to_frame([&](unsigned x, unsigned y, uint32_t pixel) {
+                if (pixel != reference_pixel(old_screen.tiles, sx, sy, x, y))
+                    ++old_errors;
+            });
+            if (frame_errors) {
+                std::printf("  scroll %u, %u: %llu pixels differ\n", sx, sy,
+                            (unsigned long long)frame_errors);
+                ++failures;
+            }
+            errors += frame_errors;
+            shown_x = sx;
+            shown_y = sy;
+            if (!prefix.empty()) {
+                std::string path = prefix + "_" + std::to_string(sx) + "_" +
+                                   std::to_string(sy) + ".png";
+                if (!image_io::write_png(path, image.data(), 640, 480)) {
+                    std::printf("cannot write %s\n", path.c_str());
+                    return 1;
+                }
+            }
+        }
+    std::printf("%zu scroll positions, %llu pixels against plain C++: %llu differ, "
+                "%llu differ before the frame pulse: %s\n", std::size(xs) * std::size(ys),
+                (unsigned long long)pixels, (unsigned long long)errors,
+                (unsigned long long)stale, errors || stale ? "FAIL" : "ok");
+    std::printf("without the reduction on write: %llu pixels differ\n",
+                (unsigned long long)old_errors);
+    return failures || stale ? 1 : 0;
+}
@@ -0,0 +1,315 @@
+/*      unpack_check.cpp
+        Cycle model and check of the packed image decoder,
+        pixel_unpacker in unpacker.sv, with streams sent back to back.
+
+        Build: g++ -std=c++17 -O2 -o unpack_check unpack_check.cpp
+        Usage: unpack_check [streams]
+
+        Unpacker below models pixel_unpacker register by register, its
+        queue as the spi_model.h AsyncFifo with both sides on vgaclk.
+        streams random streams (default 2000) are pushed one byte at a
+        time, 1 to 24 clocks apart and never into a full queue, with
+        write_ready low on about one clock in eight as when OP_PIXEL
+        takes the write port. Each stream starts at a random pixel
+        address, some past the end of the framebuffer, and holds random
+        literals, runs and copies from its own output; most end in a
+        long run or copy, so the next stream's first byte often reaches
+        the head of the queue while it is still being written.
+
+        Once the last stream is done, the framebuffer must match the
+        streams decoded one after the other in plain C++, no pixel may
+        be written while busy is low, and no byte may be dropped. The
+        same is run with a new stream starting as soon as its first
+        byte is at the head of the queue, as unpacker.sv did before, and
+        the pixels that differ are counted for comparison. */
+
+#include "spi_model.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+using namespace vga_sim;
+
+namespace {
+
+const unsigned FB_PIXELS = 320 * 240;
+const unsigned WINDOW    = 4096;
+
+typedef std::vector<uint8_t> Bytes;
+
+/*
+ * Unpacker
+ *
+ * pixel_unpacker. The outputs are functions of the registers, the
+ * queue head and write_ready; clock() applies one vgaclk edge.
+ * restart_in_writes true starts a new stream in any state, as
+ * before.
+ */
+struct Unpacker {
+    enum State { ADDRESS_0, ADDRESS_1, ADDRESS_2, TOKEN, LITERAL, RUN_VALUE, RUN,
+                 DISTANCE_0, DISTANCE_1, COPY_READ, COPY_WRITE };
+
+    explicit Unpacker(bool restart_in_writes) : old_restart(restart_in_writes) {}
+
+    bool      old_restart;
+    AsyncFifo queue = AsyncFifo(6);
+    unsigned  pushed = 0;
+    State     state = ADDRESS_0;
+    unsigned  pixel = 0, count = 0, value = 0, distance = 0, position = 0;
+    uint8_t   window[WINDOW] = {}, window_q = 0;
+
+    bool     empty() const { return queue.empty(); }
+    bool     first() const { return (queue.rdata() >> 8) & 1; }
+    unsigned data() const { return queue.rdata() & 0xFF; }
+    bool     writing() const { return state == RUN || state == COPY_READ || state == COPY_WRITE; }
+    bool     needs_byte() const
+    {
+        return state == ADDRESS_0 || state == ADDRESS_1 || state == ADDRESS_2 ||
+               state == TOKEN || state == RUN_VALUE || state == DISTANCE_0 ||
+               state == DISTANCE_1;
+    }
+    bool produce(unsigned& color) const
+    {
+        color = value;
+        if (state == LITERAL) {
+            color = data();
+            return !empty() && !first();
+        }
+        if (state == COPY_WRITE)
+            color = window_q;
+        return state == RUN || state == COPY_WRITE;
+    }
+    bool write(unsigned& address, unsigned& color) const
+    {
+        address = pixel;
+        return produce(color) && pixel < FB_PIXELS;
+    }
+    bool busy(bool push) const { return !empty() || push || pushed || writing(); }
+
+    void clock(bool push, uint32_t entry, bool write_ready)
+    {
+        unsigned color, address;
+        bool     produced = produce(color);
+        bool     taken    = produced && (!write(address, color) || write_ready);
+        bool     restart  = !empty() && first() && (old_restart || !writing());
+        bool     pop      = !empty() && (first() ? old_restart || !writing()
+                                                 : needs_byte() || (state == LITERAL && taken));
+        unsigned d        = data();
+        State    next     = state;
+
+        window_q = window[(position - distance - 1) & (WINDOW - 1)];
+        if (taken) {
+            window[position] = uint8_t(color);
+            position = (position + 1) & (WINDOW - 1);
+            pixel    = (pixel + 1) & 0x1FFFF;
+        }
+        if (restart) {
+            pixel = (pixel & 0xFFFF) | (d & 1) << 16;
+            next  = ADDRESS_1;
+        } else
+            switch (state) {
+            case ADDRESS_0:
+                if (!empty()) {
+                    pixel = (pixel & 0xFFFF) | (d & 1) << 16;
+                    next  = ADDRESS_1;
+                }
+                break;
+            case ADDRESS_1:
+                if (!empty()) {
+                    pixel = (pixel & 0x100FF) | d << 8;
+                    next  = ADDRESS_2;
+                }
+                break;
+            case ADDRESS_2:
+                if (!empty()) {
+                    pixel = (pixel & 0x1FF00) | d;
+                    next  = TOKEN;
+                }
+                break;
+            case TOKEN:
+                if (!empty()) {
+                    count = d & 0x7F;
+                    next  = !(d & 0x80) ? LITERAL : !(d & 0x40) ? RUN_VALUE : DISTANCE_0;
+                    if (d & 0x80)
+                        count = (d & 0x3F) + 2;
+                }
+                break;
+            case LITERAL: case RUN:
+                if (taken) {
+                    if (count == 0)
+                        next = TOKEN;
+                    count = (count - 1) & 0x7F;
+                }
+                break;
+            case RUN_VALUE:
+                if (!empty()) {
+                    value = d;
+                    next  = RUN;
+                }
+                break;
+            case DISTANCE_0:
+                if (!empty()) {
+                    distance = (distance & 0xFF) | (d & 15) << 8;
+                    next     = DISTANCE_1;
+                }
+                break;
+            case DISTANCE_1:
+                if (!empty()) {
+                    distance = (distance & 0xF00) | d;
+                    next     = COPY_READ;
+                }
+                break;
+            case COPY_READ:
+                next = COPY_WRITE;
+                break;
+            case COPY_WRITE:
+                if (taken) {
+                    next  = count == 0 ? TOKEN : COPY_READ;
+                    count = (count - 1) & 0x7F;
+                }
+                break;
+            }
+        state  = next;
+        pushed = ((pushed << 1) | push) & 3;
+        queue.write_clock(push, entry);
+        queue.read_clock(pop);
+    }
+};
+
+/* A random stream: the address, then literals, runs and copies from
+   its own output, most ending in a long run or copy. */
+Bytes random_stream(std::mt19937& rng)
+{
+    // a few start past the framebuffer, and their pixels are skipped
+    uint32_t start = rng() % 8 ? rng() % FB_PIXELS : FB_PIXELS - 200 + rng() % 400;
+    Bytes s = {uint8_t(start >> 16 & 1), uint8_t(start >> 8), uint8_t(start)};
+    unsigned produced = 0, tokens = 1 + rng() % 12;
+    for (unsigned t = 0; t < tokens; ++t) {
+        bool last = t + 1 == tokens && rng() % 4;
+        unsigned kind = last ? 1 + rng() % 2 : rng() % 3;
+        if (kind == 2 && produced == 0)
+            kind = 1;
+        if (kind == 0) {
+            unsigned n = 1 + rng() % 128;
+            s.push_back(uint8_t(n - 1));
+            for (unsigned i = 0; i < n; ++i)
+                s.push_back(uint8_t(rng()));
+            produced += n;
+        } else {
+            unsigned n = last ? 40 + rng() % 27 : 3 + rng() % 64;
+            if (kind == 1) {
+                s.push_back(uint8_t(0x80 | (n - 3)));
+                s.push_back(uint8_t(rng()));
+            } else {
+                unsigned d = 1 + rng() % std::min(produced, WINDOW);
+                s.push_back(uint8_t(0xC0 | (n - 3)));
+                s.push_back(uint8_t((d - 1) >> 8));
+                s.push_back(uint8_t(d - 1));
+            }
+            produced += n;
+        }
+    }
+    return s;
+}
+
+/* The streams decoded one after the other into a framebuffer. */
+void reference_decode(const std::vector<Bytes>& streams, Bytes& fb)
+{
+    for (const Bytes& s : streams) {
+        uint32_t pixel = (s[0] & 1u) << 16 | s[1] << 8 | s[2];
+        Bytes out;
+        for (size_t i = 3; i < s.size(); ) {
+            uint8_t token = s[i++];
+            if (!(token & 0x80)) {
+                for (unsigned n = 0; n <= token; ++n)
+                    out.push_back(s[i++]);
+            } else if (!(token & 0x40)) {
+                for (unsigned n = 0; n < (token & 0x3Fu) + 3; ++n)
+                    out.push_back(s[i]);
+                ++i;
+            } else {
+                size_t d = ((s[i] & 0xFu) << 8 | s[i + 1]) + 1;
+                i += 2;
+                for (unsigned n = 0; n < (token & 0x3Fu) + 3; ++n)
+                    out.push_back(out[out.size() - d]);
+            }
+        }
+        for (uint8_t p : out) {
+            if (pixel < FB_PIXELS)
+                fb[pixel] = p;
+            ++pixel;
+        }
+    }
+}
+
+struct Result {
+    uint64_t differ, busy_low_writes, dropped;
+};
+
+Result run(const std::vector<Bytes>& streams, const Bytes& expected, bool old_restart)
+{
+    Unpacker unpacker(old_restart);
+    Bytes fb(FB_PIXELS, 0);
+    std::mt19937 rng(48);
+    Result r = {0, 0, 0};
+    size_t stream = 0, offset = 0;
+    unsigned wait = 0, idle = 0;
+    while (idle < 1000) {
+        bool push = false;
+        uint32_t entry = 0;
+        if (stream < streams.size() && wait == 0 && !unpacker.queue.full()) {
+            push  = true;
+            entry = uint32_t(offset == 0) << 8 | streams[stream][offset];
+            if (++offset == streams[stream].size()) {
+                offset = 0;
+                ++stream;
+            }
+            wait = rng() % 24;
+        } else if (wait) {
+            --wait;
+        }
+        bool ready = rng() % 8 != 0;
+        bool busy  = unpacker.busy(push);
+        unsigned address, color;
+        bool write = unpacker.write(address, color);
+        if (write && ready) {
+            fb[address] = uint8_t(color);
+            r.busy_low_writes += !busy;
+        }
+        r.dropped += push && unpacker.queue.full();
+        unpacker.clock(push, entry, ready);
+        idle = stream == streams.size() && !busy ? idle + 1 : 0;
+    }
+    for (unsigned i = 0; i < FB_PIXELS; ++i)
+        r.differ += fb[i] != expected[i];
+    return r;
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    unsigned count = argc > 1 ? unsigned(std::atoi(argv[1])) : 2000;
+    std::mt19937 rng(48);
+    std::vector<Bytes> streams;
+    size_t bytes = 0;
+    for (unsigned i = 0; i < count; ++i) {
+        streams.push_back(random_stream(rng));
+        bytes += streams.back().size();
+    }
+    Bytes expected(FB_PIXELS, 0);
+    reference_decode(streams, expected);
+
+    Result now    = run(streams, expected, false);
+    Result before = run(streams, expected, true);
+    bool ok = now.differ == 0 && now.busy_low_writes == 0 && now.dropped == 0;
+    std::printf("%u streams, %zu bytes: %llu pixels differ, %llu written with busy low, "
+                "%llu bytes dropped: %s\n", count, bytes, (unsigned long long)now.differ,
+                (unsigned long long)now.busy_low_writes, (unsigned long long)now.dropped,
+                ok ? "ok" : "FAIL");
+    std::printf("with a new stream cutting off the run or copy before: %llu pixels differ\n",
+                (unsigned long long)before.differ);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,351 @@
+/*      vga_frames.cpp
+        Frame capture and sync timing harness for vgaController.
+
+        Build: g++ -std=c++17 -O2 -o vga_frames vga_frames.cpp ../video_model.cpp
+        Usage: vga_frames [frames] [out_prefix] [rtl_dir]
+
+        For every mode in vga_modes.sv (read from rtl_dir, default
+        ../..), clocks the vgaController model for frames full frames
+        (default 3) with the PIPE_DELAY of vga.sv, fed by a stand-in for
+        videoGen that gives the video_model pixel for x, y
+        VIDEO_LATENCY clocks later, as videoGen does. On the output
+        hsync, vsync and the display area it measures:
+          - the line period and hsync width, in clocks
+          - the display start and width within each line
+          - the frame period, vsync width and display lines, in lines,
+            and that vsync changes with the leading edge of hsync
+          - the sync polarities
+        and compares each with the VESA DMT and CEA-861 numbers written
+        out below, independently of vga_modes.sv. The r, g, b of every
+        displayed pixel are captured, checked against video_model, and
+        with out_prefix written as out_prefix<mode>_<n>.ppm and .png.
+        Simulated frames per wall-clock second are reported per mode.
+
+        Finally the 640x480 mode is run with the counters as they were
+        before the line and frame length fix (801 clocks per line and
+        526 lines per frame): the harness must report that as a timing
+        error, the first bug it would have caught. */
+
+#include "image_io.h"
+#include "vga_sim.h"
+#include "../video_model.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <regex>
+#include <string>
+#include <vector>
+
+using vga_sim::Timing;
+
+namespace {
+
+/* The published timings; names match the MODE_ localparams. */
+struct Standard {
+    const char* name;
+    unsigned    h_active, h_front, h_sync, h_back;
+    unsigned    v_active, v_front, v_sync, v_back;
+    bool        h_sync_high, v_sync_high;
+    double      pixel_mhz;
+};
+
+const Standard STANDARDS[] = {
+    // VESA DMT
+    {"640X480_60",  640,  16,  96,  48, 480, 10, 2, 33, false, false, 25.175},
+    {"800X600_60",  800,  40, 128,  88, 600,  1, 4, 23, true,  true,  40.000},
+    {"1024X768_60", 1024, 24, 136, 160, 768,  3, 6, 29, false, false, 65.000},
+    // CEA-861 720p60
+    {"1280X720_60", 1280, 110, 40, 220, 720,  5, 5, 20, true,  true,  74.250},
+};
+
+const Standard* find_standard(const std::string& name)
+{
+    for (const Standard& s : STANDARDS)
+        if (name == s.name)
+            return &s;
+    return nullptr;
+}
+
+/*
+ * TimingChecker
+ *
+ * Measures the output signals one clock at a time and compares each
+ * line and frame with a standard. Only whole lines and frames, after
+ * the first leading edges, are checked.
+ */
+class TimingChecker {
+public:
+    explicit TimingChecker(const Standard& s) : s_(s) {}
+
+    std::vector<std::string> errors;
+    unsigned                 error_count = 0;
+    unsigned                 lines_checked = 0, frames_checked = 0;
+
+    void clock(bool hsync, bool vsync, bool valid)
+    {
+        bool h_active = hsync == s_.h_sync_high;
+        bool v_active = vsync == s_.v_sync_high;
+        bool h_lead = h_active && !last_h_;
+        bool v_lead = v_active && !last_v_;
+
+        if (h_lead) {
+            if (line_start_ >= 0)
+                end_line();
+            line_start_  = int64_t(t_);
+            first_valid_ = -1;
+            valid_count_ = 0;
+            valid_runs_  = 0;
+            h_width_     = 0;
+            ++line_in_frame_;
+        }
+        if (v_lead) {
+            if (!h_lead)
+                error("vsync edge %llu clocks into a line, not with hsync",
+                      (unsigned long long)(t_ - uint64_t(line_start_)));
+            if (frame_start_ >= 0)
+                end_frame();
+            frame_start_   = int64_t(t_);
+            line_in_frame_ = 0;
+            active_lines_  = 0;
+            first_active_  = -1;
+            v_width_       = 0;
+        }
+
+        if (h_active)
+            ++h_width_;
+        if (v_active)
+            ++v_width_;
+        if (valid) {
+            if (!last_valid_)
+                ++valid_runs_;
+            if (first_valid_ < 0 && line_start_ >= 0)
+                first_valid_ = int64_t(t_) - line_start_;
+            ++valid_count_;
+        }
+        last_h_ = h_active;
+        last_v_ = v_active;
+        last_valid_ = valid;
+        ++t_;
+    }
+
+private:
+    template <class... Args>
+    void error(const char* format, Args... args)
+    {
+        char text[160];
+        std::snprintf(text, sizeof text, format, args...);
+        if (errors.size() < 6)
+            errors.push_back(text);
+        ++error_count;
+    }
+
+    void end_line()
+    {
+        ++lines_checked;
+        unsigned h_total = s_.h_sync + s_.h_back + s_.h_active + s_.h_front;
+        uint64_t period  = t_ - uint64_t(line_start_);
+        if (period != h_total)
+            error("line period %llu clocks, expected %u", (unsigned long long)period, h_total);
+        if (h_width_ != s_.h_sync)
+            error("hsync %u clocks wide, expected %u", h_width_, s_.h_sync);
+        if (valid_count_ == 0)
+            return;
+        if (frame_start_ >= 0) {
+            if (first_active_ < 0)
+                first_active_ = int(line_in_frame_);
+            ++active_lines_;
+        }
+        if (first_valid_ != int64_t(s_.h_sync + s_.h_back))
+            error("display starts %lld clocks after hsync, expected %u",
+                  (long long)first_valid_, s_.h_sync + s_.h_back);
+        if (valid_count_ != s_.h_active || valid_runs_ != 1)
+            error("%u display clocks in %u runs, expected %u in 1", valid_count_,
+                  valid_runs_, s_.h_active);
+    }
+
+    void end_frame()
+    {
+        ++frames_checked;
+        unsigned h_total = s_.h_sync + s_.h_back + s_.h_active + s_.h_front;
+        unsigned v_total = s_.v_sync + s_.v_back + s_.v_active + s_.v_front;
+        if (line_in_frame_ != v_total)
+            error("frame of %u lines, expected %u", line_in_frame_, v_total);
+        if (v_width_ != uint64_t(s_.v_sync) * h_total)
+            error("vsync %.2f lines wide, expected %u", double(v_width_) / h_total, s_.v_sync);
+        if (active_lines_ != s_.v_active || first_active_ != int(s_.v_sync + s_.v_back))
+            error("%u display lines from line %d, expected %u from line %u",
+                  active_lines_, first_active_, s_.v_active, s_.v_sync + s_.v_back);
+    }
+
+    const Standard& s_;
+    uint64_t t_ = 0;
+    bool     last_h_ = false, last_v_ = false, last_valid_ = false;
+    int64_t  line_start_ = -1, frame_start_ = -1, first_valid_ = -1;
+    unsigned valid_count_ = 0, valid_runs_ = 0, h_width_ = 0;
+    unsigned line_in_frame_ = 0, active_lines_ = 0;
+    int      first_active_ = -1;
+    uint64_t v_width_ = 0;
+};
+
+/* Reads a localparam such as VIDEO_LATENCY from vga.sv. */
+int read_localparam(const std::string& text, const std::string& name)
+{
+    std::smatch m;
+    if (!std::regex_search(text, m, std::regex("localparam\\s+" + name + "\\s*=\\s*(\\d+)")))
+        return -1;
+    return std::stoi(m[1]);
+}
+
+struct Result {
+    unsigned frames_captured = 0;
+    size_t   pixel_mismatches = 0;
+    double   frames_per_second = 0;
+};
+
+/*
+ * run_mode
+ *
+ * Clocks frames + 1 frames of a mode, so that frames whole frames are
+ * measured after the first vsync, capturing every displayed frame.
+ */
+Result run_mode(const Timing& t, const Standard& s, unsigned latency, unsigned frames,
+                bool legacy, TimingChecker& checker, const std::string& out_prefix)
+{
+    vga_sim::VgaController controller(t, latency, legacy);
+    std::vector<uint32_t> pipe(latency + 1, 0);
+    video_model::FrameState state = {0, uint16_t(t.h_active / 2), uint16_t(t.v_active / 2), 0};
+    std::vector<uint32_t> image(size_t(s.h_active) * s.v_active);
+    Result result;
+
+    bool     capturing = false, last_vsync = controller.vsync(), last_valid = false;
+    unsigned row = 0, column = 0;
+    uint16_t frame_counter = 0;
+    uint64_t cycles = uint64_t(frames + 1) * t.h_total() * t.v_total() + 2 * t.h_total();
+
+    auto start = std::chrono::steady_clock::now();
+    for (uint64_t c = 0; c < cycles; ++c) {
+        // the stand-in videoGen: the pixel for x, y appears latency
+        // clocks later, and the frame counter steps at the rising edge
+        // of vsync, as videoGen's frame pulse does
+        for (unsigned i = latency; i > 0; --i)
+            pipe[i] = pipe[i - 1];
+        pipe[0] = video_model::video_pixel(controller.x(), controller.y(), state);
+        uint32_t rgb = controller.rgb(pipe[latency]);
+        bool     vsync = controller.vsync(), valid = controller.valid();
+        checker.clock(controller.hsync(), vsync, valid);
+
+        bool v_lead = (vsync == s.v_sync_high) && (last_vsync != s.v_sync_high);
+        if (v_lead) {
+            if (capturing && row == s.v_active && result.frames_captured < frames) {
+                video_model::FrameState shown = state;
+                shown.counter = frame_counter;
+                for (unsigned y = 0; y < s.v_active; ++y)
+                    for (unsigned x = 0; x < s.h_active; ++x)
+                        if (image[size_t(y) * s.h_active + x] !=
+                            video_model::video_pixel(x, y, shown))
+                            ++result.pixel_mismatches;
+                if (!out_prefix.empty()) {
+                    char name[64];
+                    std::snprintf(name, sizeof name, "%s_%u", t.name.c_str(),
+                                  result.frames_captured);
+                    std::string base = out_prefix + name;
+                    image_io::write_ppm(base + ".ppm", image.data(), s.h_active, s.v_active);
+                    image_io::write_png(base + ".png", image.data(), s.h_active, s.v_active);
+                }
+                ++result.frames_captured;
+            }
+            capturing = true;
+            row = 0;
+        }
+        if (capturing && valid) {
+            if (!last_valid)
+                column = 0;
+            // the counter steps during vsync, so it is settled by the
+            // first displayed pixel
+            if (row == 0 && column == 0)
+                frame_counter = state.counter;
+            if (row < s.v_active && column < s.h_active)
+                image[size_t(row) * s.h_active + column] = rgb;
+            ++column;
+        } else if (capturing && last_valid) {
+            ++row;
+        }
+        if (vsync && !last_vsync)
+            state.counter = uint16_t((state.counter + 1) & 0x7FF);
+        last_vsync = vsync;
+        last_valid = valid;
+        controller.clock();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                                   start).count();
+    result.frames_per_second = double(cycles) / (double(t.h_total()) * t.v_total()) / seconds;
+    return result;
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    unsigned    frames     = argc > 1 ? unsigned(std::atoi(argv[1])) : 3;
+    std::string out_prefix = argc > 2 ? argv[2] : "";
+    std::string rtl_dir    = argc > 3 ? argv[3] : "../..";
+    if (frames == 0)
+        frames = 1;
+
+    std::vector<Timing> modes = vga_sim::read_modes(rtl_dir + "/vga_modes.sv");
+    int latency = read_localparam(vga_sim::read_file(rtl_dir + "/vga.sv"), "VIDEO_LATENCY");
+    if (modes.empty() || latency < 0) {
+        std::printf("cannot read the modes and VIDEO_LATENCY from %s\n", rtl_dir.c_str());
+        return 1;
+    }
+    std::printf("VIDEO_LATENCY %d, %u frames per mode\n\n", latency, frames);
+
+    int failures = 0;
+    for (const Timing& t : modes) {
+        const Standard* s = find_standard(t.name);
+        if (!s) {
+            std::printf("%s: no published timing to check against\n", t.name.c_str());
+            ++failures;
+            continue;
+        }
+        TimingChecker checker(*s);
+        Result r = run_mode(t, *s, unsigned(latency), frames, false, checker, out_prefix);
+        bool polarity_ok = t.h_sync_high == s->h_sync_high && t.v_sync_high == s->v_sync_high;
+        bool clock_ok    = t.pixel_khz == unsigned(s->pixel_mhz * 1000 + 0.5);
+        bool ok = checker.error_count == 0 && polarity_ok && clock_ok &&
+                  r.frames_captured == frames && r.pixel_mismatches == 0 &&
+                  checker.frames_checked >= frames;
+        std::printf("%-12s %ux%u, %.3f MHz, %.2f Hz: %u lines and %u frames checked, "
+                    "%u captured, %zu pixel mismatches, %.1f frames/s simulated: %s\n",
+                    t.name.c_str(), t.h_total(), t.v_total(), t.pixel_khz / 1000.0,
+                    t.refresh_hz(), checker.lines_checked, checker.frames_checked,
+                    r.frames_captured, r.pixel_mismatches, r.frames_per_second,
+                    ok ? "ok" : "FAIL");
+        if (!polarity_ok)
+            std::printf("    sync polarity differs from the standard\n");
+        if (!clock_ok)
+            std::printf("    pixel clock %u kHz, expected %.3f MHz\n", t.pixel_khz,
+                        s->pixel_mhz);
+        for (const std::string& e : checker.errors)
+            std::printf("    %s\n", e.c_str());
+        failures += !ok;
+    }
+
+    // the same check must catch the counters as they were before the
+    // line and frame length fix
+    const Timing* vga = nullptr;
+    for (const Timing& t : modes)
+        if (t.name == "640X480_60")
+            vga = &t;
+    if (vga) {
+        TimingChecker checker(*find_standard(vga->name));
+        run_mode(*vga, *find_standard(vga->name), unsigned(latency), 2, true, checker, "");
+        std::printf("\n640X480_60 with the counters before the fix: %u timing errors%s\n",
+                    checker.error_count, checker.error_count ? ", as expected" : ", NOT CAUGHT");
+        for (const std::string& e : checker.errors)
+            std::printf("    %s\n", e.c_str());
+        failures += checker.error_count == 0;
+    }
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,205 @@
+/*      vga_sim.h
+        Cycle models of the vga.sv display timing, for the harnesses in
+        this directory: the mode table of vga_modes.sv, read from the
+        RTL source, and vgaController.
+
+        The models follow the RTL split: outputs are functions of the
+        registers, and clock() computes the registers for the next
+        rising edge of vgaclk. */
+
+#ifndef VGA_SIM_H
+#define VGA_SIM_H
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <map>
+#include <regex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace vga_sim {
+
+/*
+ * Timing
+ *
+ * One entry of vga_modes::timing: widths in pixel clocks and lines,
+ * the sync polarities and the pixel clock.
+ */
+struct Timing {
+    std::string name;
+    unsigned    mode;
+    unsigned    h_active, h_front, h_sync, h_back;
+    unsigned    v_active, v_front, v_sync, v_back;
+    bool        h_sync_high, v_sync_high;
+    unsigned    pixel_khz;
+
+    unsigned h_total() const { return h_sync + h_back + h_active + h_front; }
+    unsigned v_total() const { return v_sync + v_back + v_active + v_front; }
+    double   refresh_hz() const
+    {
+        return pixel_khz * 1000.0 / (double(h_total()) * v_total());
+    }
+};
+
+inline std::string read_file(const std::string& path)
+{
+    std::ifstream in(path);
+    std::stringstream text;
+    text << in.rdbuf();
+    return text.str();
+}
+
+/* Reads a SystemVerilog number such as 25_175 or 1'b1. */
+inline unsigned sv_number(std::string text)
+{
+    std::string digits;
+    for (char ch : text)
+        if (ch != '_' && ch != ' ' && ch != '\n')
+            digits += ch;
+    size_t tick = digits.find('\'');
+    if (tick == std::string::npos)
+        return unsigned(std::stoul(digits));
+    char base = char(std::tolower(digits[tick + 1]));
+    return unsigned(std::stoul(digits.substr(tick + 2), nullptr,
+                               base == 'b' ? 2 : base == 'h' ? 16 : base == 'o' ? 8 : 10));
+}
+
+/*
+ * read_modes
+ *
+ * The modes of vga_modes.sv, in MODE number order, from the MODE_*
+ * localparams and the case items of the timing function. The default
+ * item belongs to whichever mode has no item of its own. Returns an
+ * empty list if the file does not parse.
+ */
+inline std::vector<Timing> read_modes(const std::string& path)
+{
+    std::string text = read_file(path);
+    std::map<std::string, unsigned> numbers;
+    std::regex mode_re(R"(localparam\s+int\s+(MODE_\w+)\s*=\s*(\d+)\s*;)");
+    for (std::sregex_iterator m(text.begin(), text.end(), mode_re), end; m != end; ++m)
+        numbers[(*m)[1]] = unsigned(std::stoul((*m)[2]));
+
+    std::vector<Timing> modes;
+    std::map<std::string, bool> has_item;
+    std::string default_values;
+    std::regex item_re(R"((MODE_\w+|default)\s*:\s*return\s*'\{([^}]*)\}\s*;)");
+    auto add = [&](const std::string& name, const std::string& values) {
+        std::vector<unsigned> v;
+        std::stringstream list(values);
+        std::string field;
+        while (std::getline(list, field, ','))
+            v.push_back(sv_number(field));
+        if (v.size() != 11)
+            return false;
+        Timing t;
+        t.name = name.substr(5);
+        t.mode = numbers[name];
+        t.h_active = v[0]; t.h_front = v[1]; t.h_sync = v[2]; t.h_back = v[3];
+        t.v_active = v[4]; t.v_front = v[5]; t.v_sync = v[6]; t.v_back = v[7];
+        t.h_sync_high = v[8]; t.v_sync_high = v[9];
+        t.pixel_khz = v[10];
+        modes.push_back(t);
+        return true;
+    };
+    for (std::sregex_iterator m(text.begin(), text.end(), item_re), end; m != end; ++m) {
+        if ((*m)[1] == "default") {
+            default_values = (*m)[2];
+        } else if (numbers.count((*m)[1])) {
+            has_item[(*m)[1]] = true;
+            if (!add((*m)[1], (*m)[2]))
+                return {};
+        }
+    }
+    for (const auto& n : numbers)
+        if (!has_item[n.first] && !default_values.empty())
+            if (!add(n.first, default_values))
+                return {};
+    std::sort(modes.begin(), modes.end(),
+              [](const Timing& a, const Timing& b) { return a.mode < b.mode; });
+    if (modes.size() != numbers.size())
+        return {};
+    return modes;
+}
+
+/*
+ * VgaController
+ *
+ * vgaController: the beam counters, x and y, the raw syncs and display
+ * area, and their PIPE_DELAY stage delay. legacy_counters restores the
+ * counters before the line and frame length fix, which wrapped one
+ * count late (801 clocks and 526 lines at 640x480).
+ */
+class VgaController {
+public:
+    VgaController(const Timing& t, unsigned pipe_delay, bool legacy_counters = false)
+        : t_(t), legacy_(legacy_counters),
+          hsync_pipe_(pipe_delay, false), vsync_pipe_(pipe_delay, false),
+          valid_pipe_(pipe_delay, false)
+    {
+    }
+
+    unsigned hcnt = 0, vcnt = 0;
+
+    unsigned hstart() const { return t_.h_sync + t_.h_back; }
+    unsigned vstart() const { return t_.v_sync + t_.v_back; }
+    unsigned x() const { return (hcnt - hstart()) & 0x7FF; }
+    unsigned y() const { return (vcnt - vstart()) & 0x7FF; }
+    bool     vblank() const
+    {
+        return vcnt < vstart() || vcnt >= vstart() + t_.v_active;
+    }
+
+    bool raw_hsync() const { return hcnt < t_.h_sync; }
+    bool raw_vsync() const { return vcnt < t_.v_sync; }
+    bool raw_valid() const
+    {
+        return hcnt >= hstart() && hcnt < hstart() + t_.h_active &&
+               vcnt >= vstart() && vcnt < vstart() + t_.v_active;
+    }
+
+    // after the PIPE_DELAY stages, and with the mode's polarity
+    bool in_hsync() const { return hsync_pipe_.empty() ? raw_hsync() : hsync_pipe_.back(); }
+    bool in_vsync() const { return vsync_pipe_.empty() ? raw_vsync() : vsync_pipe_.back(); }
+    bool valid() const { return valid_pipe_.empty() ? raw_valid() : valid_pipe_.back(); }
+    bool hsync() const { return t_.h_sync_high ? in_hsync() : !in_hsync(); }
+    bool vsync() const { return t_.v_sync_high ? in_vsync() : !in_vsync(); }
+    bool sync_b() const { return !(in_hsync() && in_vsync()); }
+    uint32_t rgb(uint32_t rgb_int) const { return valid() ? rgb_int & 0xFFFFFF : 0; }
+
+    void clock()
+    {
+        if (!hsync_pipe_.empty()) {
+            shift(hsync_pipe_, raw_hsync());
+            shift(vsync_pipe_, raw_vsync());
+            shift(valid_pipe_, raw_valid());
+        }
+        unsigned h_last = legacy_ ? t_.h_total() : t_.h_total() - 1;
+        unsigned v_last = legacy_ ? t_.v_total() : t_.v_total() - 1;
+        if (hcnt >= h_last) {
+            hcnt = 0;
+            vcnt = vcnt >= v_last ? 0 : vcnt + 1;
+        } else {
+            ++hcnt;
+        }
+    }
+
+private:
+    static void shift(std::deque<bool>& pipe, bool in)
+    {
+        pipe.pop_back();
+        pipe.push_front(in);
+    }
+
+    Timing           t_;
+    bool             legacy_;
+    std::deque<bool> hsync_pipe_, vsync_pipe_, valid_pipe_;
+};
+
+}  // namespace vga_sim
+
+#endif
@@ -0,0 +1,450 @@
+/*      video_model.cpp
+        Scalar reference and SIMD line kernels for video_model.h.
+
+        The background is computed 8 (SSE2) or 16 (AVX2) pixels at a
+        time in 16-bit lanes; masking after each step reproduces the
+        8- and 10-bit wraparound of the RTL, and the low 16 bits of
+        diff*sum hold the product bits [11:4] that background uses. The
+        cursor covers a few pixels of a line, so like in_ellipse in the
+        RTL, its span on each line is found once and only those pixels
+        are redrawn. */
+
+#include "video_model.h"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define VIDEO_MODEL_X86 1
+#include <immintrin.h>
+#endif
+
+namespace video_model {
+
+namespace {
+
+/* draw_cursor's shapes, and its power-up alpha, an even mix */
+const uint32_t CURSOR_RAD_SQUARED = 140;
+const unsigned CURSOR_X_REDUCE    = 1;
+const unsigned CURSOR_Y_REDUCE    = 0;
+const uint32_t HITBOX_RAD_SQUARED = 8;
+const unsigned CURSOR_ALPHA       = 127;
+
+/* the terms of background that only depend on the line */
+struct LineTerms {
+    uint16_t diff_offset;   // counter - y, added to x for diff
+    uint16_t sum_offset;    // y - counter, added to x for sum
+    uint16_t counter;
+    uint16_t counter_x4;    // (counter << 2) & 0xFF
+    uint16_t y_wave;
+};
+
+LineTerms line_terms(unsigned y, unsigned counter)
+{
+    y &= 0x3FF;
+    counter &= 0x7FF;
+    LineTerms t;
+    t.diff_offset = uint16_t(counter - y);
+    t.sum_offset  = uint16_t(y - counter);
+    t.counter     = uint16_t(counter);
+    t.counter_x4  = uint16_t((counter << 2) & 0xFF);
+    t.y_wave      = uint16_t((((y << 2) - counter) & 0xFF) >> 6) +
+                    uint16_t(((0u - (y << 2) - counter) & 0xFF) >> 6);
+    return t;
+}
+
+uint32_t background_from_terms(unsigned x, const LineTerms& t)
+{
+    unsigned diff      = (x + t.diff_offset) & 0x3FF;
+    unsigned sum       = (x + t.sum_offset) & 0x3FF;
+    unsigned product   = diff * sum;
+    unsigned intensity = (((product >> 4) + t.counter_x4) & 0xFF) >> 3;
+    unsigned x_wave    = (((x << 2) - t.counter) & 0xFF) >> 5;
+    x_wave            += ((0u - (x << 2) - t.counter) & 0xFF) >> 5;
+    unsigned waves     = x_wave + t.y_wave;
+
+    unsigned r = (0x70 + waves) & 0xFF;
+    unsigned g = (0x80 + (~intensity & 0xFF)) & 0xFF;
+    unsigned b = (0xC0 + intensity + waves) & 0xFF;
+    return (r << 16) | (g << 8) | b;
+}
+
+/* integer square root one bit at a time, as in in_ellipse */
+uint32_t square_root(uint32_t value)
+{
+    uint32_t root = 0;
+    for (uint32_t bit = 1u << 30; bit != 0; bit >>= 2) {
+        if (value >= root + bit) {
+            value -= root + bit;
+            root = (root >> 1) + bit;
+        } else {
+            root >>= 1;
+        }
+    }
+    return root;
+}
+
+/*
+ * ellipse_span
+ *
+ * Finds the pixels of line y inside in_ellipse, the same way the RTL
+ * does while the previous line is shown.
+ *
+ * Returns:
+ *  False if the line misses the ellipse; otherwise the first and last
+ *  x inside, which may be off the screen, in *left and *right.
+ */
+bool ellipse_span(unsigned y, unsigned cent_x, unsigned cent_y,
+                  uint32_t rad_squared, unsigned x_reduce, unsigned y_reduce,
+                  int* left, int* right)
+{
+    int16_t  d_y         = int16_t(uint16_t((y - cent_y) << y_reduce));
+    uint32_t d_y_size    = uint16_t(d_y < 0 ? -d_y : d_y);
+    uint32_t d_y_squared = d_y_size * d_y_size;
+    if (d_y_squared >= rad_squared)
+        return false;
+    int half = int(square_root(rad_squared - d_y_squared - 1) >> x_reduce);
+    *left  = int(cent_x) - half;
+    *right = int(cent_x) + half;
+    return true;
+}
+
+uint32_t cursor_blend(uint32_t background, unsigned buttons)
+{
+    uint32_t cursor = 0;
+    for (unsigned channel = 0; channel < 3; ++channel)
+        cursor |= ((buttons >> channel) & 1 ? 0x80u : 0xFFu) << (8 * channel);
+    return blend_pixel(cursor, CURSOR_ALPHA, background);
+}
+
+/* redraws the pixels of line that the cursor covers */
+void draw_cursor_line(uint32_t* line, unsigned y, const FrameState& s)
+{
+    int left, right, hit_left, hit_right;
+    if (!ellipse_span(y, s.x_cursor, s.y_cursor, CURSOR_RAD_SQUARED,
+                      CURSOR_X_REDUCE, CURSOR_Y_REDUCE, &left, &right)) {
+        left  = 1;
+        right = 0;
+    }
+    if (!ellipse_span(y, s.x_cursor, s.y_cursor, HITBOX_RAD_SQUARED, 0, 0,
+                      &hit_left, &hit_right)) {
+        hit_left  = 1;
+        hit_right = 0;
+    }
+    int first = std::max(std::min(left, hit_left), 0);
+    int last  = std::min(std::max(right, hit_right), int(WIDTH) - 1);
+    for (int x = first; x <= last; ++x) {
+        if (x >= hit_left && x <= hit_right)
+            line[x] = 0xFFFFFF;
+        else if (x >= left && x <= right)
+            line[x] = cursor_blend(line[x], s.buttons);
+    }
+}
+
+void background_line_scalar(uint32_t* line, const LineTerms& t)
+{
+    for (unsigned x = 0; x < WIDTH; ++x)
+        line[x] = background_from_terms(x, t);
+}
+
+#ifdef VIDEO_MODEL_X86
+
+__attribute__((target("sse2")))
+void background_line_sse2(uint32_t* line, const LineTerms& t)
+{
+    const __m128i mask8      = _mm_set1_epi16(0xFF);
+    const __m128i mask10     = _mm_set1_epi16(0x3FF);
+    const __m128i diff_off   = _mm_set1_epi16(int16_t(t.diff_offset));
+    const __m128i sum_off    = _mm_set1_epi16(int16_t(t.sum_offset));
+    const __m128i counter    = _mm_set1_epi16(int16_t(t.counter));
+    const __m128i neg_count  = _mm_set1_epi16(int16_t(-t.counter));
+    const __m128i counter_x4 = _mm_set1_epi16(int16_t(t.counter_x4));
+    const __m128i y_wave     = _mm_set1_epi16(int16_t(t.y_wave));
+    const __m128i r_base     = _mm_set1_epi16(0x70);
+    const __m128i g_base     = _mm_set1_epi16(0x80);
+    const __m128i b_base     = _mm_set1_epi16(0xC0);
+    const __m128i step       = _mm_set1_epi16(8);
+    __m128i x = _mm_setr_epi16(0, 1, 2, 3, 4, 5, 6, 7);
+
+    for (unsigned x0 = 0; x0 < WIDTH; x0 += 8, x = _mm_add_epi16(x, step)) {
+        __m128i diff    = _mm_and_si128(_mm_add_epi16(x, diff_off), mask10);
+        __m128i sum     = _mm_and_si128(_mm_add_epi16(x, sum_off), mask10);
+        __m128i product = _mm_mullo_epi16(diff, sum);
+        __m128i intensity = _mm_srli_epi16(
+            _mm_and_si128(_mm_add_epi16(_mm_srli_epi16(product, 4),
+                                        counter_x4), mask8), 3);
+
+        __m128i x4      = _mm_slli_epi16(x, 2);
+        __m128i wave_up = _mm_srli_epi16(
+            _mm_and_si128(_mm_sub_epi16(x4, counter), mask8), 5);
+        __m128i wave_dn = _mm_srli_epi16(
+            _mm_and_si128(_mm_sub_epi16(neg_count, x4), mask8), 5);
+        __m128i waves   = _mm_add_epi16(_mm_add_epi16(wave_up, wave_dn),
+                                        y_wave);
+
+        __m128i r = _mm_and_si128(_mm_add_epi16(r_base, waves), mask8);
+        __m128i g = _mm_and_si128(
+            _mm_add_epi16(g_base, _mm_xor_si128(intensity, mask8)), mask8);
+        __m128i b = _mm_and_si128(
+            _mm_add_epi16(_mm_add_epi16(b_base, intensity), waves), mask8);
+
+        __m128i gb = _mm_or_si128(_mm_slli_epi16(g, 8), b);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(line + x0),
+                         _mm_unpacklo_epi16(gb, r));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(line + x0 + 4),
+                         _mm_unpackhi_epi16(gb, r));
+    }
+}
+
+__attribute__((target("avx2")))
+void background_line_avx2(uint32_t* line, const LineTerms& t)
+{
+    const __m256i mask8      = _mm256_set1_epi16(0xFF);
+    const __m256i mask10     = _mm256_set1_epi16(0x3FF);
+    const __m256i diff_off   = _mm256_set1_epi16(int16_t(t.diff_offset));
+    const __m256i sum_off    = _mm256_set1_epi16(int16_t(t.sum_offset));
+    const __m256i counter    = _mm256_set1_epi16(int16_t(t.counter));
+    const __m256i neg_count  = _mm256_set1_epi16(int16_t(-t.counter));
+    const __m256i counter_x4 = _mm256_set1_epi16(int16_t(t.counter_x4));
+    const __m256i y_wave     = _mm256_set1_epi16(int16_t(t.y_wave));
+    const __m256i r_base     = _mm256_set1_epi16(0x70);
+    const __m256i g_base     = _mm256_set1_epi16(0x80);
+    const __m256i b_base     = _mm256_set1_epi16(0xC0);
+    const __m256i step       = _mm256_set1_epi16(16);
+    __m256i x = _mm256_setr_epi16(0, 1, 2, 3, 4, 5, 6, 7,
+                                  8, 9, 10, 11, 12, 13, 14, 15);
+
+    for (unsigned x0 = 0; x0 < WIDTH; x0 += 16,
+                                      x = _mm256_add_epi16(x, step)) {
+        __m256i diff    = _mm256_and_si256(_mm256_add_epi16(x, diff_off),
+                                           mask10);
+        __m256i sum     = _mm256_and_si256(_mm256_add_epi16(x, sum_off),
+                                           mask10);
+        __m256i product = _mm256_mullo_epi16(diff, sum);
+        __m256i intensity = _mm256_srli_epi16(
+            _mm256_and_si256(_mm256_add_epi16(_mm256_srli_epi16(product, 4),
+                                              counter_x4), mask8), 3);
+
+        __m256i x4      = _mm256_slli_epi16(x, 2);
+        __m256i wave_up = _mm256_srli_epi16(
+            _mm256_and_si256(_mm256_sub_epi16(x4, counter), mask8), 5);
+        __m256i wave_dn = _mm256_srli_epi16(
+            _mm256_and_si256(_mm256_sub_epi16(neg_count, x4), mask8), 5);
+        __m256i waves   = _mm256_add_epi16(_mm256_add_epi16(wave_up, wave_dn),
+                                           y_wave);
+
+        __m256i r = _mm256_and_si256(_mm256_add_epi16(r_base, waves), mask8);
+        __m256i g = _mm256_and_si256(
+            _mm256_add_epi16(g_base, _mm256_xor_si256(intensity, mask8)),
+            mask8);
+        __m256i b = _mm256_and_si256(
+            _mm256_add_epi16(_mm256_add_epi16(b_base, intensity), waves),
+            mask8);
+
+        // unpack works within 128-bit halves, so put pixels 0-7 in the
+        // low half and 8-15 in the high half of the unpacked results
+        __m256i gb = _mm256_permute4x64_epi64(
+            _mm256_or_si256(_mm256_slli_epi16(g, 8), b), 0xD8);
+        r = _mm256_permute4x64_epi64(r, 0xD8);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(line + x0),
+                            _mm256_unpacklo_epi16(gb, r));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(line + x0 + 8),
+                            _mm256_unpackhi_epi16(gb, r));
+    }
+}
+
+#endif
+
+unsigned bayer(unsigned x, unsigned y)
+{
+    static const uint8_t matrix[4][4] = {{0, 8, 2, 10},
+                                         {12, 4, 14, 6},
+                                         {3, 11, 1, 9},
+                                         {15, 7, 13, 5}};
+    return matrix[y & 3][x & 3];
+}
+
+/* one channel of dither: add offset, saturate, keep the top bits */
+unsigned dither_channel(unsigned value, unsigned offset, unsigned drop)
+{
+    return std::min(value + offset, 0xFFu) & (0xFFu << drop) & 0xFF;
+}
+
+Kernel resolve(Kernel kernel)
+{
+    return kernel == Kernel::Auto ? best_kernel() : kernel;
+}
+
+}  // namespace
+
+uint32_t background_pixel(unsigned x, unsigned y, unsigned counter)
+{
+    return background_from_terms(x & 0x3FF, line_terms(y, counter));
+}
+
+bool in_ellipse(unsigned x, unsigned y, unsigned cent_x, unsigned cent_y,
+                uint32_t rad_squared, unsigned x_reduce, unsigned y_reduce)
+{
+    int32_t  d_x = int16_t(uint16_t((x - cent_x) << x_reduce));
+    int32_t  d_y = int16_t(uint16_t((y - cent_y) << y_reduce));
+    uint32_t d_x_squared = uint32_t(d_x * d_x);
+    uint32_t d_y_squared = uint32_t(d_y * d_y);
+    return d_x_squared + d_y_squared < rad_squared;
+}
+
+bool in_disk(unsigned x, unsigned y, unsigned cent_x, unsigned cent_y,
+             uint32_t rad_squared)
+{
+    return in_ellipse(x, y, cent_x, cent_y, rad_squared, 0, 0);
+}
+
+uint32_t video_pixel(unsigned x, unsigned y, const FrameState& s)
+{
+    uint32_t background = background_pixel(x, y, s.counter);
+    if (in_disk(x, y, s.x_cursor, s.y_cursor, HITBOX_RAD_SQUARED))
+        return 0xFFFFFF;
+    if (in_ellipse(x, y, s.x_cursor, s.y_cursor, CURSOR_RAD_SQUARED,
+                   CURSOR_X_REDUCE, CURSOR_Y_REDUCE))
+        return cursor_blend(background, s.buttons);
+    return background;
+}
+
+uint32_t blend_pixel(uint32_t color, unsigned alpha, uint32_t below)
+{
+    unsigned weight = (alpha & 0xFF) + 1;
+    uint32_t rgb    = 0;
+    for (unsigned shift = 0; shift < 24; shift += 8) {
+        unsigned sum = weight * ((color >> shift) & 0xFF) +
+                       (256 - weight) * ((below >> shift) & 0xFF);
+        rgb |= (sum >> 8) << shift;
+    }
+    return rgb;
+}
+
+uint32_t composite_pixel(const Layer* layers, unsigned count,
+                         uint32_t background)
+{
+    uint32_t rgb = background;
+    for (unsigned i = count; i-- > 0; ) {
+        if (!layers[i].covered)
+            continue;
+        unsigned weight = layers[i].alpha + 1u;
+        uint32_t below  = rgb;
+        rgb = 0;
+        for (unsigned shift = 0; shift < 24; shift += 8) {
+            unsigned sum = weight * ((layers[i].rgb >> shift) & 0xFF) + 128 +
+                           (256 - weight) * ((below >> shift) & 0xFF);
+            rgb |= (sum >> 8) << shift;
+        }
+    }
+    return rgb;
+}
+
+uint32_t dither_pixel(uint32_t rgb, unsigned x, unsigned y, unsigned phase,
+                      unsigned dac_bits)
+{
+    unsigned drop = 8 - dac_bits;
+    if (drop == 0)
+        return rgb;
+    unsigned threshold = (bayer(x, y) + 4 * (phase & 3)) & 0xF;
+    unsigned offset    = threshold >> (4 - drop);
+    return (dither_channel((rgb >> 16) & 0xFF, offset, drop) << 16) |
+           (dither_channel((rgb >> 8) & 0xFF, offset, drop) << 8) |
+           dither_channel(rgb & 0xFF, offset, drop);
+}
+
+uint8_t to_rgb332(uint32_t rgb, unsigned x, unsigned y)
+{
+    // pick between the two nearest of the levels from_rgb332 shows,
+    // with the threshold spread over the step between them
+    unsigned threshold = bayer(x, y) * 255 + 127;
+    auto level = [=](unsigned value, unsigned steps) {
+        return (value * steps * 16 + threshold) / (255 * 16);
+    };
+    unsigned r = level((rgb >> 16) & 0xFF, 7);
+    unsigned g = level((rgb >> 8) & 0xFF, 7);
+    unsigned b = level(rgb & 0xFF, 3);
+    return uint8_t((r << 5) | (g << 2) | b);
+}
+
+uint32_t from_rgb332(uint8_t pixel)
+{
+    unsigned r = pixel >> 5, g = (pixel >> 2) & 7, b = pixel & 3;
+    return (((r << 5) | (r << 2) | (r >> 1)) << 16) |
+           (((g << 5) | (g << 2) | (g >> 1)) << 8) |
+           (b * 0x55);
+}
+
+Kernel best_kernel()
+{
+#ifdef VIDEO_MODEL_X86
+    if (__builtin_cpu_supports("avx2")) return Kernel::AVX2;
+    if (__builtin_cpu_supports("sse2")) return Kernel::SSE2;
+#endif
+    return Kernel::Scalar;
+}
+
+const char* kernel_name(Kernel kernel)
+{
+    switch (resolve(kernel)) {
+    case Kernel::SSE2: return "sse2";
+    case Kernel::AVX2: return "avx2";
+    default:           return "scalar";
+    }
+}
+
+void render_line(uint32_t* line, unsigned y, const FrameState& state,
+                 Kernel kernel)
+{
+    LineTerms terms = line_terms(y, state.counter);
+    switch (resolve(kernel)) {
+#ifdef VIDEO_MODEL_X86
+    case Kernel::SSE2: background_line_sse2(line, terms); break;
+    case Kernel::AVX2: background_line_avx2(line, terms); break;
+#endif
+    default:           background_line_scalar(line, terms); break;
+    }
+    draw_cursor_line(line, y, state);
+}
+
+void render_frame(uint32_t* frame, const FrameState& state, Kernel kernel)
+{
+    kernel = resolve(kernel);
+    for (unsigned y = 0; y < HEIGHT; ++y)
+        render_line(frame + size_t(y) * WIDTH, y, state, kernel);
+}
+
+void render_frames(uint32_t* frames, const FrameState* states, size_t count,
+                   unsigned threads, Kernel kernel)
+{
+    // whole frames keep each thread writing one contiguous frame at a
+    // time; bands of lines are only used when there are fewer frames
+    // than threads
+    const unsigned band_lines = count < threads ? 32 : HEIGHT;
+    const size_t   bands      = (HEIGHT + band_lines - 1) / band_lines;
+    const size_t   tiles      = count * bands;
+    std::atomic<size_t> next_tile(0);
+
+    kernel = resolve(kernel);
+    auto worker = [&]() {
+        for (size_t tile; (tile = next_tile++) < tiles; ) {
+            size_t    frame = tile / bands;
+            unsigned  first = unsigned(tile % bands) * band_lines;
+            unsigned  last  = std::min(first + band_lines, HEIGHT);
+            uint32_t* base  = frames + frame * WIDTH * HEIGHT;
+            for (unsigned y = first; y < last; ++y)
+                render_line(base + size_t(y) * WIDTH, y, states[frame], kernel);
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (unsigned i = 1; i < threads; ++i)
+        pool.emplace_back(worker);
+    worker();
+    for (std::thread& t : pool)
+        t.join();
+}
+
+}  // namespace video_model
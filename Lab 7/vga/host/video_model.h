@@ -0,0 +1,112 @@
+/*      video_model.h
+        Bit-exact C++ model of the videoGen layers in vga.sv that do not
+        depend on commands: background, draw_cursor, in_disk and
+        in_ellipse, in the 640x480 mode, with the blending of
+        compositor.sv and the output dither.
+
+        Build with video_model.cpp, e.g.
+            g++ -std=c++17 -O2 -pthread -c video_model.cpp
+
+        Pixels are packed as 0x00RRGGBB, the {r_int, g_int, b_int} that
+        videoGen produces for x, y when the framebuffer, text and sprite
+        layers are off. The scalar functions follow the RTL expressions
+        one for one and are the golden model for a simulation of
+        videoGen; the line and frame renderers give the same pixels
+        using SSE2 or AVX2 kernels where the CPU has them. */
+
+#ifndef VIDEO_MODEL_H
+#define VIDEO_MODEL_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace video_model {
+
+const unsigned WIDTH  = 640;
+const unsigned HEIGHT = 480;
+
+/*
+ * FrameState
+ *
+ * What videoGen holds constant over a frame: the background's 11-bit
+ * frame counter, and the cursor position (10 bits each) and buttons
+ * ([2] red, [1] green, [0] blue) applied by mouse_reader at vsync.
+ */
+struct FrameState {
+    uint16_t counter;
+    uint16_t x_cursor, y_cursor;
+    uint8_t  buttons;
+};
+
+enum class Kernel { Auto, Scalar, SSE2, AVX2 };
+
+/* background: the moving gradient color at x_screen, y_screen. */
+uint32_t background_pixel(unsigned x, unsigned y, unsigned counter);
+
+/* in_ellipse: (d_x << x_reduce)^2 + (d_y << y_reduce)^2 < rad_squared,
+   with the 16-bit distances and 32-bit squares of the RTL. */
+bool in_ellipse(unsigned x, unsigned y, unsigned cent_x, unsigned cent_y,
+                uint32_t rad_squared, unsigned x_reduce, unsigned y_reduce);
+
+/* in_disk: in_ellipse with no reduction. */
+bool in_disk(unsigned x, unsigned y, unsigned cent_x, unsigned cent_y,
+             uint32_t rad_squared);
+
+/* videoGen: the cursor drawn over the background at x, y, with
+   draw_cursor's power-up alpha. */
+uint32_t video_pixel(unsigned x, unsigned y, const FrameState& state);
+
+/* compositor and draw_cursor: color over below with weight alpha+1
+   of 256 in each channel. */
+uint32_t blend_pixel(uint32_t color, unsigned alpha, uint32_t below);
+
+/* A compositor layer at one pixel: whether it covers the pixel, its
+   color and its OP_CONTROL alpha. */
+struct Layer {
+    bool     covered;
+    uint32_t rgb;
+    uint8_t  alpha;
+};
+
+/* compositor: count layers, the top one first, over background,
+   blended as blend_pixel does but rounded to nearest. */
+uint32_t composite_pixel(const Layer* layers, unsigned count,
+                         uint32_t background);
+
+/* dither: rgb reduced to dac_bits (4 to 8) per channel, left aligned
+   in each byte, at x, y in frame phase (0 to 3). */
+uint32_t dither_pixel(uint32_t rgb, unsigned x, unsigned y, unsigned phase,
+                      unsigned dac_bits);
+
+/* An RGB332 framebuffer pixel for rgb at x, y, ordered dithered with
+   the same 4x4 thresholds as dither, and the color the framebuffer
+   shows for a pixel. */
+uint8_t  to_rgb332(uint32_t rgb, unsigned x, unsigned y);
+uint32_t from_rgb332(uint8_t pixel);
+
+/* The fastest kernel this CPU supports; Auto resolves to this. */
+Kernel best_kernel();
+const char* kernel_name(Kernel kernel);
+
+/* Renders line y, WIDTH pixels, into line. */
+void render_line(uint32_t* line, unsigned y, const FrameState& state,
+                 Kernel kernel = Kernel::Auto);
+
+/* Renders a WIDTH x HEIGHT frame, line after line, into frame. */
+void render_frame(uint32_t* frame, const FrameState& state,
+                  Kernel kernel = Kernel::Auto);
+
+/*
+ * render_frames
+ *
+ * Renders count frames, frame i from states[i] into
+ * frames + i*WIDTH*HEIGHT, on threads worker threads that each take
+ * the next whole frame. With fewer frames than threads the frames are
+ * cut into bands of 32 lines instead, so every thread has work.
+ */
+void render_frames(uint32_t* frames, const FrameState* states, size_t count,
+                   unsigned threads, Kernel kernel = Kernel::Auto);
+
+}  // namespace video_model
+
+#endif
@@ -0,0 +1,50 @@
+// line_prefetch.sv
+// Line buffer for the layers of videoGen. The layers are given x and
+// the next line, y+1, so they draw each line while the line before is
+// shown; their pixels go into one half of a double line buffer while
+// the display reads the other half. The layers' own latency and
+// memory timing then only have to fit within a line, not a pixel,
+// and the display sees a fixed OUT_DELAY whatever the layers do.
+
+// stores ahead, the layer's output for x, y+1 arriving LATENCY
+// clocks after x, y, and produces shown for x, y OUT_DELAY (1 or
+// more) clocks after x, y. LATENCY may be up to the horizontal
+// blanking time of the mode. Each half holds LINE_WIDTH rounded up to
+// a power of two, addressed by the low ADDR_BITS of x, so only modes
+// wider than 1024 pay for 2048 pixel halves.
+module line_prefetch #(parameter WIDTH      = 24,
+                                 LATENCY    = 3,
+                                 OUT_DELAY  = 3,
+                                 LINE_WIDTH = 640)
+                      (input  logic               clk,
+                       input  logic [10:0]        x, y,
+                       input  logic [(WIDTH-1):0] ahead,
+                       output logic [(WIDTH-1):0] shown);
+  localparam ADDR_BITS = $clog2(LINE_WIDTH);
+
+  logic [(WIDTH-1):0]                lines[0:2*2**ADDR_BITS-1];
+  logic [(WIDTH-1):0]                q;
+  logic [LATENCY-1:0][ADDR_BITS+1:0] write_pipe;
+  logic                              write_valid, write_half;
+  logic [ADDR_BITS-1:0]              write_addr;
+
+  // where each pixel of the next line goes, LATENCY clocks later
+  always_ff @(posedge clk)
+    write_pipe <= {write_pipe, {x < LINE_WIDTH, ~y[0], x[ADDR_BITS-1:0]}};
+  assign {write_valid, write_half, write_addr} = write_pipe[LATENCY-1];
+
+  always_ff @(posedge clk) begin
+    if (write_valid) lines[{write_half, write_addr}] <= ahead;
+    q <= lines[{y[0], x[ADDR_BITS-1:0]}];
+  end
+
+  generate
+    if (OUT_DELAY == 1) begin
+      assign shown = q;
+    end else begin
+      logic [OUT_DELAY-2:0][(WIDTH-1):0] out_pipe;
+      always_ff @(posedge clk) out_pipe <= {out_pipe, q};
+      assign shown = out_pipe[OUT_DELAY-2];
+    end
+  endgenerate
+endmodule
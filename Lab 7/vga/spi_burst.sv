@@ -0,0 +1,209 @@
+// spi_burst.sv
+// Burst SPI command port for vga.sv. While fsync is high, the PIC
+// sends one or more bursts, most significant bit first:
+//   header   - 4 bytes: [31:28] opcode from vga_commands.sv,
+//              [27:11] start address, [10:0] element count - 1
+//   elements - element_bytes(opcode) bytes each, at consecutive
+//              addresses starting from the start address
+// Lowering fsync abandons any partial burst. Each element becomes one
+// command word, which crosses into the pixel clock domain through an
+// asynchronous FIFO, so the PIC pays the frame overhead once per burst
+// rather than once per word.
+//
+// In the other direction, bytes 1 to 12 of every frame (counting from
+// 0 after fsync rises) carry a 96-bit status word on serial_output,
+// most significant bit first, changing on falling spi_clk edges so
+// the PIC samples it on rising edges. The status is captured in the
+// pixel clock domain as fsync rises, so byte 0 must last at least
+// 4 pixel clocks. A burst to OP_NOP reads the status without side
+// effects: the header and 9 element bytes cover bytes 1 to 12.
+
+// receives bursts on spi_clk and produces the commands, one per clk
+// cycle with command_valid high, in the clk domain. commands that
+// arrive while the FIFO is full are dropped and counted in dropped,
+// which crosses into the clk domain as a Gray code.
+module spi_command_port #(parameter FIFO_ADDR_BITS = 4)
+                         (input  logic        spi_clk,
+                          input  logic        serial_input,
+                          input  logic        fsync,
+                          input  logic        clk,
+                          output logic [31:0] command,
+                          output logic        command_valid,
+                          output logic [15:0] dropped);
+  logic [31:0] spi_command, fifo_command;
+  logic        push, full, empty;
+  logic [15:0] dropped_bin = '0, dropped_gray = '0;
+  logic [15:0] dropped_gray_1 = '0, dropped_gray_2 = '0;
+  logic [15:0] dropped_next;
+
+  spi_burst_slave slave(spi_clk, serial_input, fsync, spi_command, push);
+  async_fifo #(32, FIFO_ADDR_BITS) fifo(spi_clk, push, spi_command, full,
+                                        clk, ~empty, fifo_command, empty);
+
+  always_ff @(posedge clk) begin
+    command       <= fifo_command;
+    command_valid <= ~empty;
+  end
+
+  assign dropped_next = dropped_bin + 1;
+
+  always_ff @(posedge spi_clk) begin
+    if (push & full) begin
+      dropped_bin  <= dropped_next;
+      dropped_gray <= dropped_next ^ (dropped_next >> 1);
+    end
+  end
+
+  always_ff @(posedge clk) begin
+    {dropped_gray_2, dropped_gray_1} <= {dropped_gray_1, dropped_gray};
+  end
+
+  always_comb begin
+    dropped[15] = dropped_gray_2[15];
+    for (int i = 14; i >= 0; i--) dropped[i] = dropped[i+1] ^ dropped_gray_2[i];
+  end
+endmodule
+
+// decodes bursts into command words. spi_clk only runs while data
+// is being sent, so push and command are produced combinationally
+// from the last bit of each element, to be written on the same edge.
+module spi_burst_slave(input  logic        spi_clk,
+                       input  logic        serial_input,
+                       input  logic        fsync,
+                       output logic [31:0] command,
+                       output logic        push);
+  import vga_commands::*;
+
+  logic [2:0]  bit_count;
+  logic [6:0]  shift;
+  logic [7:0]  byte_in;
+  logic        byte_done;
+  logic        in_header;
+  logic [1:0]  byte_index;
+  logic [23:0] partial;
+  logic [3:0]  op;
+  logic [16:0] address;
+  logic [10:0] remaining;
+  logic        element_done;
+
+  always_comb begin
+    byte_in      = {shift, serial_input};
+    byte_done    = (bit_count == 3'd7);
+    element_done = byte_done & ~in_header & 
+                   (byte_index == element_bytes(op) - 2'd1);
+    push         = element_done;
+    command      = burst_command(op, address, 24'({partial, byte_in}));
+  end
+
+  always_ff @(posedge spi_clk or negedge fsync) begin
+    if (~fsync) begin
+      bit_count  <= '0;
+      in_header  <= '1;
+      byte_index <= '0;
+    end else begin
+      bit_count <= bit_count + 1;
+      shift     <= byte_in[6:0];
+      if (byte_done & in_header) begin
+        if (byte_index == 2'd3) begin
+          {op, address, remaining} <= {partial, byte_in};
+          partial    <= '0;
+          in_header  <= '0;
+          byte_index <= '0;
+        end else begin
+          partial    <= {partial, byte_in};
+          byte_index <= byte_index + 1;
+        end
+      end else if (element_done) begin
+        address    <= address + 1;
+        remaining  <= remaining - 1;
+        in_header  <= (remaining == 0);
+        partial    <= '0;
+        byte_index <= '0;
+      end else if (byte_done) begin
+        partial    <= {partial, byte_in};
+        byte_index <= byte_index + 1;
+      end
+    end
+  end
+endmodule
+
+// shifts out the status captured in the clk domain when fsync rises.
+// the capture is 3 clk cycles after fsync, long before it is loaded
+// into the shift register on the falling edge that ends byte 0, so it
+// is stable when it crosses into the spi_clk domain.
+module spi_status_port #(parameter WIDTH = 96)
+                        (input  logic               spi_clk,
+                         input  logic               fsync,
+                         input  logic               clk,
+                         input  logic [(WIDTH-1):0] status,
+                         output logic               serial_output);
+  logic               fsync_1 = '0, fsync_2 = '0, fsync_3 = '0;
+  logic [(WIDTH-1):0] snapshot, shift;
+  logic [2:0]         bit_count;
+  logic               loaded, started;
+
+  always_ff @(posedge clk) begin
+    {fsync_3, fsync_2, fsync_1} <= {fsync_2, fsync_1, fsync};
+    if (fsync_2 & ~fsync_3) snapshot <= status;
+  end
+
+  // byte 0 is counted on rising edges
+  always_ff @(posedge spi_clk or negedge fsync)
+    if (~fsync) begin
+      bit_count <= '0;
+      loaded    <= '0;
+    end else if (~loaded) begin
+      bit_count <= bit_count + 1;
+      loaded    <= (bit_count == 3'd7);
+    end
+
+  always_ff @(negedge spi_clk or negedge fsync)
+    if (~fsync) started <= '0;
+    else        started <= loaded;
+
+  always_ff @(negedge spi_clk)
+    if (~started) shift <= snapshot;
+    else          shift <= shift << 1;
+
+  assign serial_output = shift[WIDTH-1];
+endmodule
+
+// dual clock FIFO with Gray coded pointers, each synchronized into
+// the other clock domain through two registers. rdata shows the
+// oldest word whenever empty is low, and pop removes it.
+module async_fifo #(parameter WIDTH = 32, ADDR_BITS = 4)
+                   (input  logic               wclk,
+                    input  logic               push,
+                    input  logic [(WIDTH-1):0] wdata,
+                    output logic               full,
+                    input  logic               rclk,
+                    input  logic               pop,
+                    output logic [(WIDTH-1):0] rdata,
+                    output logic               empty);
+  logic [(WIDTH-1):0] ram[0:(2**ADDR_BITS-1)];
+  logic [ADDR_BITS:0] wbin = '0, wgray = '0, rbin = '0, rgray = '0;
+  logic [ADDR_BITS:0] wgray_r1 = '0, wgray_r2 = '0;
+  logic [ADDR_BITS:0] rgray_w1 = '0, rgray_w2 = '0;
+  logic [ADDR_BITS:0] wbin_next, rbin_next;
+
+  assign wbin_next = wbin + (push & ~full);
+  assign rbin_next = rbin + (pop & ~empty);
+
+  always_ff @(posedge wclk) begin
+    if (push & ~full) ram[wbin[(ADDR_BITS-1):0]] <= wdata;
+    wbin  <= wbin_next;
+    wgray <= wbin_next ^ (wbin_next >> 1);
+    {rgray_w2, rgray_w1} <= {rgray_w1, rgray};
+  end
+
+  always_ff @(posedge rclk) begin
+    rbin  <= rbin_next;
+    rgray <= rbin_next ^ (rbin_next >> 1);
+    {wgray_r2, wgray_r1} <= {wgray_r1, wgray};
+  end
+
+  assign full  = (wgray == {~rgray_w2[ADDR_BITS:ADDR_BITS-1],
+                            rgray_w2[(ADDR_BITS-2):0]});
+  assign empty = (rgray == wgray_r2);
+  assign rdata = ram[rbin[(ADDR_BITS-1):0]];
+endmodule
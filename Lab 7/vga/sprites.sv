@@ -0,0 +1,192 @@
+// sprites.sv
+// Hardware sprite layer for vga.sv: SPRITES sprites of 16x16 pixels,
+// each with its own position, rank and 4 bit alpha per pixel, set by
+// OP_SPRITE_PATTERN and OP_SPRITE commands.
+//
+// While line y is shown, the sprites covering line y+1 are drawn
+// into the other half of a double line buffer, taking about 18 clocks
+// per visible sprite. Showing a pixel is then a line buffer read and
+// a blend, with no position compares in the pixel path. Each buffer
+// entry is cleared after it is shown, ready for the line after next.
+
+// blends the sprites over below_rgb. rgb is produced 4 clocks after
+// x, y arrive, from below_rgb given 3 clocks after them; the blend is
+// registered so that its multiplies and the cursor blend that follows
+// are in separate clocks.
+module sprite_engine #(parameter SPRITES    = 4,
+                                 LINE_WIDTH = 640)
+                      (input  logic        clk,
+                       input  logic [31:0] command,
+                       input  logic        command_valid,
+                       input  logic [10:0] x, y,
+                       input  logic [23:0] below_rgb,
+                       output logic [23:0] rgb);
+  import vga_commands::*;
+
+  localparam INDEX_BITS = (SPRITES > 1) ? $clog2(SPRITES) : 1;
+
+  typedef struct packed {
+    logic        occupied;
+    logic [1:0]  rank;
+    logic [3:0]  alpha;
+    logic [11:0] color;
+  } line_pixel_t;
+
+  typedef enum logic [1:0] {IDLE, CHECK, DRAW, GAP} state_t;
+
+  // sprite registers and patterns
+  logic [10:0] sprite_x[SPRITES], sprite_y[SPRITES];
+  logic [1:0]  sprite_rank[SPRITES];
+  logic        sprite_on[SPRITES];
+  logic [15:0] patterns[0:SPRITES*256-1];
+
+  always_ff @(posedge clk) begin
+    if (command_valid & opcode(command) == OP_SPRITE_PATTERN &
+        command[27:16] < SPRITES*256)
+      patterns[command[27:16]] <= command[15:0];
+    if (command_valid & opcode(command) == OP_SPRITE &
+        command[27:24] < SPRITES)
+      case (command[23:22])
+        2'd0 : sprite_x[command[27:24]] <= command[10:0];
+        2'd1 : sprite_y[command[27:24]] <= command[10:0];
+        2'd2 : {sprite_on[command[27:24]], sprite_rank[command[27:24]]} <=
+                   {command[8], command[1:0]};
+        default : ;
+      endcase
+  end
+
+  // drawing the next line
+  state_t                  state;
+  logic [INDEX_BITS-1:0]   sprite;
+  logic [10:0]             target_line, dy, draw_x;
+  logic [3:0]              row, column;
+  logic                    draw_buffer;
+
+  // draw pipeline: addresses issued, then pattern and buffer read
+  logic [INDEX_BITS+7:0]   pattern_addr;
+  logic [15:0]             pattern;
+  logic [9:0]              draw_addr_1, draw_addr_2;
+  logic                    draw_1, draw_2;
+  logic [1:0]              rank_1, rank_2;
+  line_pixel_t             existing, drawn;
+  logic                    draw_write, drawing;
+
+  assign dy     = target_line - sprite_y[sprite];
+  assign draw_x = sprite_x[sprite] + column;
+
+  always_ff @(posedge clk) begin
+    case (state)
+      IDLE  : if (x == 0) begin
+                target_line <= y + 1;
+                draw_buffer <= ~y[0];
+                sprite      <= '0;
+                state       <= CHECK;
+              end
+      CHECK : if (sprite_on[sprite] & dy < 16) begin
+                row    <= dy[3:0];
+                column <= '0;
+                state  <= DRAW;
+              end else if (sprite == SPRITES-1) begin
+                state  <= IDLE;
+              end else begin
+                sprite <= sprite + 1;
+              end
+      DRAW  : begin
+                column <= column + 1;
+                if (column == 4'hF) state <= GAP;
+              end
+      GAP   : if (sprite == SPRITES-1) begin
+                state  <= IDLE;
+              end else begin
+                sprite <= sprite + 1;
+                state  <= CHECK;
+              end
+    endcase
+
+    pattern_addr <= {sprite, row, column};
+    draw_addr_1  <= draw_x[9:0];
+    draw_1       <= (state == DRAW) & (draw_x < LINE_WIDTH);
+    rank_1       <= sprite_rank[sprite];
+    pattern      <= patterns[pattern_addr];
+    {draw_addr_2, draw_2, rank_2} <= {draw_addr_1, draw_1, rank_1};
+  end
+
+  assign drawn      = '{1'b1, rank_2, pattern[15:12], pattern[11:0]};
+  assign draw_write = draw_2 & (pattern[15:12] != 0) &
+                      (~existing.occupied | rank_2 < existing.rank);
+  assign drawing    = (state != IDLE) | draw_1 | draw_2;
+
+  // showing the current line
+  logic [9:0]  show_addr_1, show_addr_2;
+  logic        show_1, show_2;
+  logic        show_buffer_1, show_buffer_2;
+  line_pixel_t shown, shown_3;
+
+  always_ff @(posedge clk) begin
+    show_addr_1   <= x[9:0];
+    show_1        <= (x < LINE_WIDTH);
+    show_buffer_1 <= y[0];
+    {show_addr_2, show_2, show_buffer_2} <=
+        {show_addr_1, show_1, show_buffer_1};
+    shown_3 <= show_2 ? shown : '0;
+  end
+
+  // the two line buffers; the one being drawn belongs to the draw
+  // pipeline and the other to the display, which clears each entry
+  // the clock after reading it
+  line_pixel_t buffer_q[2];
+  generate
+    for (genvar i = 0; i < 2; i++) begin : line_buffers
+      logic        drawn_here;
+      logic [9:0]  raddr, waddr;
+      logic        we;
+      line_pixel_t wdata;
+      assign drawn_here = drawing & (draw_buffer == i);
+      assign raddr = drawn_here ? draw_addr_1 : show_addr_1;
+      assign waddr = drawn_here ? draw_addr_2 : show_addr_2;
+      assign we    = drawn_here ? draw_write
+                                : show_2 & (show_buffer_2 == i);
+      assign wdata = drawn_here ? drawn : '0;
+      line_buffer_ram #($bits(line_pixel_t), 10)
+        ram(clk, we, waddr, wdata, raddr, buffer_q[i]);
+    end
+  endgenerate
+
+  assign existing = buffer_q[draw_buffer];
+  assign shown    = buffer_q[show_buffer_2];
+
+  // blend with weight alpha+1 sixteenths over the layers below
+  always_ff @(posedge clk) begin
+    if (shown_3.occupied)
+      rgb <= {blend(shown_3.color[11:8], shown_3.alpha, below_rgb[23:16]),
+              blend(shown_3.color[ 7:4], shown_3.alpha, below_rgb[15: 8]),
+              blend(shown_3.color[ 3:0], shown_3.alpha, below_rgb[ 7: 0])};
+    else
+      rgb <= below_rgb;
+  end
+
+  function automatic logic [7:0] blend(input logic [3:0] color,
+                                       input logic [3:0] alpha,
+                                       input logic [7:0] below);
+    logic [4:0]  weight;
+    logic [11:0] sum;
+    weight = alpha + 5'd1;
+    sum    = weight * {color, color} + (5'd16 - weight) * below;
+    return sum[11:4];
+  endfunction
+endmodule
+
+// simple dual port RAM with a registered read, for block RAM inference
+module line_buffer_ram #(parameter WIDTH = 19, ADDR_BITS = 10)
+                        (input  logic                   clk,
+                         input  logic                   we,
+                         input  logic [ADDR_BITS-1:0]   waddr,
+                         input  logic [WIDTH-1:0]       wdata,
+                         input  logic [ADDR_BITS-1:0]   raddr,
+                         output logic [WIDTH-1:0]       q);
+  logic [WIDTH-1:0] ram[0:2**ADDR_BITS-1];
+  always_ff @(posedge clk) begin
+    if (we) ram[waddr] <= wdata;
+    q <= ram[raddr];
+  end
+endmodule
@@ -0,0 +1,110 @@
+// text_layer.sv
+// 80x30 character text layer for vga.sv. Each 8x16 cell holds a
+// character and an attribute byte; glyphs are the 6x8 characters of
+// charrom.txt, drawn at the left of the cell and doubled vertically.
+
+// Applies OP_TEXT and OP_TEXT_CONTROL commands, and produces the
+// text color for x, y 3 clocks after they arrive, with in_text high
+// where the text layer covers the layers below it.
+//
+// Attributes are {background, foreground} indices into a 16 color
+// palette. A background of 0 is transparent, so only the glyph is
+// drawn over the layers below.
+//
+// Scrolling is done by changing top_row, the text RAM row shown at
+// the top of the screen; rows below it wrap around the RAM, so the
+// PIC scrolls by a line by rewriting one row and advancing top_row.
+// A top_row of 30 or more would address cells past the RAM, so such
+// a write leaves top_row as it was and only sets enabled.
+module text_layer #(parameter FONT_FILE = "charrom.txt")
+                   (input  logic        clk,
+                    input  logic [31:0] command,
+                    input  logic        command_valid,
+                    input  logic [10:0] x, y,
+                    output logic        in_text,
+                    output logic [23:0] rgb);
+  import vga_commands::*;
+
+  localparam COLUMNS = 80;
+  localparam ROWS    = 30;
+  localparam CELLS   = COLUMNS*ROWS;
+
+  logic [15:0] cells[0:CELLS-1];
+  logic [5:0]  font[0:2047];
+  initial $readmemb(FONT_FILE, font);
+
+  logic        enabled;
+  logic [4:0]  top_row;
+  logic [5:0]  ram_row;
+  logic [11:0] cell_addr;
+  logic [15:0] cell;
+  logic [5:0]  glyph_row;
+  logic [2:0]  line_1, line_2;
+  logic [2:0]  column_1, column_2, column_3;
+  logic        in_1, in_2, in_3;
+  logic [7:0]  attribute_3;
+  logic        lit;
+
+  // write side
+  always_ff @(posedge clk) begin
+    if (command_valid & opcode(command) == OP_TEXT &
+        command[27:16] < CELLS)
+      cells[command[27:16]] <= command[15:0];
+    if (command_valid & opcode(command) == OP_TEXT_CONTROL) begin
+      enabled <= command[8];
+      if (command[4:0] < ROWS) top_row <= command[4:0];
+    end
+  end
+
+  // read side, stage 1: the RAM cell for this screen cell
+  always_comb begin
+    ram_row = y[8:4] + top_row;
+    if (ram_row >= ROWS) ram_row = ram_row - ROWS;
+  end
+
+  always_ff @(posedge clk) begin
+    cell_addr <= {ram_row, 6'b0} + {ram_row, 4'b0} + x[9:3];
+    line_1    <= y[3:1];
+    column_1  <= x[2:0];
+    in_1      <= (x < 8*COLUMNS) & (y < 16*ROWS);
+  end
+
+  // stage 2: the cell is read; look up its glyph row
+  always_ff @(posedge clk) begin
+    cell <= cells[cell_addr];
+    {line_2, column_2, in_2} <= {line_1, column_1, in_1};
+  end
+
+  always_ff @(posedge clk) begin
+    glyph_row   <= font[{cell[7:0], line_2}];
+    attribute_3 <= cell[15:8];
+    {column_3, in_3} <= {column_2, in_2};
+  end
+
+  // stage 3: pick the glyph pixel and its color
+  assign lit     = (column_3 < 6) & glyph_row[3'd5 - column_3];
+  assign in_text = enabled & in_3 & (lit | attribute_3[7:4] != 0);
+  assign rgb     = text_color(lit ? attribute_3[3:0] : attribute_3[7:4]);
+
+  // the 16 color CGA palette
+  function automatic logic [23:0] text_color(input logic [3:0] index);
+    case (index)
+      4'h0 : return 24'h000000;
+      4'h1 : return 24'h0000AA;
+      4'h2 : return 24'h00AA00;
+      4'h3 : return 24'h00AAAA;
+      4'h4 : return 24'hAA0000;
+      4'h5 : return 24'hAA00AA;
+      4'h6 : return 24'hAA5500;
+      4'h7 : return 24'hAAAAAA;
+      4'h8 : return 24'h555555;
+      4'h9 : return 24'h5555FF;
+      4'hA : return 24'h55FF55;
+      4'hB : return 24'h55FFFF;
+      4'hC : return 24'hFF5555;
+      4'hD : return 24'hFF55FF;
+      4'hE : return 24'hFFFF55;
+      4'hF : return 24'hFFFFFF;
+    endcase
+  endfunction
+endmodule
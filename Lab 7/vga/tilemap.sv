@@ -0,0 +1,110 @@
+// tilemap.sv
+// Tile map layer for vga.sv: an 80x60 map of 8x8 tiles covering the
+// 640x480 screen, drawn from 256 tile patterns of 4 bits per pixel
+// through a 16 color palette.
+//
+// Block RAM, counted from the declared arrays since no synthesis
+// report is available: the map is 4800 x 8 = 38,400 bits and the
+// patterns 8192 x 8 = 65,536 bits, 103,936 bits in all, which fill
+// 5 and 8 of Cyclone III's 1024 x 8 M9K blocks, 13 in all. The
+// 16 x 12 bit palette is read without a register, so it takes 192
+// flip-flops rather than block RAM. For comparison, one 320x240
+// framebuffer page of 8 bit pixels is 614,400 bits.
+//
+// OP_TILE writes the map, one tile number per cell at addresses
+// row*80 + column, and the patterns at addresses from 8192, 32 bytes
+// per tile, 4 bytes per row, with the left pixel of each pair in the
+// high nibble. Color 0 is transparent, showing the layers below.
+// OP_TILE_CONTROL sets the scroll position, reduced modulo 640 and
+// 480 as it is written and taken at each frame pulse, so the picture
+// never moves partway through a frame; the map wraps around at its
+// edges.
+
+// Applies OP_TILE and OP_TILE_CONTROL commands, and produces the
+// tile color for x, y 3 clocks after they arrive, with in_tile high
+// where the tile layer covers the layers below it.
+module tilemap(input  logic        clk,
+               input  logic        frame,
+               input  logic [31:0] command,
+               input  logic        command_valid,
+               input  logic [10:0] x, y,
+               output logic        in_tile,
+               output logic [23:0] rgb);
+  import vga_commands::*;
+
+  localparam COLUMNS = 80;
+  localparam ROWS    = 60;
+  localparam CELLS   = COLUMNS*ROWS;
+
+  logic [7:0]  map[0:CELLS-1];
+  logic [7:0]  patterns[0:8191];
+  logic [11:0] palette[16];
+
+  logic        enabled;
+  logic [9:0]  scroll_x, scroll_y, next_scroll_x, next_scroll_y;
+  logic [10:0] map_x, map_y;
+  logic [12:0] map_addr;
+  logic [7:0]  tile;
+  logic [2:0]  fine_x_1, fine_x_2, fine_y_1, fine_y_2;
+  logic        right_3;
+  logic        in_1, in_2, in_3;
+  logic [7:0]  pair;
+  logic [3:0]  color;
+
+  // write side
+  always_ff @(posedge clk) begin
+    if (command_valid & opcode(command) == OP_TILE) begin
+      if (command[21])                patterns[command[20:8]] <= command[7:0];
+      else if (command[20:8] < CELLS) map[command[20:8]]      <= command[7:0];
+    end
+    if (command_valid & opcode(command) == OP_TILE_CONTROL)
+      case (command[27:24])
+        // reduced into the map here, so that the read side wraps
+        // x + scroll with a single subtraction
+        4'd0    : next_scroll_x <= (command[9:0] >= 8*COLUMNS)
+                                     ? command[9:0] - 8*COLUMNS : command[9:0];
+        4'd1    : next_scroll_y <= (command[9:0] >= 16*ROWS)
+                                     ? command[9:0] - 16*ROWS :
+                                   (command[9:0] >= 8*ROWS)
+                                     ? command[9:0] - 8*ROWS : command[9:0];
+        4'd2    : enabled <= command[0];
+        4'd3    : palette[command[15:12]] <= command[11:0];
+        default : ;
+      endcase
+    if (frame) {scroll_x, scroll_y} <= {next_scroll_x, next_scroll_y};
+  end
+
+  // read side, stage 1: the map cell under the scrolled position
+  always_comb begin
+    map_x = x[9:0] + scroll_x;
+    map_y = y[9:0] + scroll_y;
+    if (map_x >= 8*COLUMNS) map_x = map_x - 8*COLUMNS;
+    if (map_y >= 8*ROWS)    map_y = map_y - 8*ROWS;
+  end
+
+  always_ff @(posedge clk) begin
+    map_addr <= {map_y[8:3], 6'b0} + {map_y[8:3], 4'b0} + map_x[9:3];
+    fine_x_1 <= map_x[2:0];
+    fine_y_1 <= map_y[2:0];
+    in_1     <= (x < 8*COLUMNS) & (y < 8*ROWS);
+  end
+
+  // stage 2: the tile is read; read the pair of pixels in its pattern
+  always_ff @(posedge clk) begin
+    tile <= map[map_addr];
+    {fine_x_2, fine_y_2, in_2} <= {fine_x_1, fine_y_1, in_1};
+  end
+
+  always_ff @(posedge clk) begin
+    pair    <= patterns[{tile, fine_y_2, fine_x_2[2:1]}];
+    right_3 <= fine_x_2[0];
+    in_3    <= in_2;
+  end
+
+  // stage 3: pick the pixel and its color
+  assign color   = right_3 ? pair[3:0] : pair[7:4];
+  assign in_tile = enabled & in_3 & (color != 0);
+  assign rgb     = {palette[color][11:8], palette[color][11:8],
+                    palette[color][7:4],  palette[color][7:4],
+                    palette[color][3:0],  palette[color][3:0]};
+endmodule
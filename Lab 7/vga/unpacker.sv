@@ -0,0 +1,172 @@
+// unpacker.sv
+// Decompresses framebuffer images sent as OP_PIXEL_PACKED bursts, so
+// an image costs its compressed size on the SPI link rather than a
+// byte per pixel. host/pixel_pack.cpp produces the streams.
+//
+// Each byte of a stream is one burst element, at its offset in the
+// stream as the burst address; a byte at offset 0 starts a new
+// stream, and a stream longer than one burst continues in bursts
+// starting at later offsets. The first byte of a new stream waits
+// for a run or copy of the stream before to finish writing, and
+// ends a stream that stopped short in any other token. A stream is
+// the 3 byte pixel address where the image starts, most significant
+// byte first, then tokens:
+//   0LLLLLLL           - L+1 literal pixels follow
+//   10LLLLLL p         - pixel p, L+3 times
+//   11LLLLLL 0000DDDD DDDDDDDD
+//                      - L+3 pixels copied from D+1 pixels back
+// Copies reach back through a 4096 pixel window of the stream's
+// output. Pixels past the end of the framebuffer are skipped.
+//
+// Stream bytes wait in a FIFO while the pixels of earlier tokens are
+// written, one per clock for literals and runs and one per 2 clocks
+// for copies. busy is high from the clock a byte arrives until it is
+// taken and the pixels of its token that need no more bytes are
+// written, so it also falls between bursts that split a token. A run
+// or copy can take longer than the SPI link takes to send the next
+// 64 bytes, so a PIC with a fast SPI clock splits streams into
+// bursts of up to 2**QUEUE_ADDR_BITS bytes and waits for busy to
+// fall in between; host/pixel_pack.cpp models the time this takes.
+// A byte that finds the FIFO full is lost, and flagged on dropped
+// for the commands dropped count.
+
+// Writes color at pixel address write_address, y*320 + x, when
+// write_ready.
+module pixel_unpacker #(parameter QUEUE_ADDR_BITS = 6)
+                       (input  logic        clk,
+                        input  logic [31:0] command,
+                        input  logic        command_valid,
+                        output logic        write,
+                        output logic [16:0] write_address,
+                        output logic [7:0]  color,
+                        input  logic        write_ready,
+                        output logic        busy,
+                        output logic        dropped);
+  import vga_commands::*;
+
+  localparam FB_PIXELS = 320*240;
+
+  typedef enum logic [3:0] {ADDRESS_0, ADDRESS_1, ADDRESS_2, TOKEN,
+                            LITERAL, RUN_VALUE, RUN, DISTANCE_0,
+                            DISTANCE_1, COPY_READ, COPY_WRITE} state_t;
+
+  // queued stream bytes, each with a flag for the start of a stream
+  logic [8:0]  entry;
+  logic        push, full, empty, pop;
+  logic [1:0]  pushed;
+  logic        first;
+  logic [7:0]  data;
+
+  assign push = command_valid & opcode(command) == OP_PIXEL_PACKED;
+  async_fifo #(9, QUEUE_ADDR_BITS)
+    queue(clk, push, {command[24:8] == 0, command[7:0]}, full,
+          clk, pop, entry, empty);
+  assign {first, data} = entry;
+
+  // a byte reaches empty through the FIFO's 2 register synchronizer,
+  // so busy covers the clocks until it does
+  always_ff @(posedge clk)
+    pushed <= {pushed[0], push};
+
+  state_t      state;
+  logic [16:0] pixel;
+  logic [6:0]  count;
+  logic [7:0]  value;
+  logic [11:0] distance, position, copy_from;
+  logic [7:0]  window[0:4095];
+  logic [7:0]  window_q;
+  logic        produce, needs_byte, taken, writing, restart;
+
+  // the pixel produced in this state, if any
+  always_comb begin
+    produce = 1'b0;
+    color   = value;
+    case (state)
+      LITERAL    : {produce, color} = {~empty & ~first, data};
+      RUN        : produce = 1'b1;
+      COPY_WRITE : {produce, color} = {1'b1, window_q};
+      default    : ;
+    endcase
+  end
+
+  assign copy_from     = position - distance - 12'd1;
+  assign write         = produce & (pixel < FB_PIXELS);
+  assign write_address = pixel;
+  assign taken         = produce & (~write | write_ready);
+
+  // bytes are taken from the queue in these states, or to restart
+  assign needs_byte = (state == ADDRESS_0) | (state == ADDRESS_1) |
+                      (state == ADDRESS_2) | (state == TOKEN) |
+                      (state == RUN_VALUE) | (state == DISTANCE_0) |
+                      (state == DISTANCE_1);
+  // runs and copies write their pixels without taking bytes
+  assign writing = (state == RUN) | (state == COPY_READ) |
+                   (state == COPY_WRITE);
+  assign restart = ~empty & first & ~writing;
+  assign pop  = ~empty & (first ? ~writing
+                                : needs_byte | (state == LITERAL & taken));
+  assign busy = ~empty | push | (|pushed) | writing;
+  assign dropped = push & full;
+
+  always_ff @(posedge clk) begin
+    if (taken) begin
+      window[position] <= color;
+      position         <= position + 1;
+      pixel            <= pixel + 1;
+    end
+    window_q <= window[copy_from];
+
+    if (restart) begin
+      pixel[16] <= data[0];
+      state     <= ADDRESS_1;
+    end else
+      case (state)
+        ADDRESS_0  : if (~empty) begin
+                       pixel[16] <= data[0];
+                       state     <= ADDRESS_1;
+                     end
+        ADDRESS_1  : if (~empty) begin
+                       pixel[15:8] <= data;
+                       state       <= ADDRESS_2;
+                     end
+        ADDRESS_2  : if (~empty) begin
+                       pixel[7:0] <= data;
+                       state      <= TOKEN;
+                     end
+        TOKEN      : if (~empty) begin
+                       count <= data[6:0];
+                       if (~data[7])      state <= LITERAL;
+                       else if (~data[6]) state <= RUN_VALUE;
+                       else               state <= DISTANCE_0;
+                       if (data[7]) count <= {1'b0, data[5:0]} + 7'd2;
+                     end
+        LITERAL    : if (taken) begin
+                       count <= count - 1;
+                       if (count == 0) state <= TOKEN;
+                     end
+        RUN_VALUE  : if (~empty) begin
+                       value <= data;
+                       state <= RUN;
+                     end
+        RUN        : if (taken) begin
+                       count <= count - 1;
+                       if (count == 0) state <= TOKEN;
+                     end
+        DISTANCE_0 : if (~empty) begin
+                       distance[11:8] <= data[3:0];
+                       state          <= DISTANCE_1;
+                     end
+        DISTANCE_1 : if (~empty) begin
+                       distance[7:0] <= data;
+                       state         <= COPY_READ;
+                     end
+        // the window is read here and written from in COPY_WRITE
+        COPY_READ  : state <= COPY_WRITE;
+        COPY_WRITE : if (taken) begin
+                       count <= count - 1;
+                       state <= (count == 0) ? TOKEN : COPY_READ;
+                     end
+        default    : state <= ADDRESS_0;
+      endcase
+  end
+endmodule
@@ -2,173 +2,439 @@
 // 20 October 2011 Karl_Wang & David_Harris@hmc.edu
 // VGA driver with character generator
 
-module vga(input  logic       clk,
+// MODE selects the display timing and pixel clock from vga_modes.sv.
+// DAC_BITS is the width of the video DAC per channel; below 8 the
+// output is dithered (dither.sv). FB_FORMAT selects how framebuffer
+// pixels are stored (framebuffer.sv).
+// The PIC sends commands, listed in vga_commands.sv, in SPI bursts
+// as described in spi_burst.sv, and reads back the status word on
+// spi_out:
+//   [95:85] vcnt, [84:74] hcnt, the beam position in vgaController
+//   [67] line_irq, [66] blit_busy, [65] flip_pending, [64] vblank
+//   [63:48] commands dropped, by a full SPI FIFO or a full blitter
+//   or unpacker queue, [47:32] mouse packets superseded by an
+//   OP_MOUSE in the same frame
+//   [31] a widget is hit, [30:28] buttons, [21:16] the widget hit,
+//   from the last hit test (hit_test.sv)
+//   [15:0] frames in which the cursor was updated
+module vga #(parameter MODE      = vga_modes::MODE_640X480_60,
+                       DAC_BITS  = 8,
+                       FB_FORMAT = "PALETTE")
+          (input  logic       clk,
            input  logic       spi_clk,
            input  logic       spi_in,
            input  logic       spi_fsync,
-           output logic       vgaclk,						// 25 MHz VGA clock
+           output logic       spi_out,             // to PIC, status
+           output logic       vgaclk,						// pixel clock for MODE
            output logic       hsync, vsync, sync_b,	// to monitor & DAC
-           output logic [7:0] r, g, b);					// to video DAC
+           output logic [7:0] r, g, b,					// to video DAC
+           output logic       flip_pending,        // to PIC, page swap waiting
+           output logic       blit_busy,           // to PIC, blitter drawing
+           output logic       line_irq);           // to PIC, line reached
  
-  logic [9:0]  x, y;
+  logic [10:0] x, y;
   logic [7:0]  r_int, g_int, b_int;
-  logic [31:0] spi_word;
   logic [9:0]  x_cursor;
   logic [9:0]  y_cursor;
-  logic        finished;
+  logic [31:0] command;
+  logic        command_valid;
   logic [2:0]  buttons;
+  logic [15:0] mouse_updates, mouse_superseded, commands_dropped;
+  logic [15:0] spi_dropped, lost_count = '0;
+  logic        command_lost;
+  logic [10:0] hcnt, vcnt;
+  logic        vblank;
+  logic        hit;
+  logic [5:0]  hit_id;
+  logic [2:0]  hit_buttons;
+
+  // clocks from x, y to r_int, g_int, b_int through videoGen
+  localparam VIDEO_LATENCY = 5;
+  localparam vga_modes::timing_t TIMING = vga_modes::timing(MODE);
 	
-  // Use a PLL to create the 25.175 MHz VGA pixel clock 
+  // Use a PLL to create the pixel clock for MODE. For the default
+  // 640x480 mode this is the 25.175 MHz VGA pixel clock
   // 25.175 Mhz clk period = 39.772 ns
   // Screen is 800 clocks wide by 525 tall, but only 640 x 480 used for display
   // HSync = 1/(39.772 ns * 800) = 31.470 KHz
   // Vsync = 31.474 KHz / 525 = 59.94 Hz (~60 Hz refresh rate)
-  pll	vgapll(.inclk0(clk),	.c0(vgaclk)); 
+  vga_pll #(MODE) vgapll(clk, vgaclk); 
 
-  // generate monitor timing signals
-  vgaController vgaCont(vgaclk, hsync, vsync, sync_b,  
-                        r_int, g_int, b_int, r, g, b, x, y);
+  // generate monitor timing signals, delayed to line up with the
+  // pipelined pixel colors from videoGen
+  vgaController #(.MODE(MODE), .PIPE_DELAY(VIDEO_LATENCY))
+    vgaCont(vgaclk, hsync, vsync, sync_b,  
+            r_int, g_int, b_int, r, g, b, x, y, hcnt, vcnt, vblank);
 	
 
   
-  spi_frm_slave slave(spi_clk, spi_in, spi_fsync, spi_word, finished);
+  spi_command_port commands(spi_clk, spi_in, spi_fsync,
+                            vgaclk, command, command_valid, spi_dropped);
+
+  // commands that reached a module whose queue was full
+  always_ff @(posedge vgaclk)
+    if (command_lost) lost_count <= lost_count + 1;
+  assign commands_dropped = spi_dropped + lost_count;
+
+  spi_status_port status(spi_clk, spi_fsync, vgaclk,
+                         {vcnt, hcnt, 6'b0, line_irq, blit_busy,
+                          flip_pending, vblank,
+                          commands_dropped, mouse_superseded,
+                          hit, hit_buttons, 6'b0, hit_id,
+                          mouse_updates},
+                         spi_out);
+  scanline_irq irq(vgaclk, command, command_valid, vcnt, line_irq);
   
-  mouse_reader reader(vsync, spi_word, finished, x_cursor, y_cursor, buttons);
+  mouse_reader #(.X_MAX((TIMING.h_active > 1024 ? 1024 : TIMING.h_active) - 1),
+                 .Y_MAX((TIMING.v_active > 1024 ? 1024 : TIMING.v_active) - 1))
+    reader(vgaclk, vsync, command, command_valid,
+           x_cursor, y_cursor, buttons, mouse_updates, mouse_superseded);
+  hit_tester widgets(vgaclk, vsync, command, command_valid,
+                     x_cursor, y_cursor, buttons, hit, hit_id, hit_buttons);
   
   // user-defined module to determine pixel color
-  videoGen videoGen(vsync, x, y, x_cursor, y_cursor, 
-                    buttons, r_int, g_int, b_int);
+  videoGen #(DAC_BITS, FB_FORMAT, TIMING.h_active)
+    videoGen(vgaclk, vsync, x, y, x_cursor, y_cursor, 
+                    buttons, command, command_valid, r_int, g_int, b_int,
+                    flip_pending, blit_busy, command_lost);
 endmodule
 
-module vgaController #(parameter HMAX   = 10'd800,
-                                 VMAX   = 10'd525, 
-											HSTART = 10'd152,
-											WIDTH  = 10'd640,
-											VSTART = 10'd37,
-											HEIGHT = 10'd480)
+// Each line is H_SYNC + H_BACK + WIDTH + H_FRONT clocks, starting
+// with the sync pulse; each frame is laid out the same way in lines.
+// The widths default to the VESA timing for MODE.
+module vgaController #(parameter MODE       = vga_modes::MODE_640X480_60,
+                                 PIPE_DELAY = 0,
+                       parameter vga_modes::timing_t T = vga_modes::timing(MODE),
+                       parameter H_SYNC      = T.h_sync,
+                                 H_BACK      = T.h_back,
+                                 WIDTH       = T.h_active,
+                                 H_FRONT     = T.h_front,
+                                 V_SYNC      = T.v_sync,
+                                 V_BACK      = T.v_back,
+                                 HEIGHT      = T.v_active,
+                                 V_FRONT     = T.v_front,
+                                 H_SYNC_HIGH = T.h_sync_high,
+                                 V_SYNC_HIGH = T.v_sync_high)
 						  (input  logic       vgaclk, 
                output logic       hsync, vsync, sync_b,
 							 input  logic [7:0] r_int, g_int, b_int,
 							 output logic [7:0] r, g, b,
-							 output logic [9:0] x, y);
+							 output logic [10:0] x, y,
+               output logic [10:0] hcnt, vcnt,
+               output logic        vblank);
+
+  localparam HSTART = H_SYNC + H_BACK;
+  localparam HMAX   = HSTART + WIDTH + H_FRONT;
+  localparam VSTART = V_SYNC + V_BACK;
+  localparam VMAX   = VSTART + HEIGHT + V_FRONT;
 
-  logic [9:0] hcnt, vcnt;
-  logic       oldhsync;
-  logic       valid;
+  logic        raw_hsync, raw_vsync, raw_valid;
+  logic        in_hsync, in_vsync, valid;
   
-  // counters for horizontal and vertical positions
-  always @(posedge vgaclk) begin
-    if (hcnt >= HMAX) hcnt = 0;
-    else hcnt++;
-	 if (hsync & ~oldhsync) begin // start of hsync; advance to next row
-	   if (vcnt >= VMAX) vcnt = 0;
-      else vcnt++;
+  // counters for horizontal and vertical positions; each line is
+  // exactly HMAX clocks and each frame exactly VMAX lines
+  always_ff @(posedge vgaclk) begin
+    if (hcnt >= HMAX-1) begin
+      hcnt <= 0;
+      if (vcnt >= VMAX-1) vcnt <= 0;
+      else                vcnt <= vcnt + 1;
+    end else begin
+      hcnt <= hcnt + 1;
     end
-    oldhsync = hsync;
   end
   
-  // compute sync signals (active low)
-  assign hsync = ~(hcnt >= 10'd8 & hcnt < 10'd104); // horizontal sync
-  assign vsync = ~(vcnt >= 2 & vcnt < 4); // vertical sync
-  assign sync_b = hsync | vsync;
+  // compute when the sync pulses are asserted
+  assign raw_hsync = (hcnt < H_SYNC); // horizontal sync
+  assign raw_vsync = (vcnt < V_SYNC); // vertical sync
 
   // determine x and y positions
   assign x = hcnt - HSTART;
   assign y = vcnt - VSTART;
+  assign vblank = (vcnt < VSTART | vcnt >= VSTART+HEIGHT);
   
   // force outputs to black when outside the legal display area
-  assign valid = (hcnt >= HSTART & hcnt < HSTART+WIDTH &
-                  vcnt >= VSTART & vcnt < VSTART+HEIGHT);
+  assign raw_valid = (hcnt >= HSTART & hcnt < HSTART+WIDTH &
+                      vcnt >= VSTART & vcnt < VSTART+HEIGHT);
+
+  // the colors for x, y arrive PIPE_DELAY clocks later, so delay the
+  // syncs and the display area by the same amount
+  generate
+    if (PIPE_DELAY == 0) begin
+      assign {in_hsync, in_vsync, valid} = {raw_hsync, raw_vsync, raw_valid};
+    end else begin
+      logic [PIPE_DELAY-1:0] hsync_pipe, vsync_pipe, valid_pipe;
+      always_ff @(posedge vgaclk) begin
+        hsync_pipe <= {hsync_pipe, raw_hsync};
+        vsync_pipe <= {vsync_pipe, raw_vsync};
+        valid_pipe <= {valid_pipe, raw_valid};
+      end
+      assign in_hsync = hsync_pipe[PIPE_DELAY-1];
+      assign in_vsync = vsync_pipe[PIPE_DELAY-1];
+      assign valid    = valid_pipe[PIPE_DELAY-1];
+    end
+  endgenerate
+
+  assign hsync  = H_SYNC_HIGH ? in_hsync : ~in_hsync;
+  assign vsync  = V_SYNC_HIGH ? in_vsync : ~in_vsync;
+  assign sync_b = ~(in_hsync & in_vsync);
   assign {r,g,b} = valid ? {r_int,g_int,b_int} : 24'b0;
 endmodule
 
-module videoGen(input  logic       clk,
-                input  logic [9:0] x, y, x_cursor, y_cursor,
+// raises irq through the whole of the line chosen by OP_LINE_IRQ,
+// 1 clock after vcnt reaches it, so the PIC can time updates from
+// the rising edge.
+module scanline_irq(input  logic        clk,
+                    input  logic [31:0] command,
+                    input  logic        command_valid,
+                    input  logic [10:0] vcnt,
+                    output logic        irq);
+  import vga_commands::*;
+
+  logic        enabled;
+  logic [10:0] line;
+
+  always_ff @(posedge clk) begin
+    if (command_valid & opcode(command) == OP_LINE_IRQ)
+      {enabled, line} <= command[11:0];
+    irq <= enabled & (vcnt == line);
+  end
+endmodule
+
+// pixel colors are produced 5 clocks after x and y arrive, for lines
+// of LINE_WIDTH pixels, the active width of the mode
+module videoGen #(parameter DAC_BITS   = 8,
+                            FB_FORMAT  = "PALETTE",
+                            LINE_WIDTH = 640)
+               (input  logic        clk,
+                input  logic        vsync,
+                input  logic [10:0] x, y,
+                input  logic [9:0]  x_cursor, y_cursor,
                 input  logic [2:0] buttons,
-           		  output logic [7:0] r_int, g_int, b_int);
+                input  logic [31:0] command,
+                input  logic        command_valid,
+           		  output logic [7:0] r_int, g_int, b_int,
+                output logic        flip_pending, blit_busy,
+                output logic        command_lost);
 
-  logic [7:0] ch;
-  logic [23:0] background_rgb;
+  logic [23:0] layer_rgb, sprite_rgb, cursor_rgb;
+  logic [10:0] next_y;
+  logic [23:0] background_ahead, framebuffer_ahead, text_ahead, tile_ahead;
+  logic [23:0] layer_ahead;
+  logic        in_framebuffer_ahead, in_text_ahead, in_tile_ahead;
+  logic        old_vsync, frame;
+  logic [1:0]  phase;
+  logic [1:0]  x_1, x_2, x_3, x_4, x_5, y_1, y_2, y_3, y_4, y_5;
   
-  background(clk, x, y, background_rgb);
-  draw_cursor(x, y, x_cursor, y_cursor, buttons,
-              background_rgb, {r_int, g_int, b_int});
+  // advance the animation, the dither phase and swap framebuffer
+  // pages once per frame, in vertical blanking: the rising edge of
+  // vsync ends the sync pulse in the negative polarity modes and
+  // starts it in the positive ones
+  always_ff @(posedge clk) begin
+    old_vsync <= vsync;
+    if (frame) phase <= phase + 1;
+  end
+  assign frame = vsync & ~old_vsync;
+  
+  // the layers draw line y+1, each 3 clocks behind x, and are
+  // composited 4 clocks later into a line buffer while line y is
+  // shown; the line buffer gives the pixels for x, y 3 clocks after
+  // they arrive
+  assign next_y = y + 1;
+
+  background bg(clk, frame, x[9:0], next_y[9:0], background_ahead);
+  framebuffer #(FB_FORMAT) fb(clk, frame, command, command_valid, x, next_y,
+                 in_framebuffer_ahead, framebuffer_ahead,
+                 flip_pending, blit_busy, command_lost);
+  text_layer text(clk, command, command_valid, x, next_y,
+                  in_text_ahead, text_ahead);
+  tilemap tiles(clk, frame, command, command_valid, x, next_y,
+                in_tile_ahead, tile_ahead);
+
+  // layers from top to bottom: cursor, sprites, then text,
+  // framebuffer and tiles in the compositor's order, background
+  compositor layers(clk, command, command_valid,
+                    in_text_ahead, in_framebuffer_ahead, in_tile_ahead,
+                    text_ahead, framebuffer_ahead, tile_ahead,
+                    background_ahead, layer_ahead);
+  line_prefetch #(.WIDTH(24), .LATENCY(7), .LINE_WIDTH(LINE_WIDTH))
+    layer_line(clk, x, y, layer_ahead, layer_rgb);
+
+  sprite_engine sprites(clk, command, command_valid, x, y,
+                        layer_rgb, sprite_rgb);
+  draw_cursor cursor(clk, command, command_valid, x, y,
+                     x_cursor, y_cursor, buttons, sprite_rgb, cursor_rgb);
+
+  // dither the finished pixel for the DAC, at its own position
+  always_ff @(posedge clk)
+    {x_5, x_4, x_3, x_2, x_1, y_5, y_4, y_3, y_2, y_1} <=
+        {x_4, x_3, x_2, x_1, x[1:0], y_4, y_3, y_2, y_1, y[1:0]};
+  dither #(DAC_BITS) dac_dither(x_5, y_5, phase, cursor_rgb,
+                                {r_int, g_int, b_int});
 endmodule
 
 // draw a cursor centered at {x_cursor, y_cursor} that changes
-// color based on the buttons pressed
-module draw_cursor(input  logic [9:0]  x, y, x_cursor, y_cursor,
+// color based on the buttons pressed, blended over background_rgb
+// with weight alpha+1 of 256, alpha set by OP_CONTROL register 5
+// (power-up 127, an even mix). background_rgb is expected 4 clocks
+// after x and y, and rgb is produced 5 clocks after.
+module draw_cursor(input  logic        clk,
+                   input  logic [31:0] command,
+                   input  logic        command_valid,
+                   input  logic [10:0] x, y,
+                   input  logic [9:0]  x_cursor, y_cursor,
                    input  logic [2:0]  buttons,
                    input  logic [23:0] background_rgb,
                    output logic [23:0] rgb);
+  import vga_commands::*;
+
   logic [23:0] cursor_color;
-  logic        in_cursor;
-  logic        in_hitbox;
-  in_ellipse cursor(x, y, x_cursor, y_cursor, 140,1,0, in_cursor);
-  in_disk hitbox(x, y, x_cursor, y_cursor, 8, in_hitbox);
+  logic        in_cursor, in_cursor_4;
+  logic        in_hitbox, in_hitbox_4;
+  logic [7:0]  alpha = 8'd127;
+  logic [8:0]  weight;
+  in_ellipse cursor(clk, x, y, x_cursor, y_cursor, 140,1,0, in_cursor);
+  in_disk hitbox(clk, x, y, x_cursor, y_cursor, 8, in_hitbox);
   
   
   assign cursor_color = {buttons[2]? 8'h80 : 8'hFF,
                          buttons[1]? 8'h80 : 8'hFF,
                          buttons[0]? 8'h80 : 8'hFF};
   
-  assign rgb = in_hitbox ? 24'hFFFFFF : 
-               in_cursor ? {8'((9'(cursor_color[23:16])
-                                +background_rgb[23:16])>>1),
-                            8'((9'(cursor_color[15: 8])
-                                +background_rgb[15: 8])>>1),
-                            8'((9'(cursor_color[ 7: 0])
-                                +background_rgb[ 7: 0])>>1)}: 
-               background_rgb;
-                   
+  always_ff @(posedge clk)
+    if (command_valid & opcode(command) == OP_CONTROL &
+        command[27:24] == 4'd5)
+      alpha <= command[7:0];
+  assign weight = alpha + 9'd1;
+
+  // the shapes are known a clock before background_rgb arrives
+  always_ff @(posedge clk)
+    {in_cursor_4, in_hitbox_4} <= {in_cursor, in_hitbox};
+
+  always_ff @(posedge clk)
+    rgb <= in_hitbox_4 ? 24'hFFFFFF : 
+           in_cursor_4 ? {blend(cursor_color[23:16], background_rgb[23:16]),
+                          blend(cursor_color[15: 8], background_rgb[15: 8]),
+                          blend(cursor_color[ 7: 0], background_rgb[ 7: 0])}: 
+           background_rgb;
+
+  function automatic logic [7:0] blend(input logic [7:0] color, below);
+    logic [15:0] sum;
+    sum = weight * color + (9'd256 - weight) * below;
+    return sum[15:8];
+  endfunction
 endmodule
 
 // Calculate if a point lies in an disk centered at 
 // {cent_x, cent_y} with radius sqrt(rad_squared).
-module in_disk  (input  logic [9:0]  x, y, cent_x, cent_y,
+// is_in is produced 3 clocks after the point arrives.
+module in_disk  (input  logic        clk,
+                 input  logic [10:0] x, y,
+                 input  logic [9:0]  cent_x, cent_y,
                  input  logic [21:0] rad_squared,
                  output logic        is_in);
-  logic signed [10:0] d_x, d_y;
-  logic [21:0] dist_squared;
-  always_comb begin
-    d_x = (x-cent_x);
-    d_y = (y-cent_y);
-    dist_squared = d_x*d_x + d_y*d_y;
-    is_in = (dist_squared < rad_squared);
-  end
+  in_ellipse disk(clk, x, y, cent_x, cent_y, rad_squared, 0, 0, is_in);
 endmodule
 
 // Calculate if a point lies in an ellipse centered at 
 // {cent_x, cent_y} with x_radius (sqrt(rad_squared) >> x_reduce)
 // and y_radius (sqrt(rad_squared) >> y_reduce).
-module in_ellipse  (input  logic [9:0]  x, y, cent_x, cent_y,
+// is_in is produced 3 clocks after the point arrives.
+//
+// Rather than squaring d_x and d_y every pixel, the half width of
+// the ellipse on line y+1 is found while line y is shown: d_y^2 by
+// shift and add, then the integer square root of what is left of
+// rad_squared, one bit per clock, about 35 clocks in all. Each
+// pixel then only compares |x - cent_x| with the half width.
+module in_ellipse  (input  logic        clk,
+                    input  logic [10:0] x, y,
+                    input  logic [9:0]  cent_x, cent_y,
                     input  logic [31:0] rad_squared,
                     input  logic [1:0]  x_reduce, y_reduce,
                     output logic        is_in);
-  logic signed [15:0] d_x, d_y;
-  logic [31:0] dist_squared;
-  always_comb begin
-    d_x = (x-cent_x) << x_reduce;
-    d_y = (y-cent_y) << y_reduce;
-    dist_squared = d_x*d_x + d_y*d_y;
-    is_in = (dist_squared < rad_squared);
+  typedef enum logic [1:0] {IDLE, SQUARE, ROOT} state_t;
+
+  state_t             state;
+  logic [10:0]        next_y;
+  logic signed [15:0] d_y;
+  logic [15:0]        d_y_size, multiplier;
+  logic [31:0]        multiplicand, d_y_squared;
+  logic [31:0]        remainder, root, root_bit;
+  logic               next_hit, line_hit;
+  logic [15:0]        next_half, line_half;
+  logic signed [11:0] d_x;
+  logic [10:0]        d_x_size;
+
+  // the line after this one, scaled as in the distance; y wraps
+  // from the last blanking line to line 0
+  assign next_y   = y + 1;
+  assign d_y      = (next_y - cent_y) << y_reduce;
+  assign d_y_size = d_y[15] ? -d_y : d_y;
+
+  // the span of line y+1 is ready long before its first pixel, so
+  // it becomes the line's span at x == 0
+  always_ff @(posedge clk)
+    case (state)
+      IDLE   : if (x == 0) begin
+                 line_hit     <= next_hit;
+                 line_half    <= next_half;
+                 d_y_squared  <= 0;
+                 multiplicand <= d_y_size;
+                 multiplier   <= d_y_size;
+                 state        <= SQUARE;
+               end
+      SQUARE : if (multiplier == 0) begin
+                 next_hit  <= d_y_squared < rad_squared;
+                 remainder <= rad_squared - d_y_squared - 1;
+                 root      <= 0;
+                 root_bit  <= 32'h4000_0000;
+                 state     <= ROOT;
+               end else begin
+                 if (multiplier[0]) d_y_squared <= d_y_squared + multiplicand;
+                 multiplicand <= multiplicand << 1;
+                 multiplier   <= multiplier >> 1;
+               end
+      // (d_x << x_reduce)^2 < rad_squared - d_y^2 exactly when
+      // d_x <= sqrt(rad_squared - d_y^2 - 1) >> x_reduce
+      ROOT   : if (root_bit == 0) begin
+                 next_half <= root >> x_reduce;
+                 state     <= IDLE;
+               end else begin
+                 if (remainder >= root + root_bit) begin
+                   remainder <= remainder - (root + root_bit);
+                   root      <= (root >> 1) + root_bit;
+                 end else begin
+                   root      <= root >> 1;
+                 end
+                 root_bit <= root_bit >> 2;
+               end
+      default: state <= IDLE;
+    endcase
+
+  always_ff @(posedge clk) begin
+    d_x      <= x - cent_x;
+    d_x_size <= d_x[11] ? -d_x : d_x;
+    is_in    <= line_hit & d_x_size <= line_half;
   end
 endmodule
 
 // creates an interesting gradient as a background based on
-// the timing and position.
+// the timing and position. rgb is produced 3 clocks after
+// x_screen and y_screen arrive.
 module background(input  logic       clk,
+                  input  logic       frame,
                   input  logic [9:0] x_screen, y_screen,
                   output logic [23:0] rgb);
-logic [9:0] diff, sum, x, y;
-logic [19:0] product; 
+logic [9:0] diff, sum, x, y, diff_1, sum_1;
+logic [19:0] product_2; 
 logic [7:0] r, g, b, x_wave, y_wave, intensity;
-logic [10:0] counter;
+logic [7:0] x_wave_1, y_wave_1, x_wave_2, y_wave_2;
+logic [10:0] counter, counter_1, counter_2;
 
 always_ff @(posedge clk) begin
-  counter <= counter + 1;
+  if (frame) counter <= counter + 1;
 end
 
+// stage 1: positions of the gradients and blinds
 always_comb begin
   x = x_screen;
   y = y_screen;
@@ -176,58 +442,134 @@ always_comb begin
   // diagonal gradient functions that move with time
   diff = 10'(x - y + (counter >> 0));
   sum  = 10'(x+y - (counter >> 0));
-  product = diff*sum;
-  
-  // the moving curved gradients
-  intensity = 8'(product[11:4] + (counter << 2)) >> 3;
   
   // the shifting "blinds" 
   x_wave = (8'((x<<2)-counter)>>>5) + (8'(-(x<<2)-counter)>>>5);
   y_wave = (8'((y<<2)-counter)>>>6) + (8'(-(y<<2)-counter)>>>6);
+end
+
+always_ff @(posedge clk) begin
+  {diff_1, sum_1, x_wave_1, y_wave_1, counter_1} <=
+      {diff, sum, x_wave, y_wave, counter};
+end
+
+// stage 2: the product for the curved gradients
+always_ff @(posedge clk) begin
+  product_2 <= diff_1*sum_1;
+  {x_wave_2, y_wave_2, counter_2} <= {x_wave_1, y_wave_1, counter_1};
+end
+
+// stage 3: the moving curved gradients
+always_comb begin
+  intensity = 8'(product_2[11:4] + (counter_2 << 2)) >> 3;
   
   // have each color play separate roles in each pattern
-  r = 8'h70 + x_wave + y_wave;
+  r = 8'h70 + x_wave_2 + y_wave_2;
   g = 8'h80 + ~intensity;
-  b = 8'hC0 + intensity + x_wave + y_wave;
-  rgb = {r,g,b};
+  b = 8'hC0 + intensity + x_wave_2 + y_wave_2;
 end
 
-endmodule
+always_ff @(posedge clk) begin
+  rgb <= {r,g,b};
+end
 
-// reads input from a frame enabled SPI to word_input
-// and signals the end of the transmission with finished
-module spi_frm_slave #(parameter WIDTH_POWER = 5, WIDTH = 2**WIDTH_POWER)
-                      (input  logic               spi_clk,
-                       input  logic               serial_input,
-                       input  logic               fsync,
-                       output logic [(WIDTH-1):0] word_input,
-                       output logic               finished);
-  logic [(WIDTH_POWER-1):0] counter = 0;
-  
-  always_ff @ (posedge spi_clk) begin
-    word_input <= finished ? word_input : 
-                            {word_input[(WIDTH-2):0], serial_input};
-    counter <= finished ? 1 : counter + 1;
-    finished <= ~fsync ? '0 : finished ? '1 : counter == 0;
-  end
-  
 endmodule
 
-// converts the values from word_input to recreate the
+// converts the OP_MOUSE and OP_MOUSE_DELTA commands to recreate the
 // mouse state in the form of position and buttons.
-module mouse_reader  (input  logic        sync_clk,
-                      input  logic [31:0] spi_word,
-                      input  logic        finished,
+// each command carries a complete packet, already in the clk
+// domain; the packets are gathered and applied once per frame, in
+// vertical blanking, at the next rising edge of vsync, so the cursor
+// never moves partway through a frame. OP_MOUSE sets the position
+// outright. OP_MOUSE_DELTA carries the raw movement of one HID report, which
+// is accelerated and summed in sixteenths of a pixel, so slow
+// movements build up over several reports rather than being lost,
+// and the position is kept within 0..X_MAX, 0..Y_MAX. updates counts
+// the frames the cursor was updated in and superseded counts the
+// packets discarded by an OP_MOUSE in the same frame; reports summed
+// with others are not counted.
+module mouse_reader #(parameter X_MAX = 639, Y_MAX = 479)
+                     (input  logic        clk,
+                      input  logic        vsync,
+                      input  logic [31:0] command,
+                      input  logic        command_valid,
                       output logic [9:0]  x_pixel, y_pixel,
-                      output logic [2:0]  button_state);
-  logic [22:0] complete_word;
-  always_ff @ (posedge finished) begin
-    complete_word <= spi_word[22:0];
-  end
-  always_ff @ (posedge sync_clk) begin
-    {button_state, x_pixel, y_pixel} = complete_word;
-  end
-endmodule
-  
+                      output logic [2:0]  button_state,
+                      output logic [15:0] updates, superseded);
+  import vga_commands::*;
+
+  logic               absolute, relative, packet, old_vsync, frame;
+  logic               has_pending, has_absolute;
+  logic [2:0]         pending_buttons;
+  logic [9:0]         absolute_x, absolute_y;
+  logic signed [13:0] step_x, step_y;
+  logic signed [19:0] moved_x, moved_y;
+  logic [13:0]        base_x, base_y, position_x, position_y;
+  logic signed [20:0] sum_x, sum_y;
+  logic [15:0]        update_count = '0, superseded_count = '0;
+
+  // scale a movement into sixteenths of a pixel, faster movements
+  // by more: 0.75 below 4, 1 below 8, 1.5 below 16, then 2
+  function automatic logic signed [13:0] accelerate(input logic signed [7:0] d);
+    logic [7:0] size;
+    size = d[7] ? -d : d;
+    if      (size < 4)  return (d <<< 3) + (d <<< 2);
+    else if (size < 8)  return d <<< 4;
+    else if (size < 16) return (d <<< 4) + (d <<< 3);
+    else                return d <<< 5;
+  endfunction
+
+  function automatic logic [13:0] clamp(input logic signed [20:0] value,
+                                        input logic [13:0]        limit);
+    if (value < 0)          return '0;
+    else if (value > limit) return limit;
+    else                    return value[13:0];
+  endfunction
+
+  assign absolute = command_valid & opcode(command) == OP_MOUSE;
+  assign relative = command_valid & opcode(command) == OP_MOUSE_DELTA;
+  assign packet   = absolute | relative;
+  assign frame    = vsync & ~old_vsync;
+  assign step_x   = accelerate(command[15:8]);
+  assign step_y   = accelerate(command[7:0]);
 
+  // the position the gathered movement starts from
+  assign base_x = has_absolute ? {absolute_x, 4'b0} : position_x;
+  assign base_y = has_absolute ? {absolute_y, 4'b0} : position_y;
+  assign sum_x  = $signed({7'b0, base_x}) + moved_x;
+  assign sum_y  = $signed({7'b0, base_y}) + moved_y;
 
+  always_ff @ (posedge clk) begin
+    old_vsync <= vsync;
+    if (frame & has_pending) begin
+      position_x   <= clamp(sum_x, X_MAX*16 + 15);
+      position_y   <= clamp(sum_y, Y_MAX*16 + 15);
+      button_state <= pending_buttons;
+      update_count <= update_count + 1;
+    end
+
+    // gather the packets for the next frame
+    if (absolute) begin
+      {pending_buttons, absolute_x, absolute_y} <= command[22:0];
+      has_absolute <= 1'b1;
+      {moved_x, moved_y} <= '0;
+    end else if (relative) begin
+      pending_buttons <= command[18:16];
+      has_absolute    <= has_absolute & ~frame;
+      moved_x         <= (frame ? 20'sd0 : moved_x) + step_x;
+      moved_y         <= (frame ? 20'sd0 : moved_y) + step_y;
+    end else if (frame) begin
+      has_absolute <= 1'b0;
+      {moved_x, moved_y} <= '0;
+    end
+
+    if (absolute & has_pending & ~frame)
+      superseded_count <= superseded_count + 1;
+    has_pending <= packet | (has_pending & ~frame);
+  end
+
+  assign x_pixel    = position_x[13:4];
+  assign y_pixel    = position_y[13:4];
+  assign updates    = update_count;
+  assign superseded = superseded_count;
+endmodule
@@ -0,0 +1,129 @@
+// vga_commands.sv
+// Command words applied by the layers of vga.sv. Each 32-bit command
+// carries an opcode in bits [31:28]; the meaning of the remaining
+// bits is listed with each opcode.
+//
+// The PIC does not send command words directly. spi_burst.sv turns
+// each SPI burst, a header naming an opcode, a start address and an
+// element count followed by the elements, into one command per
+// element with burst_command. Compile before vga.sv.
+
+package vga_commands;
+
+  // [22:0] = {buttons[2:0], x_pixel[9:0], y_pixel[9:0]}
+  localparam logic [3:0] OP_MOUSE   = 4'h0;
+  // [24:8] = pixel address y*320 + x, [7:0] = palette index, or the
+  // color {red[2:0], green[2:0], blue[1:0]} for an RGB332 framebuffer
+  localparam logic [3:0] OP_PIXEL   = 4'h1;
+  // [17:16] = channel (2 red, 1 green, 0 blue), [15:8] = palette
+  // index, [7:0] = channel intensity
+  localparam logic [3:0] OP_PALETTE = 4'h2;
+  // [27:24] = register, [7:0] = value:
+  //   0: [0] = show the framebuffer,
+  //   1, 2, 3: text, framebuffer, tile layer alpha (compositor.sv),
+  //   4: [5:0] = layer order, three 2 bit layers (0 text,
+  //   1 framebuffer, 2 tiles, 3 none) from the top in [1:0],
+  //   5: cursor alpha,
+  //   6: [0] = swap the framebuffer pages at the next vsync with
+  //       the blitter and unpacker idle
+  localparam logic [3:0] OP_CONTROL = 4'h3;
+  // [27:16] = text cell address row*80 + column in text RAM,
+  // [15:8] = attribute {background, foreground}, [7:0] = character
+  localparam logic [3:0] OP_TEXT    = 4'h4;
+  // [8] = show the text layer, [4:0] = text RAM row (0-29) shown at
+  // the top of the screen; rows 30 and 31 leave it unchanged
+  localparam logic [3:0] OP_TEXT_CONTROL = 4'h5;
+  // [27:16] = sprite pattern address sprite*256 + row*16 + column,
+  // [15:0] = pixel {alpha, red, green, blue}, 4 bits each; alpha 0
+  // is transparent and 15 is opaque
+  localparam logic [3:0] OP_SPRITE_PATTERN = 4'h6;
+  // [27:24] = sprite, [23:22] = register, [15:0] = value:
+  //   register 0: [10:0] = left x, 1: [10:0] = top y,
+  //   2: [8] = show the sprite, [1:0] = rank, where lower ranks
+  //   are drawn over higher ranks
+  localparam logic [3:0] OP_SPRITE = 4'h7;
+  // [27:24] = blitter register, [15:0] = value, queued in blitter.sv:
+  //   0: [9:0] = x, 1: [9:0] = y, 2: [9:0] = width, or x1 for a line,
+  //   3: [9:0] = height, or y1 for a line, 4: [9:0] = src_x,
+  //   5: [9:0] = src_y, 6: [15:8] = background, [7:0] = foreground,
+  //   7: [15:0] = next glyph row, leftmost pixel in bit 15,
+  //   15: start, [1:0] = 0 fill, 1 copy, 2 line, 3 glyph,
+  //       [2] = transparent glyph background
+  localparam logic [3:0] OP_BLIT = 4'h8;
+  // [11] = raise line_irq, [10:0] = the line it is raised for,
+  // counted like vcnt from the first line of vsync
+  localparam logic [3:0] OP_LINE_IRQ = 4'h9;
+  // [18:16] = buttons, [15:8] = x movement, [7:0] = y movement, as
+  // signed bytes straight from a HID mouse report
+  localparam logic [3:0] OP_MOUSE_DELTA = 4'hA;
+  // [21:8] = tile RAM address, [7:0] = data: addresses below 4800
+  // are map cells row*80 + column holding a tile number, and from
+  // 8192 up are tile pattern bytes tile*32 + row*4 + column/2
+  localparam logic [3:0] OP_TILE = 4'hB;
+  // [27:24] = tile register, [15:0] = value:
+  //   0: [9:0] = x scroll, taken modulo 640,
+  //   1: [9:0] = y scroll, taken modulo 480,
+  //   2: [0] = show the tile layer,
+  //   3: [15:12] = palette index, [11:0] = color {red, green, blue}
+  localparam logic [3:0] OP_TILE_CONTROL = 4'hC;
+  // [24:8] = offset in a compressed image stream, [7:0] = stream
+  // byte, decoded into framebuffer pixels by unpacker.sv
+  localparam logic [3:0] OP_PIXEL_PACKED = 4'hD;
+  // [27:22] = hit test rectangle, [21:20] = field, [15:0] = value:
+  //   0: [15] = in use, [9:0] = left x, 1: [9:0] = top y,
+  //   2: [9:0] = right x, 3: [9:0] = bottom y, inclusive
+  localparam logic [3:0] OP_HIT_RECT = 4'hE;
+  // ignored; a burst of these only reads the status (spi_burst.sv)
+  localparam logic [3:0] OP_NOP = 4'hF;
+
+  function automatic logic [3:0] opcode(input logic [31:0] word);
+    return word[31:28];
+  endfunction
+
+  // bytes per burst element for each opcode; elements are sent most
+  // significant byte first
+  function automatic logic [1:0] element_bytes(input logic [3:0] op);
+    case (op)
+      OP_MOUSE          : return 2'd3;
+      OP_TEXT           : return 2'd2;
+      OP_TEXT_CONTROL   : return 2'd2;
+      OP_SPRITE_PATTERN : return 2'd2;
+      OP_SPRITE         : return 2'd2;
+      OP_BLIT           : return 2'd2;
+      OP_LINE_IRQ       : return 2'd2;
+      OP_MOUSE_DELTA    : return 2'd3;
+      OP_TILE_CONTROL   : return 2'd2;
+      OP_HIT_RECT       : return 2'd2;
+      default           : return 2'd1;
+    endcase
+  endfunction
+
+  // the command for an element at address in a burst to op. palette
+  // addresses are {index, channel}, so that each palette entry is a
+  // 4 byte region with blue in the lowest byte. sprite register
+  // addresses are {sprite, register}; blitter addresses are the
+  // register, so a burst from address 0 sets registers in order, and
+  // likewise for tile and control registers. hit test addresses are
+  // {rectangle, field}.
+  function automatic logic [31:0] burst_command(input logic [3:0]  op,
+                                                input logic [16:0] address,
+                                                input logic [23:0] element);
+    case (op)
+      OP_MOUSE          : return {op, 5'b0, element[22:0]};
+      OP_PIXEL          : return {op, 3'b0, address, element[7:0]};
+      OP_PIXEL_PACKED   : return {op, 3'b0, address, element[7:0]};
+      OP_PALETTE        : return {op, 10'b0, address[1:0], address[9:2],
+                                  element[7:0]};
+      OP_CONTROL        : return {op, address[3:0], 16'b0, element[7:0]};
+      OP_TEXT           : return {op, address[11:0], element[15:0]};
+      OP_SPRITE_PATTERN : return {op, address[11:0], element[15:0]};
+      OP_SPRITE         : return {op, address[5:0], 6'b0, element[15:0]};
+      OP_BLIT           : return {op, address[3:0], 8'b0, element[15:0]};
+      OP_TILE           : return {op, 6'b0, address[13:0], element[7:0]};
+      OP_TILE_CONTROL   : return {op, address[3:0], 8'b0, element[15:0]};
+      OP_HIT_RECT       : return {op, address[7:0], 4'b0, element[15:0]};
+      default           : return {op, 4'b0, element};
+    endcase
+  endfunction
+
+endpackage
@@ -0,0 +1,58 @@
+// vga_modes.sv
+// Display timing presets for vgaController, and the pixel clock PLL
+// for each preset. Compile before vga.sv.
+
+package vga_modes;
+
+  localparam int MODE_640X480_60  = 0;
+  localparam int MODE_800X600_60  = 1;
+  localparam int MODE_1024X768_60 = 2;
+  localparam int MODE_1280X720_60 = 3;
+
+  // horizontal widths are in pixel clocks, vertical widths in lines.
+  // a line starts with the sync pulse, followed by the back porch,
+  // the active video and the front porch; a frame is laid out the
+  // same way in lines.
+  typedef struct packed {
+    logic [10:0] h_active, h_front, h_sync, h_back;
+    logic [10:0] v_active, v_front, v_sync, v_back;
+    logic        h_sync_high, v_sync_high; // sync polarity
+    logic [16:0] pixel_khz;
+  } timing_t;
+
+  // VESA DMT (640x480, 800x600, 1024x768) and CEA-861 (1280x720)
+  function automatic timing_t timing(int mode);
+    case (mode)
+      MODE_800X600_60  : return '{800,  40, 128,  88, 600, 1, 4, 23,
+                                  1'b1, 1'b1, 40_000};
+      MODE_1024X768_60 : return '{1024, 24, 136, 160, 768, 3, 6, 29,
+                                  1'b0, 1'b0, 65_000};
+      MODE_1280X720_60 : return '{1280, 110, 40, 220, 720, 5, 5, 20,
+                                  1'b1, 1'b1, 74_250};
+      default          : return '{640,  16,  96,  48, 480, 10, 2, 33,
+                                  1'b0, 1'b0, 25_175};
+    endcase
+  endfunction
+
+endpackage
+
+// Create the pixel clock for MODE from the 40 MHz board clock.
+// 640x480 uses the project's ALTPLL megafunction pll (inclk0 =
+// 40 MHz, c0 = 25.175 MHz), and 800x600 runs on the board clock
+// itself. No PLL has been generated for the 65 MHz and 74.25 MHz
+// modes yet, so they stop elaboration rather than fail to link; to
+// add one, generate an ALTPLL with inclk0 = 40 MHz and a single c0
+// output (x13 /8 for 65 MHz, x297 /160 for 74.25 MHz), add it to the
+// project and instantiate it below.
+module vga_pll #(parameter MODE = vga_modes::MODE_640X480_60)
+                (input  logic clk,
+                 output logic vgaclk);
+  generate
+    case (MODE)
+      vga_modes::MODE_800X600_60  : assign vgaclk = clk;
+      vga_modes::MODE_1024X768_60 : $error("vga_pll: no 65 MHz PLL for MODE_1024X768_60");
+      vga_modes::MODE_1280X720_60 : $error("vga_pll: no 74.25 MHz PLL for MODE_1280X720_60");
+      default                     : pll vgapll(.inclk0(clk), .c0(vgaclk));
+    endcase
+  endgenerate
+endmodule